@@ -0,0 +1,199 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef ANALOG_SAMPLER_H
+#define ANALOG_SAMPLER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <FirmataMarshaller.h>
+
+#include "DeviceContract.h"
+#include "PinSet.h"
+#include "Stream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief A timestamped analog reading
+ */
+struct AnalogSample {
+    std::chrono::steady_clock::time_point received_at;
+    uint16_t value;
+};
+
+/*!
+ * \brief Ingests analog reports into per-pin lock-free rings
+ *
+ * The sampler enables reporting on every pin with an analog read
+ * capability, and decodes ANALOG_MESSAGE frames straight from the received
+ * bytes into a single-producer/single-consumer ring per pin, translating
+ * each channel to its pin through the analog mapping of the contract.
+ * Samples are stamped with the time the bytes that carried them were
+ * ingested. Consumers read whole batches in place with `peek`, and return
+ * them with `release`, so no callback runs per sample.
+ *
+ * \note `ingest` is called by the producer (i.e. `FirmataQuery`, once the
+ *       sampler is attached with `setAnalogSampler`), and each pin may be
+ *       consumed by one other thread. When a ring is full, new samples
+ *       are dropped and counted.
+ */
+class AnalogSampler {
+  public:
+    static const size_t CHANNEL_COUNT = 16;
+    static const size_t DEFAULT_SAMPLES_PER_PIN = 1024;
+
+    /*!
+     * \param [in] contract_ The contract of the remote device
+     * \param [in] samples_per_pin_ The capacity of each ring (rounded up to
+     *                              a power of two)
+     */
+    AnalogSampler (
+        const DeviceContract & contract_,
+        const size_t samples_per_pin_ = DEFAULT_SAMPLES_PER_PIN
+    );
+
+    ~AnalogSampler (
+        void
+    );
+
+    /*!
+     * \brief The greatest number of unread samples held for any pin
+     */
+    size_t
+    backlog (
+        void
+    ) const;
+
+    /*!
+     * \brief Enable analog reporting on every sampled pin
+     *
+     * \param [in] stream_ The stream connected to the remote device
+     */
+    void
+    begin (
+        Stream & stream_
+    );
+
+    /*!
+     * \brief Disable analog reporting on every sampled pin
+     */
+    void
+    end (
+        void
+    );
+
+    /*!
+     * \brief Decode the analog messages in a run of received bytes
+     *
+     * \param [in] data_ The received bytes (frames may span calls)
+     * \param [in] size_ The number of bytes
+     * \param [in] received_at_ The time the bytes were received
+     */
+    void
+    ingest (
+        const uint8_t * data_,
+        const size_t size_,
+        const std::chrono::steady_clock::time_point received_at_
+    );
+
+    /*!
+     * \brief Borrow the oldest contiguous batch of samples of a pin
+     *
+     * \param [in] pin_ The pin to read
+     * \param [out] samples_ The first sample of the batch
+     *
+     * \return The number of samples in the batch (zero when empty)
+     *
+     * \note The batch stays valid until it is returned with `release`.
+     *       When the ring wraps, the remaining samples form the next batch.
+     */
+    size_t
+    peek (
+        const size_t pin_,
+        const AnalogSample ** samples_
+    ) const;
+
+    /*!
+     * \brief The pins being sampled
+     */
+    PinSet
+    pins (
+        void
+    ) const;
+
+    /*!
+     * \brief Return samples borrowed with `peek`
+     *
+     * \param [in] pin_ The pin the samples were read from
+     * \param [in] count_ The number of samples consumed
+     */
+    void
+    release (
+        const size_t pin_,
+        const size_t count_
+    );
+
+    /*!
+     * \brief The number of samples of a pin dropped because its ring was full
+     */
+    size_t
+    samplesDropped (
+        const size_t pin_
+    ) const;
+
+    /*!
+     * \brief The number of samples of every pin dropped because a ring was full
+     */
+    size_t
+    samplesDropped (
+        void
+    ) const;
+
+    /*!
+     * \brief The capacity of the ring of each pin
+     */
+    size_t
+    samplesPerPin (
+        void
+    ) const;
+
+  private:
+    struct Ring {
+        std::atomic<size_t> head;
+        uint8_t head_padding[64 - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> tail;
+        std::atomic<size_t> dropped;
+        AnalogSample * samples;
+    };
+
+    static const uint8_t NO_RING = 0xFF;
+
+    uint8_t _channel_ring[CHANNEL_COUNT];
+    size_t _frame_size;
+    uint8_t _frame[3];
+    firmata::FirmataMarshaller _marshaller;
+    size_t _mask;
+    uint8_t _pin_ring[PinSet::CAPACITY];
+    PinSet _pins;
+    size_t _ring_count;
+    Ring * _rings;
+    AnalogSample * _sample_buffer;
+
+    void
+    push (
+        const uint8_t channel_,
+        const uint16_t value_,
+        const std::chrono::steady_clock::time_point received_at_
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // ANALOG_SAMPLER_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
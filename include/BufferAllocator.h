@@ -0,0 +1,136 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef BUFFER_ALLOCATOR_H
+#define BUFFER_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief An interface for supplying the memory used by queries and contracts
+ *
+ * Parser buffers, pin tables and device contracts are all obtained through
+ * a `BufferAllocator`, so a single pool or arena may back every buffer in
+ * the process.
+ *
+ * \sa remote_wiring::protocol::BufferPool
+ */
+struct BufferAllocator {
+    virtual
+    ~BufferAllocator (
+        void
+    ) {
+
+    }
+
+    /*!
+     * \brief Allocate a buffer
+     *
+     * \param [in] size_ The number of bytes required
+     *
+     * \return A pointer to the buffer (suitably aligned for any type) or
+     *         `nullptr` when the memory is unavailable
+     */
+    virtual
+    void *
+    allocate (
+        const size_t size_
+    ) = 0;
+
+    /*!
+     * \brief Return a buffer to the allocator
+     *
+     * \param [in] buffer_ A pointer previously returned by `allocate`
+     * \param [in] size_ The size originally requested from `allocate`
+     */
+    virtual
+    void
+    deallocate (
+        void * buffer_,
+        const size_t size_
+    ) = 0;
+
+    /*!
+     * \brief The default allocator, backed by `malloc` and `free`
+     */
+    static
+    BufferAllocator &
+    heap (
+        void
+    );
+};
+
+/*!
+ * \brief Adapts a `BufferAllocator` to the standard allocator requirements
+ *
+ * Standard library objects that allocate internally (i.e. the shared state
+ * of a `std::promise`) may be supplied this adapter, so their memory comes
+ * from the same pool as every other buffer.
+ */
+template <typename T>
+struct BufferAllocatorAdapter {
+    typedef T value_type;
+
+    BufferAllocator * allocator;
+
+    explicit
+    BufferAllocatorAdapter (
+        BufferAllocator & allocator_
+    ) :
+        allocator(&allocator_)
+    {
+    }
+
+    template <typename U>
+    BufferAllocatorAdapter (
+        const BufferAllocatorAdapter<U> & other_
+    ) :
+        allocator(other_.allocator)
+    {
+    }
+
+    T *
+    allocate (
+        const size_t count_
+    ) {
+        void * const buffer = allocator->allocate(count_ * sizeof(T));
+        if ( nullptr == buffer ) { throw std::bad_alloc(); }
+        return static_cast<T *>(buffer);
+    }
+
+    void
+    deallocate (
+        T * buffer_,
+        const size_t count_
+    ) {
+        allocator->deallocate(buffer_, (count_ * sizeof(T)));
+    }
+};
+
+template <typename T, typename U>
+bool
+operator== (
+    const BufferAllocatorAdapter<T> & lhs_,
+    const BufferAllocatorAdapter<U> & rhs_
+) {
+    return (lhs_.allocator == rhs_.allocator);
+}
+
+template <typename T, typename U>
+bool
+operator!= (
+    const BufferAllocatorAdapter<T> & lhs_,
+    const BufferAllocatorAdapter<U> & rhs_
+) {
+    return (lhs_.allocator != rhs_.allocator);
+}
+
+} // protocol
+} // remote_wiring
+
+#endif // BUFFER_ALLOCATOR_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,89 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+#include "BufferAllocator.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief A thread-safe pool of power-of-two sized buffers
+ *
+ * Buffers returned to the pool are kept on a free list for their size
+ * class and handed out again, so once every size class in use has been
+ * populated (warm-up) no further heap allocations occur.
+ *
+ * \note Requests larger than the largest size class are passed directly
+ *       to the heap, and counted as heap allocations.
+ */
+class BufferPool : public BufferAllocator {
+  public:
+    BufferPool (
+        void
+    );
+
+    ~BufferPool (
+        void
+    );
+
+    void *
+    allocate (
+        const size_t size_
+    ) override;
+
+    /*!
+     * \brief The number of buffers handed out by the pool
+     */
+    size_t
+    allocations (
+        void
+    ) const;
+
+    void
+    deallocate (
+        void * buffer_,
+        const size_t size_
+    ) override;
+
+    /*!
+     * \brief The number of buffers the pool obtained from the heap
+     *
+     * \note Stops increasing once the pool has warmed up
+     */
+    size_t
+    heapAllocations (
+        void
+    ) const;
+
+  private:
+    static const size_t MIN_BLOCK_SIZE = 16;
+    static const size_t SIZE_CLASS_COUNT = 16;
+
+    struct FreeBlock {
+        FreeBlock * next;
+    };
+
+    std::atomic<size_t> _allocations;
+    FreeBlock * _free_lists[SIZE_CLASS_COUNT];
+    std::atomic<size_t> _heap_allocations;
+    std::mutex _mutex;
+
+    static
+    size_t
+    sizeClassOf (
+        const size_t size_
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // BUFFER_POOL_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,72 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef CAPABILITY_DECODER_H
+#define CAPABILITY_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "DeviceContract.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Incrementally decodes the payload of a CAPABILITY_RESPONSE
+ *
+ * The payload is a list of mode/resolution pairs for each pin, terminated
+ * by PIN_MODE_IGNORE. The decoder consumes one payload byte at a time and
+ * reports each pin as soon as its terminator is seen, so it can decode a
+ * complete response or a response still arriving on the wire.
+ */
+class CapabilityDecoder {
+  public:
+    typedef void(*pinDecoded)(void * context_, size_t pin_, pin_config_t pin_data_);
+
+    CapabilityDecoder (
+        pinDecoded pinDecodedCallback_,
+        void * pin_decoded_callback_context_
+    );
+
+    /*!
+     * \brief Prepare to decode a new response
+     */
+    void
+    begin (
+        void
+    );
+
+    /*!
+     * \brief Decode the next payload byte
+     *
+     * \param [in] byte_ A payload byte (excluding the CAPABILITY_RESPONSE
+     *                   command byte and END_SYSEX)
+     */
+    void
+    decode (
+        const uint8_t byte_
+    );
+
+    /*!
+     * \brief The number of pins decoded since `begin`
+     */
+    size_t
+    pinCount (
+        void
+    ) const;
+
+  private:
+    ConfigCodec _codec;
+    uint8_t _mode;
+    bool _mode_byte;
+    pinDecoded _pin_decoded_callback;
+    void * _pin_decoded_callback_context;
+    size_t _pin_count;
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // CAPABILITY_DECODER_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,67 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief The on-disk layout of a serial traffic capture
+ *
+ * A capture is a `CaptureFileHeader` followed by records, appended as the
+ * traffic is observed. Each record is a `CaptureRecord` followed by its
+ * payload, padded so the next record is 8-byte aligned; a mapped capture
+ * may therefore be walked in place. A capture cut short (i.e. by a crash)
+ * ends at its last complete record.
+ *
+ * \note Fields are stored in the byte order of the recording host.
+ */
+
+static const char CAPTURE_MAGIC[8] = { 'F', 'I', 'R', 'M', 'C', 'A', 'P', '\0' };
+static const uint32_t CAPTURE_VERSION = 1;
+
+enum CaptureDirection : uint8_t {
+    CAPTURE_RX = 0,  // Received by the host (from the remote device)
+    CAPTURE_TX = 1,  // Sent by the host (to the remote device)
+};
+
+struct CaptureFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;  // The offset of the first record
+    int64_t wall_clock_ns;  // The system time the capture began, since the epoch
+    uint64_t reserved;
+};
+
+struct CaptureRecord {
+    uint64_t timestamp_ns;  // The time of the first byte, since the capture began
+    uint32_t size;  // The number of payload bytes
+    uint16_t stream_id;
+    uint8_t direction;
+    uint8_t reserved;
+};
+
+static_assert((sizeof(CaptureFileHeader) % 8) == 0, "CaptureFileHeader must keep records aligned");
+static_assert(sizeof(CaptureRecord) == 16, "CaptureRecord must be 16 bytes");
+
+/*!
+ * \brief The number of bytes a record and its payload occupy
+ */
+inline
+size_t
+captureRecordSpan (
+    const size_t size_
+) {
+    return ((sizeof(CaptureRecord) + size_ + 7) & ~static_cast<size_t>(7));
+}
+
+} // protocol
+} // remote_wiring
+
+#endif // CAPTURE_FORMAT_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
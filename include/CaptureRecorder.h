@@ -0,0 +1,141 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef CAPTURE_RECORDER_H
+#define CAPTURE_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "CaptureFormat.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Appends timestamped serial traffic to a capture file
+ *
+ * Records are copied into an in-memory buffer, and the buffer is written to
+ * the file whenever it fills (or on `flush`), so recording costs a copy per
+ * record rather than a system call. Any number of streams may share one
+ * recorder (see `CaptureStream`), each under its own stream id.
+ *
+ * \note When the file cannot be written (i.e. the disk is full), the
+ *       buffered records are dropped and counted, so a failing capture
+ *       never stalls the traffic it observes.
+ */
+class CaptureRecorder {
+  public:
+    typedef std::chrono::steady_clock::time_point time_point;
+
+    static const size_t DEFAULT_BUFFER_SIZE = (64 * 1024);
+
+    /*!
+     * \param [in] buffer_size_ The number of bytes buffered between writes
+     */
+    CaptureRecorder (
+        const size_t buffer_size_ = DEFAULT_BUFFER_SIZE
+    );
+
+    ~CaptureRecorder (
+        void
+    );
+
+    /*!
+     * \brief The total number of payload bytes recorded
+     */
+    uint64_t
+    bytesRecorded (
+        void
+    ) const;
+
+    /*!
+     * \brief Flush the buffer and close the capture file
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     */
+    int
+    close (
+        void
+    );
+
+    /*!
+     * \brief Write the buffered records to the capture file
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (the buffered records are dropped)
+     */
+    int
+    flush (
+        void
+    );
+
+    /*!
+     * \brief Create (or truncate) a capture file, and write its header
+     *
+     * \param [in] path_ The path of the capture file
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     */
+    int
+    open (
+        const char * path_
+    );
+
+    /*!
+     * \brief Append a record
+     *
+     * \param [in] stream_id_ The stream the bytes were observed on
+     * \param [in] direction_ The direction the bytes traveled
+     * \param [in] data_ The bytes
+     * \param [in] size_ The number of bytes
+     * \param [in] observed_at_ The time the first byte was observed
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (i.e. the recorder is not open)
+     *
+     * \note Payloads larger than the buffer are split across records.
+     */
+    int
+    record (
+        const uint16_t stream_id_,
+        const CaptureDirection direction_,
+        const uint8_t * data_,
+        const size_t size_,
+        const time_point observed_at_
+    );
+
+    /*!
+     * \brief The number of records dropped because they could not be written
+     */
+    uint64_t
+    recordsDropped (
+        void
+    ) const;
+
+  private:
+    uint8_t * _buffer;
+    const size_t _buffer_capacity;
+    size_t _buffer_size;
+    std::atomic<uint64_t> _bytes_recorded;
+    int _fd;
+    uint64_t _file_size;
+    std::mutex _mutex;
+    size_t _records_buffered;
+    std::atomic<uint64_t> _records_dropped;
+    time_point _started_at;
+
+    int
+    writeBuffer (
+        void
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // CAPTURE_RECORDER_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,135 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef CAPTURE_REPLAYER_H
+#define CAPTURE_REPLAYER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CaptureFormat.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Plays a capture file back to the host
+ *
+ * The capture is mapped read-only, and its records are walked in place.
+ * `replay` hands the bytes one stream received to a callback, one record
+ * at a time, which feeds them to whatever parses that stream (i.e. a
+ * `FirmataQuery`), so it sees the traffic as it arrived from the remote
+ * device.
+ */
+class CaptureReplayer {
+  public:
+    typedef void(*replayBytes)(void * context_, const uint8_t * data_, size_t size_);
+
+    static constexpr double AS_FAST_AS_POSSIBLE = 0.0;
+    static constexpr double WIRE_SPEED = 1.0;
+
+    CaptureReplayer (
+        void
+    );
+
+    ~CaptureReplayer (
+        void
+    );
+
+    /*!
+     * \brief Unmap the capture file
+     */
+    void
+    close (
+        void
+    );
+
+    /*!
+     * \brief The first record of the capture
+     *
+     * \return The record, or `nullptr` when the capture holds no records
+     */
+    const CaptureRecord *
+    first (
+        void
+    ) const;
+
+    /*!
+     * \brief The header of the capture
+     *
+     * \return The header, or `nullptr` when no capture is open
+     */
+    const CaptureFileHeader *
+    header (
+        void
+    ) const;
+
+    /*!
+     * \brief The record following a record
+     *
+     * \return The record, or `nullptr` at the end of the capture (including
+     *         a final record cut short)
+     */
+    const CaptureRecord *
+    next (
+        const CaptureRecord * record_
+    ) const;
+
+    /*!
+     * \brief Map a capture file, and validate its header
+     *
+     * \param [in] path_ The path of the capture file
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     */
+    int
+    open (
+        const char * path_
+    );
+
+    /*!
+     * \brief The payload of a record
+     */
+    static
+    const uint8_t *
+    payload (
+        const CaptureRecord * record_
+    );
+
+    /*!
+     * \brief Feed the bytes a stream received to the host
+     *
+     * \param [in] stream_id_ The stream of the capture to replay
+     * \param [in] upon_bytes_ Invoked with the payload of each record
+     * \param [in] context_ A context supplied to the callback when called
+     * \param [in] speed_ A multiple of the recorded pace (i.e. `WIRE_SPEED`),
+     *                    or `AS_FAST_AS_POSSIBLE` to ignore the timestamps
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *
+     * \note Bytes the host sent are not replayed, because the host under
+     *       test sends its own.
+     */
+    int
+    replay (
+        const uint16_t stream_id_,
+        replayBytes upon_bytes_,
+        void * context_,
+        const double speed_ = AS_FAST_AS_POSSIBLE
+    ) const;
+
+  private:
+    const uint8_t * _data;
+    size_t _size;
+
+    const CaptureRecord *
+    recordAt (
+        const size_t offset_
+    ) const;
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // CAPTURE_REPLAYER_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
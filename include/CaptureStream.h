@@ -0,0 +1,131 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef CAPTURE_STREAM_H
+#define CAPTURE_STREAM_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "CaptureRecorder.h"
+#include "Stream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief A stream that records the traffic passing through another stream
+ *
+ * The bytes read and written through the capture stream are gathered into
+ * records and handed to a `CaptureRecorder`. Bytes received are recorded
+ * once per serial event, and bytes sent are recorded once per message
+ * (a record is closed as each status byte begins the next message).
+ *
+ * \note The last message sent is held until the next message, the next
+ *       serial event, `flush` or `end`. Like any stream, the capture stream
+ *       expects a single reader; writers may share it.
+ */
+class CaptureStream : public Stream {
+  public:
+    static const size_t PENDING_SIZE = 256;
+
+    /*!
+     * \param [in] stream_ The stream to observe
+     * \param [in] recorder_ The recorder receiving the traffic
+     * \param [in] stream_id_ The id under which the traffic is recorded
+     */
+    CaptureStream (
+        Stream & stream_,
+        CaptureRecorder & recorder_,
+        const uint16_t stream_id_
+    );
+
+    ~CaptureStream (
+        void
+    );
+
+    size_t
+    available (
+        void
+    ) override;
+
+    void
+    begin (
+        const size_t speed_,
+        const size_t config_
+    ) override;
+
+    void
+    end (
+        void
+    ) override;
+
+    void
+    flush (
+        void
+    ) override;
+
+    int
+    peek (
+        void
+    ) override;
+
+    int
+    read (
+        void
+    ) override;
+
+    void
+    registerSerialEventCallback (
+        serialEvent upon_read_,
+        void * context_
+    ) override;
+
+    size_t
+    write (
+        uint8_t byte_
+    ) override;
+
+  private:
+    struct Pending {
+        uint8_t data[PENDING_SIZE];
+        std::chrono::steady_clock::time_point observed_at;
+        size_t size;
+    };
+
+    std::mutex _mutex;
+    CaptureRecorder & _recorder;
+    Pending _rx;
+    serialEvent _serial_event_callback;
+    void * _serial_event_context;
+    Stream & _stream;
+    const uint16_t _stream_id;
+    Pending _tx;
+
+    void
+    append (
+        Pending & pending_,
+        const CaptureDirection direction_,
+        const uint8_t byte_
+    );
+
+    void
+    emit (
+        Pending & pending_,
+        const CaptureDirection direction_
+    );
+
+    static
+    void
+    serialEventCallback (
+        void * context_
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // CAPTURE_STREAM_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,173 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef CONTRACT_CACHE_H
+#define CONTRACT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "DeviceContract.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief A persistent cache of device contracts keyed by firmware identity
+ *
+ * The cache is a single binary file that is memory-mapped on `load`, so
+ * a previously acquired contract is available without a round trip to the
+ * remote device. Entries are keyed by the firmware name and version, and
+ * carry a fingerprint of the pin table to detect when the contract reported
+ * by the device has changed.
+ *
+ * File layout (native byte order):
+ *
+ *     FileHeader | EntryHeader[entry_count] | uint32_t pin tables
+ *
+ * \note All methods are safe to call from multiple threads, so a single
+ *       cache may be shared by every query in the process.
+ * \note Several caches (or processes) may store to one file; each store
+ *       holds an exclusive lock on a `.lock` file beside the cache file.
+ */
+class ContractCache {
+  public:
+    static const size_t FIRMWARE_NAME_SIZE = 32;
+
+    ContractCache (
+        const char * file_path_
+    );
+
+    ~ContractCache (
+        void
+    );
+
+    /*!
+     * \brief Compute the fingerprint of a pin table
+     *
+     * \param [in] pin_data_ The encoded pin configurations
+     * \param [in] pin_count_ The number of pins in the table
+     *
+     * \return A 32-bit FNV-1a hash of the table
+     */
+    static
+    uint32_t
+    fingerprint (
+        const pin_config_t * pin_data_,
+        const size_t pin_count_
+    );
+
+    /*!
+     * \brief Map the cache file into memory
+     *
+     * \return If an error occurred, then a non-zero value will be returned.
+     *
+     * \note A missing file is not an error; the cache is simply empty.
+     */
+    int
+    load (
+        void
+    );
+
+    /*!
+     * \brief Look up the contract for a firmware identity
+     *
+     * \param [in] firmware_name_ The name reported by the firmware
+     * \param [in] major_ The major version of the firmware
+     * \param [in] minor_ The minor version of the firmware
+     * \param [out] pin_data_ The buffer to receive the pin table (may be `nullptr`)
+     * \param [in] pin_data_size_ The number of pins `pin_data_` can hold
+     * \param [out] fingerprint_ The fingerprint of the cached table
+     *
+     * \return The number of pins in the cached table, or zero on a miss
+     */
+    size_t
+    lookup (
+        const char * firmware_name_,
+        const size_t major_,
+        const size_t minor_,
+        pin_config_t * pin_data_,
+        const size_t pin_data_size_,
+        uint32_t * fingerprint_
+    ) const;
+
+    /*!
+     * \brief Insert or replace the contract for a firmware identity
+     *
+     * Under an exclusive lock, the file is mapped again, so the entries
+     * stored by every other writer are carried over. It is then rewritten to
+     * a uniquely named file beside the original, atomically renamed into
+     * place and mapped again.
+     *
+     * \return If an error occurred, then a non-zero value will be returned.
+     *
+     * \note Versions above 255 cannot be stored, and are rejected.
+     */
+    int
+    store (
+        const char * firmware_name_,
+        const size_t major_,
+        const size_t minor_,
+        const pin_config_t * pin_data_,
+        const size_t pin_count_
+    );
+
+  private:
+    struct FileHeader {
+        char magic[4];
+        uint16_t format_version;
+        uint16_t entry_count;
+    };
+
+    struct EntryHeader {
+        char firmware_name[FIRMWARE_NAME_SIZE];
+        uint8_t major;
+        uint8_t minor;
+        uint16_t pin_count;
+        uint32_t fingerprint;
+        uint32_t pin_offset;
+    };
+
+    const char * const _file_path;
+    mutable std::mutex _mutex;
+    const uint8_t * _mapping;
+    size_t _mapping_size;
+
+    const EntryHeader *
+    findEntry (
+        const char * firmware_name_,
+        const size_t major_,
+        const size_t minor_
+    ) const;
+
+    int
+    mapFile (
+        void
+    );
+
+    /*!
+     * \brief Rewrite the mapped entries, and the new entry, to the file
+     *
+     * \note The caller must hold the file lock.
+     */
+    int
+    rewriteFile (
+        const char * firmware_name_,
+        const size_t major_,
+        const size_t minor_,
+        const pin_config_t * pin_data_,
+        const size_t pin_count_
+    );
+
+    void
+    unmapFile (
+        void
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // CONTRACT_CACHE_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,93 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef CONTRACT_REGISTRY_H
+#define CONTRACT_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "BufferAllocator.h"
+#include "DeviceContract.h"
+#include "FirmataContract.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Interns immutable contracts by the content of their pin tables
+ *
+ * Every board reporting an identical pin table receives a reference to the
+ * same `FirmataContract`, so a fleet of identical boards holds one copy,
+ * and two interned contracts are equal exactly when their pointers are
+ * equal. The registry only holds weak references; a contract is released
+ * once the last board sharing it lets go.
+ *
+ * A contract lives in the memory of the allocator it was interned with, so
+ * contracts are only shared between callers passing the same allocator; a
+ * shared contract never outlives the pool of a caller it was not given by.
+ *
+ * \note All methods are safe to call from multiple threads, so a single
+ *       registry may be shared by every query in the process.
+ */
+class ContractRegistry {
+  public:
+    ContractRegistry (
+        void
+    );
+
+    /*!
+     * \brief The registry shared by the process
+     */
+    static
+    ContractRegistry &
+    global (
+        void
+    );
+
+    /*!
+     * \brief Obtain the shared contract for a pin table
+     *
+     * \param [in] pin_data_ The encoded pin configurations
+     * \param [in] pin_count_ The number of pins in the table
+     * \param [in] allocator_ The allocator used when the contract is new,
+     *                        and which a shared contract must have come from
+     *
+     * \return The shared contract, or `nullptr` when allocation fails
+     *
+     * \note A table already interned is matched in place, by fingerprint and
+     *       then pin by pin, so sharing its contract allocates nothing.
+     */
+    std::shared_ptr<const FirmataContract>
+    intern (
+        const pin_config_t * pin_data_,
+        const size_t pin_count_,
+        BufferAllocator & allocator_ = BufferAllocator::heap()
+    );
+
+    /*!
+     * \brief The number of distinct contracts still referenced
+     */
+    size_t
+    size (
+        void
+    ) const;
+
+  private:
+    struct Entry {
+        const BufferAllocator * allocator;
+        std::weak_ptr<const FirmataContract> contract;
+    };
+
+    std::unordered_multimap<uint32_t, Entry> _contracts;
+    mutable std::mutex _mutex;
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // CONTRACT_REGISTRY_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
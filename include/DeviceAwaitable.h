@@ -0,0 +1,234 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef DEVICE_AWAITABLE_H
+#define DEVICE_AWAITABLE_H
+
+#if defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <map>
+#include <memory>
+
+#include "Stream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+struct DeviceContract;
+struct DeviceQuery;
+class PinStateMirror;
+struct PinStateReport;
+
+/*!
+ * \brief Resumes a coroutine from a protocol callback
+ *
+ * A request/response exchange is started from `await_suspend`, and its
+ * completion callback (i.e. a parser callback) calls `resume`. Whichever
+ * of the two arrives last resumes the coroutine, so an exchange that
+ * completes before `await_suspend` returns (i.e. from a cache) continues
+ * without suspending, and no thread ever blocks waiting for the response.
+ *
+ * An exchange may also be given a deadline, so a remote device that never
+ * answers cannot leave the coroutine suspended forever. A single timer
+ * thread, started on first use, serves the deadlines of every awaitable.
+ */
+class AwaitableCompletion {
+  public:
+    typedef bool(*exchangeExpired)(void * context_);
+
+    AwaitableCompletion (
+        void
+    );
+
+    /*!
+     * \brief Resume the coroutine at a deadline, unless the exchange completes
+     *
+     * \param [in] deadline_ The time at which the exchange expires
+     * \param [in] upon_expiry_ Called at the deadline to withdraw the exchange,
+     *                         returning `true` when it was withdrawn (the
+     *                         coroutine is then resumed on the timer thread)
+     * \param [in] context_ A context supplied to the callback when called
+     *
+     * \note `upon_expiry_` is called with the timer locked, so it must not
+     *       block, and must not arm or disarm a deadline.
+     */
+    void
+    armDeadline (
+        const std::chrono::steady_clock::time_point deadline_,
+        exchangeExpired upon_expiry_,
+        void * context_
+    );
+
+    /*!
+     * \brief Cancel the deadline
+     *
+     * \note Once this call returns, `upon_expiry_` will not be called.
+     */
+    void
+    disarmDeadline (
+        void
+    );
+
+    /*!
+     * \brief Signal the exchange has completed
+     *
+     * \note Called from the completion callback, on whichever thread
+     *       raised it; the coroutine resumes on that thread.
+     */
+    void
+    resume (
+        void
+    );
+
+    /*!
+     * \brief Decide whether to suspend, once the exchange has started
+     *
+     * \param [in] coroutine_ The awaiting coroutine
+     *
+     * \return `true` to suspend the coroutine, or `false` when the exchange
+     *         has already completed
+     */
+    bool
+    suspend (
+        std::coroutine_handle<> coroutine_
+    );
+
+  private:
+    class Timer;
+    typedef std::multimap<std::chrono::steady_clock::time_point, AwaitableCompletion *> deadline_map;
+
+    std::atomic_bool _arrived;
+    bool _armed;  // Guarded by the timer
+    std::coroutine_handle<> _coroutine;
+    deadline_map::iterator _deadline;
+    void * _expiry_context;
+    exchangeExpired _upon_expiry;
+};
+
+/*!
+ * \brief Awaits the capability contract of a remote device
+ *
+ * \code
+ * std::unique_ptr<DeviceContract> contract = co_await query.contract(stream);
+ * \endcode
+ *
+ * The result is the owned contract, or `nullptr` when the query could not
+ * be started, or the device did not answer before the timeout. The timeout
+ * is only honored when the query can be cancelled.
+ *
+ * \sa DeviceQuery::contract
+ */
+class ContractAwaitable {
+  public:
+    typedef std::chrono::steady_clock::duration duration;
+
+    ContractAwaitable (
+        DeviceQuery & query_,
+        Stream * stream_,
+        const duration timeout_
+    );
+
+    bool
+    await_ready (
+        void
+    ) const noexcept;
+
+    std::unique_ptr<DeviceContract>
+    await_resume (
+        void
+    );
+
+    bool
+    await_suspend (
+        std::coroutine_handle<> coroutine_
+    );
+
+  private:
+    AwaitableCompletion _completion;
+    int _error;
+    DeviceQuery & _query;
+    Stream * const _stream;
+    const duration _timeout;
+
+    static
+    bool
+    contractExpired (
+        void * context_
+    );
+
+    static
+    void
+    contractReadyCallback (
+        void * context_
+    );
+};
+
+/*!
+ * \brief Awaits the state of a pin, as reported by the remote device
+ *
+ * \code
+ * PinStateReport report = co_await mirror.pinState(13);
+ * \endcode
+ *
+ * The result is the mode and state of the pin recorded by the mirror, with
+ * a mode of `PinStateMirror::UNKNOWN_MODE` when the query could not be sent,
+ * or the device did not answer before the timeout.
+ *
+ * \sa PinStateMirror::pinState
+ */
+class PinStateAwaitable {
+  public:
+    typedef std::chrono::steady_clock::duration duration;
+
+    PinStateAwaitable (
+        PinStateMirror & mirror_,
+        const size_t pin_,
+        const duration timeout_
+    );
+
+    bool
+    await_ready (
+        void
+    ) const noexcept;
+
+    PinStateReport
+    await_resume (
+        void
+    );
+
+    bool
+    await_suspend (
+        std::coroutine_handle<> coroutine_
+    );
+
+  private:
+    AwaitableCompletion _completion;
+    int _error;
+    PinStateMirror & _mirror;
+    const size_t _pin;
+    const duration _timeout;
+
+    static
+    bool
+    pinStateExpired (
+        void * context_
+    );
+
+    static
+    void
+    pinStateReported (
+        void * context_,
+        size_t pin_
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // __cpp_impl_coroutine
+
+#endif // DEVICE_AWAITABLE_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -6,16 +6,20 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "PinSet.h"
+
 namespace remote_wiring {
 namespace protocol {
 
 typedef uint_fast32_t pin_config_t;
 
-extern const pin_config_t ANALOG_READ;
-extern const pin_config_t ANALOG_WRITE;
-extern const pin_config_t DIGITAL_READ;
-extern const pin_config_t DIGITAL_READ_WITH_PULLUP;
-extern const pin_config_t DIGITAL_WRITE;
+constexpr pin_config_t ANALOG_READ = 0x01;
+constexpr pin_config_t ANALOG_WRITE = 0x02;
+constexpr pin_config_t DIGITAL_READ = 0x04;
+constexpr pin_config_t DIGITAL_READ_WITH_PULLUP = 0x08;
+constexpr pin_config_t DIGITAL_WRITE = 0x10;
+
+constexpr size_t NO_ANALOG_CHANNEL = 0x7F;
 
 /*!
  * \brief Describes the capabilities and configuration of a pin
@@ -59,6 +63,24 @@ struct DeviceContract {
 
     }
 
+    /*!
+     * \brief Describes the analog channel of a pin
+     *
+     * \param [in] pin_ The number of the pin to check
+     *
+     * \return The channel reported for the pin in analog messages, or
+     *         `NO_ANALOG_CHANNEL` when the pin has no analog channel (or the
+     *         contract does not describe the analog mapping)
+     */
+    virtual
+    size_t
+    analogChannelForPin (
+        const size_t pin_
+    ) const {
+        (void)pin_;
+        return NO_ANALOG_CHANNEL;
+    }
+
     /*!
      * \brief Describes whether a pin has an analog read capability
      *
@@ -178,6 +200,68 @@ struct DeviceContract {
      pinCount (
         void
      ) const = 0;
+    /*!
+     * \brief Find every pin supporting a set of capabilities
+     *
+     * \param [in] capabilities_ A bitwise-or of capabilities (i.e.
+     *                           `ANALOG_WRITE | DIGITAL_READ`)
+     *
+     * \return The set of pins supporting all of the capabilities
+     *
+     * \note The default implementation tests each pin individually;
+     *       implementations are encouraged to answer from bitmaps.
+     */
+    virtual
+    PinSet
+    pinsWithCapability (
+        const pin_config_t capabilities_
+    ) const {
+        PinSet pins;
+
+        for (size_t pin = 0 ; (pin < pinCount()) && (pin < PinSet::CAPACITY) ; ++pin) {
+            if ( (capabilities_ & ANALOG_READ) && !analogReadAvailableOnPin(pin) ) { continue; }
+            if ( (capabilities_ & ANALOG_WRITE) && !analogWriteAvailableOnPin(pin) ) { continue; }
+            if ( (capabilities_ & DIGITAL_READ) && !digitalReadAvailableOnPin(pin) ) { continue; }
+            if ( (capabilities_ & DIGITAL_READ_WITH_PULLUP) && !digitalReadPullupAvailableOnPin(pin) ) { continue; }
+            if ( (capabilities_ & DIGITAL_WRITE) && !digitalWriteAvailableOnPin(pin) ) { continue; }
+            pins.insert(pin);
+        }
+
+        return pins;
+    }
+
+    /*!
+     * \brief Count the pins supporting a set of capabilities
+     *
+     * \param [in] capabilities_ A bitwise-or of capabilities
+     *
+     * \return The number of pins supporting all of the capabilities
+     */
+    virtual
+    size_t
+    countPinsWithCapability (
+        const pin_config_t capabilities_
+    ) const {
+        return pinsWithCapability(capabilities_).count();
+    }
+
+    /*!
+     * \brief Describes whether every pin in a set supports a set of capabilities
+     *
+     * \param [in] capabilities_ A bitwise-or of capabilities
+     * \param [in] pins_ The pins to test
+     *
+     * \return A `bool` that indicates `true` when every pin supports every
+     *         capability and `false` otherwise
+     */
+    virtual
+    bool
+    capabilityAvailableOnPins (
+        const pin_config_t capabilities_,
+        const PinSet & pins_
+    ) const {
+        return pins_.isSubsetOf(pinsWithCapability(capabilities_));
+    }
 };
 
 } // protocol
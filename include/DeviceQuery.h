@@ -3,12 +3,16 @@
 #ifndef DEVICE_QUERY_H
 #define DEVICE_QUERY_H
 
+#include <chrono>
+
+#include "DeviceAwaitable.h"
 #include "Stream.h"
 
 namespace remote_wiring {
 namespace protocol {
 
 struct DeviceContract;
+class QueryMetrics;
 
 /*!
  * \brief An interface for requesting and processing the capabilities of a remote device.
@@ -23,6 +27,57 @@ struct DeviceQuery {
 
     }
 
+    /*!
+     * \brief Withdraw the contract ready callback of the query in progress
+     *
+     * \return `true` when the callback will not be invoked, or `false` when
+     *         it has been (or is being) invoked, or the query cannot be
+     *         cancelled
+     *
+     * \note The default cannot cancel, so a query must override this for the
+     *       timeout of `contract()` to take effect.
+     */
+    virtual
+    bool
+    cancelContractQuery (
+        void
+    ) {
+        return false;
+    }
+
+#if defined(__cpp_impl_coroutine)
+    /*!
+     * \brief Await the device capability contract
+     *
+     * \param [in] stream_ The underlying serial stream that provides a connection
+     *                     to the remote device
+     * \param [in] timeout_ The time allowed for the device to report its
+     *                      contract (i.e. to boot)
+     *
+     * \return An awaitable, resumed by the contract ready callback, whose
+     *         result is the owned `DeviceContract` (or `nullptr` on error)
+     *
+     * \note The coroutine resumes on the thread that raises the callback
+     *       (i.e. the serial event or parser thread), or upon the timeout on
+     *       the timer thread, once the query has been cancelled.
+     *
+     * \warning The timeout requires a query that overrides
+     *          `cancelContractQuery()` (e.g. `FirmataQuery`). Otherwise the
+     *          deadline is ignored, and the coroutine waits for the contract
+     *          ready callback, which may never come from a silent device.
+     *
+     * \sa DeviceQuery::cancelContractQuery
+     * \sa DeviceQuery::queryContractAsync
+     */
+    ContractAwaitable
+    contract (
+        Stream * stream_,
+        const std::chrono::steady_clock::duration timeout_ = std::chrono::seconds(10)
+    ) {
+        return ContractAwaitable(*this, stream_, timeout_);
+    }
+#endif
+
     /*!
      * \brief Query the device capability contract
      *
@@ -33,6 +88,9 @@ struct DeviceQuery {
      * \param [in] callback_context_ A context supplied to the callback when called
      *
      * \return If an error occurred, then a non-zero value will be returned.
+     *
+     * \warning The query may hold the stream until the query is destroyed,
+     *          so the stream must outlive the query.
      */
     virtual
     int
@@ -61,6 +119,22 @@ struct DeviceQuery {
         void
     ) = 0;
 
+    /*!
+     * \brief Get the metrics collected by the query
+     *
+     * \return A pointer to the metrics, or `nullptr` when the query does
+     *         not collect metrics
+     *
+     * \sa remote_wiring::protocol::QueryMetrics
+     */
+    virtual
+    const QueryMetrics *
+    getMetrics (
+        void
+    ) const {
+        return nullptr;
+    }
+
     /*!
      * \brief Get the pointer to the underlying stream
      *
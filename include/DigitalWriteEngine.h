@@ -0,0 +1,114 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef DIGITAL_WRITE_ENGINE_H
+#define DIGITAL_WRITE_ENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <FirmataMarshaller.h>
+
+#include "DeviceContract.h"
+#include "PinSet.h"
+#include "Stream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Coalesces digital writes into one DIGITAL_MESSAGE per port
+ *
+ * `digitalWrite` only records the desired level of a pin, and marks its
+ * 8-pin port dirty. `flush` (called once per tick) sends a single
+ * DIGITAL_MESSAGE for each dirty port. A write that leaves its port as it
+ * was last sent is dropped, so toggling 40 outputs costs 5 messages rather
+ * than 40, and rewriting a level costs nothing.
+ *
+ * \note Every output is assumed to be low until it is written, as it is
+ *       after the remote device resets.
+ */
+class DigitalWriteEngine {
+  public:
+    static const size_t PORT_COUNT = (PinSet::CAPACITY / 8);
+
+    /*!
+     * \param [in] contract_ The contract used to validate writes
+     */
+    DigitalWriteEngine (
+        const DeviceContract & contract_
+    );
+
+    /*!
+     * \brief Begin sending messages on a stream
+     *
+     * \param [in] stream_ The stream connected to the remote device
+     */
+    void
+    begin (
+        Stream & stream_
+    );
+
+    /*!
+     * \brief Set the level of an output pin, upon the next `flush`
+     *
+     * \param [in] pin_ The pin to write
+     * \param [in] value_ The level of the pin
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (i.e. the pin does not support digital write)
+     */
+    int
+    digitalWrite (
+        const size_t pin_,
+        const bool value_
+    );
+
+    /*!
+     * \brief Send one DIGITAL_MESSAGE for each dirty port
+     *
+     * \return The number of messages sent
+     */
+    size_t
+    flush (
+        void
+    );
+
+    /*!
+     * \brief The total number of DIGITAL_MESSAGEs sent
+     */
+    size_t
+    messagesSent (
+        void
+    ) const;
+
+    /*!
+     * \brief The total number of writes that did not change a pin
+     */
+    size_t
+    writesDropped (
+        void
+    ) const;
+
+  private:
+    PinSet _desired;
+    uint16_t _dirty_ports;
+    firmata::FirmataMarshaller _marshaller;
+    size_t _messages_sent;
+    PinSet _sent;
+    const PinSet _writable;
+    size_t _writes_dropped;
+
+    static
+    uint8_t
+    portValue (
+        const PinSet & pins_,
+        const size_t port_
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // DIGITAL_WRITE_ENGINE_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,148 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef FD_STREAM_H
+#define FD_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "Stream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief A stream over a POSIX file descriptor (i.e. a tty or pty)
+ *
+ * Unlike a transport that owns a reader thread, an `FdStream` only reads
+ * when `service` is called. The owner (i.e. a `SerialReactor`) decides when
+ * the descriptor is readable, so many streams can share a single thread.
+ *
+ * \note The stream does not own the descriptor. `service`, `available`,
+ *       `peek` and `read` must not be called concurrently; the reactor
+ *       guarantees a stream is serviced by one worker at a time.
+ */
+class FdStream : public Stream {
+  public:
+    FdStream (
+        const int fd_
+    );
+
+    ~FdStream (
+        void
+    );
+
+    size_t
+    available (
+        void
+    ) override;
+
+    /*!
+     * \brief Place the descriptor in non-blocking, raw mode
+     *
+     * \param [in] speed_ The baud rate (i.e. 57600), or zero to keep the
+     *                    current rate
+     * \param [in] config_ The frame format, encoded as the Arduino
+     *                     `SERIAL_8N1` family (i.e. 0x06)
+     *
+     * \note Descriptors that are not terminals (i.e. pipes) are only placed
+     *       in non-blocking mode.
+     */
+    void
+    begin (
+        const size_t speed_,
+        const size_t config_
+    ) override;
+
+    void
+    end (
+        void
+    ) override;
+
+    /*!
+     * \brief The underlying file descriptor
+     */
+    int
+    fd (
+        void
+    ) const;
+
+    void
+    flush (
+        void
+    ) override;
+
+    int
+    peek (
+        void
+    ) override;
+
+    int
+    read (
+        void
+    ) override;
+
+    void
+    registerSerialEventCallback (
+        serialEvent upon_read_,
+        void * context_
+    ) override;
+
+    /*!
+     * \brief Drain the descriptor and raise a serial event
+     *
+     * \return The number of bytes read, or -1 when the descriptor has been
+     *         closed by the remote end or has failed
+     */
+    int
+    service (
+        void
+    );
+
+    /*!
+     * \brief Write a byte, waiting for the descriptor to accept it
+     *
+     * \return The number of bytes written, which is zero only when the
+     *         descriptor has failed (i.e. the remote end hung up)
+     *
+     * \note The marshaller ignores the result of each write, so a full
+     *       descriptor must not drop a byte from the middle of a message.
+     */
+    size_t
+    write (
+        uint8_t byte_
+    ) override;
+
+    /*!
+     * \brief Write a run of bytes with a single system call
+     *
+     * \param [in] data_ The bytes to write
+     * \param [in] size_ The number of bytes to write
+     *
+     * \return The number of bytes written, which is short of `size_` when
+     *         the descriptor cannot accept more without blocking, or -1 when
+     *         the descriptor has failed (i.e. the remote end hung up)
+     */
+    ssize_t
+    write (
+        const uint8_t * data_,
+        const size_t size_
+    );
+
+  private:
+    const int _fd;
+    std::vector<uint8_t> _rx;
+    size_t _rx_head;
+    serialEvent _serial_event_callback;
+    void * _serial_event_context;
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // FD_STREAM_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,101 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef FIRMATA_BOARDS_H
+#define FIRMATA_BOARDS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "DeviceContract.h"
+
+namespace remote_wiring {
+namespace protocol {
+namespace boards {
+
+/*!
+ * \brief The pin configurations StandardFirmata reports for common pins
+ *
+ * These mirror the capability and analog mapping responses, where the
+ * `reserved` field holds the analog channel (or 0x7F when the pin has no
+ * analog channel).
+ */
+constexpr PinConfig unavailablePin (void) { return PinConfig{ 0, 0, 0, 0x7F }; }
+constexpr PinConfig digitalPin (void) { return PinConfig{ (DIGITAL_READ | DIGITAL_READ_WITH_PULLUP | DIGITAL_WRITE), 0, 0, 0x7F }; }
+constexpr PinConfig pwmPin (void) { return PinConfig{ (ANALOG_WRITE | DIGITAL_READ | DIGITAL_READ_WITH_PULLUP | DIGITAL_WRITE), 0, 8, 0x7F }; }
+constexpr PinConfig analogPin (const pin_config_t channel_) { return PinConfig{ (ANALOG_READ | DIGITAL_READ | DIGITAL_READ_WITH_PULLUP | DIGITAL_WRITE), 10, 0, channel_ }; }
+
+} // boards
+
+/*!
+ * \brief The contract of an Arduino Uno running StandardFirmata
+ */
+struct ArduinoUno {
+    static constexpr size_t PIN_COUNT = 20;
+    static constexpr PinConfig PIN_CONFIG[PIN_COUNT] = {
+        /*  0 */ boards::unavailablePin(), boards::unavailablePin(), boards::digitalPin(), boards::pwmPin(),
+        /*  4 */ boards::digitalPin(), boards::pwmPin(), boards::pwmPin(), boards::digitalPin(),
+        /*  8 */ boards::digitalPin(), boards::pwmPin(), boards::pwmPin(), boards::pwmPin(),
+        /* 12 */ boards::digitalPin(), boards::digitalPin(), boards::analogPin(0), boards::analogPin(1),
+        /* 16 */ boards::analogPin(2), boards::analogPin(3), boards::analogPin(4), boards::analogPin(5)
+    };
+};
+
+/*!
+ * \brief The contract of an Arduino Mega 2560 running StandardFirmata
+ */
+struct ArduinoMega {
+    static constexpr size_t PIN_COUNT = 70;
+    static constexpr PinConfig PIN_CONFIG[PIN_COUNT] = {
+        /*  0 */ boards::unavailablePin(), boards::unavailablePin(), boards::pwmPin(), boards::pwmPin(),
+        /*  4 */ boards::pwmPin(), boards::pwmPin(), boards::pwmPin(), boards::pwmPin(),
+        /*  8 */ boards::pwmPin(), boards::pwmPin(), boards::pwmPin(), boards::pwmPin(),
+        /* 12 */ boards::pwmPin(), boards::pwmPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 16 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 20 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 24 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 28 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 32 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 36 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 40 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 44 */ boards::pwmPin(), boards::pwmPin(), boards::pwmPin(), boards::digitalPin(),
+        /* 48 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 52 */ boards::digitalPin(), boards::digitalPin(), boards::analogPin(0), boards::analogPin(1),
+        /* 56 */ boards::analogPin(2), boards::analogPin(3), boards::analogPin(4), boards::analogPin(5),
+        /* 60 */ boards::analogPin(6), boards::analogPin(7), boards::analogPin(8), boards::analogPin(9),
+        /* 64 */ boards::analogPin(10), boards::analogPin(11), boards::analogPin(12), boards::analogPin(13),
+        /* 68 */ boards::analogPin(14), boards::analogPin(15)
+    };
+};
+
+/*!
+ * \brief The contract of an Arduino Due running StandardFirmata
+ */
+struct ArduinoDue {
+    static constexpr size_t PIN_COUNT = 66;
+    static constexpr PinConfig PIN_CONFIG[PIN_COUNT] = {
+        /*  0 */ boards::unavailablePin(), boards::unavailablePin(), boards::pwmPin(), boards::pwmPin(),
+        /*  4 */ boards::pwmPin(), boards::pwmPin(), boards::pwmPin(), boards::pwmPin(),
+        /*  8 */ boards::pwmPin(), boards::pwmPin(), boards::pwmPin(), boards::pwmPin(),
+        /* 12 */ boards::pwmPin(), boards::pwmPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 16 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 20 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 24 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 28 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 32 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 36 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 40 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 44 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 48 */ boards::digitalPin(), boards::digitalPin(), boards::digitalPin(), boards::digitalPin(),
+        /* 52 */ boards::digitalPin(), boards::digitalPin(), boards::analogPin(0), boards::analogPin(1),
+        /* 56 */ boards::analogPin(2), boards::analogPin(3), boards::analogPin(4), boards::analogPin(5),
+        /* 60 */ boards::analogPin(6), boards::analogPin(7), boards::analogPin(8), boards::analogPin(9),
+        /* 64 */ boards::analogPin(10), boards::analogPin(11)
+    };
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // FIRMATA_BOARDS_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -6,16 +6,39 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "BufferAllocator.h"
 #include "DeviceContract.h"
 
 namespace remote_wiring {
 namespace protocol {
 
+class ContractRegistry;
 class FirmataQuery;
 
+/*!
+ * \brief An immutable contract, decoded from a Firmata pin table
+ *
+ * \note Contracts may be interned by a `ContractRegistry`, so identical
+ *       boards share a single instance.
+ */
 class FirmataContract : public DeviceContract {
+  friend ContractRegistry;
   friend FirmataQuery;
   public:
+    /*!
+     * \brief Return the contract to the allocator it was created from
+     */
+    static
+    void
+    operator delete (
+        void * contract_
+    );
+
+    size_t
+    analogChannelForPin (
+        const size_t pin_
+    ) const override;
+
     bool
     analogReadAvailableOnPin (
         const size_t pin_
@@ -36,6 +59,24 @@ class FirmataContract : public DeviceContract {
         const size_t pin_
     ) const override;
 
+    /*!
+     * \brief Whether the contract was decoded from an equal pin table
+     *
+     * \param [in] pin_data_ The encoded pin configurations
+     * \param [in] pin_count_ The number of pins in the table
+     *
+     * \return `true` when decoding the table would yield an equal contract
+     *
+     * \note The table is compared in place, without decoding a contract.
+     *       Compare fingerprints first, because equal contracts also share
+     *       a fingerprint.
+     */
+    bool
+    describes (
+        const pin_config_t * pin_data_,
+        const size_t pin_count_
+    ) const;
+
     bool
     digitalReadAvailableOnPin (
         const size_t pin_
@@ -51,12 +92,64 @@ class FirmataContract : public DeviceContract {
         const size_t pin_
     ) const override;
 
+    /*!
+     * \brief A hash of the pin table the contract was decoded from
+     *
+     * \return The fingerprint recorded by the `ContractCache` for the same
+     *         pin table, so contracts (and firmware drift) can be compared
+     *         across a fleet with a single integer comparison
+     */
+    uint32_t
+    fingerprint (
+        void
+    ) const;
+
     size_t
     pinCount (
        void
     ) const override;
 
+    PinSet
+    pinsWithCapability (
+        const pin_config_t capabilities_
+    ) const override;
+
+    bool
+    operator== (
+        const FirmataContract & other_
+    ) const;
+
+    bool
+    operator!= (
+        const FirmataContract & other_
+    ) const;
+
   private:
+    static const size_t CAPABILITY_COUNT = 5;
+
+    // Precedes each contract, so `delete` can find the originating allocator
+    union AllocationHeader {
+        struct {
+            BufferAllocator * allocator;
+            size_t size;
+        } block;
+        std::max_align_t alignment;
+    };
+
+    static
+    void *
+    operator new (
+        size_t size_,
+        BufferAllocator & allocator_
+    ) noexcept;
+
+    static
+    void
+    operator delete (
+        void * contract_,
+        BufferAllocator & allocator_
+    );
+
     FirmataContract (
         const pin_config_t * const pin_data_,
         const size_t pin_count_
@@ -68,10 +161,16 @@ class FirmataContract : public DeviceContract {
         const size_t capability_,
         const size_t pin_
     ) const {
-        return ((pin_ > _pin_count) && (0x00 != (decodePinConfigFromData(_pin_data[(pin_ - 1)]).supported_modes & capability_)));
+        return _capability_pins[__builtin_ctzll(capability_)].contains(pin_);
     }
 
-    const pin_config_t * const _pin_data;
+    // Capabilities are stored as one pin bitmap per capability bit, alongside
+    // per-pin resolution arrays, so bulk queries reduce to word operations
+    uint8_t _analog_channel[PinSet::CAPACITY];
+    uint8_t _analog_read_resolution_bits[PinSet::CAPACITY];
+    uint8_t _analog_write_resolution_bits[PinSet::CAPACITY];
+    PinSet _capability_pins[CAPABILITY_COUNT];
+    const uint32_t _fingerprint;
     const size_t _pin_count;
 
     static inline
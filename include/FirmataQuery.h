@@ -5,13 +5,26 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include <FirmataMarshaller.h>
 #include <FirmataParser.h>
 
+#include "AnalogSampler.h"
+#include "BufferAllocator.h"
+#include "CapabilityDecoder.h"
+#include "ContractCache.h"
+#include "ContractRegistry.h"
 #include "DeviceContract.h"
 #include "DeviceQuery.h"
+#include "OutboundScheduler.h"
+#include "PinStateMirror.h"
+#include "QueryMetrics.h"
+#include "SpscByteRing.h"
 #include "Stream.h"
 
 namespace remote_wiring {
@@ -19,6 +32,10 @@ namespace protocol {
 
 class FirmataQuery : public DeviceQuery {
   public:
+    typedef void(*pinConfigReady)(void * context_, size_t pin_, const PinConfig & config_);
+
+    static const size_t DEFAULT_PARSER_RING_CAPACITY = 4096;
+
     FirmataQuery (
         void
     );
@@ -27,6 +44,36 @@ class FirmataQuery : public DeviceQuery {
         void
     );
 
+    /*!
+     * \brief Withdraw the contract ready callback of the query in progress
+     *
+     * The future returned by `contractReadyFuture` is made ready as well, so
+     * no waiter is left hanging; `detachDeviceContract` then returns
+     * `nullptr`, until the contract arrives.
+     *
+     * \sa DeviceQuery::cancelContractQuery
+     */
+    bool
+    cancelContractQuery (
+        void
+    ) override;
+
+    /*!
+     * \brief Query the device capability contract without blocking
+     *
+     * Returns as soon as the callbacks are registered, having asked for the
+     * firmware version, in case the remote device reported its version
+     * before the query was attached. Once the remote device reports its
+     * version or firmware, the firmware, capability and analog mapping
+     * queries are sent back-to-back, and the contract completes through the
+     * callback and the future returned by `contractReadyFuture`.
+     *
+     * \warning The query detaches its serial event callback from the stream
+     *          when the query is destroyed, so the stream must outlive the
+     *          query (i.e. declare the stream before the query).
+     *
+     * \sa DeviceQuery::queryContractAsync
+     */
     int
     queryContractAsync (
         Stream * stream_,
@@ -34,36 +81,324 @@ class FirmataQuery : public DeviceQuery {
         void * contract_ready_callback_context_
     ) override;
 
+    /*!
+     * \brief A future that becomes ready with the device contract
+     *
+     * \return A future for the most recent call to `queryContractAsync`
+     */
+    std::shared_future<void>
+    contractReadyFuture (
+        void
+    ) const;
+
     DeviceContract *
     detachDeviceContract (
         void
     ) override;
 
+    /*!
+     * \brief Parse the stream on a dedicated thread
+     *
+     * The serial event callback only copies the available bytes into a
+     * lock-free ring, and returns to the transport immediately. A parser
+     * thread drains the ring and invokes every parser and user callback,
+     * so a slow callback can no longer stall the transport. The parser
+     * thread is only woken when it has gone idle, so a burst of serial
+     * events costs a single wakeup.
+     *
+     * \param [in] ring_capacity_ The capacity of the ring, in bytes
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (i.e. the parser thread is already running)
+     *
+     * \note Must be called before `queryContractAsync`. When the ring is
+     *       full, bytes are dropped and counted in `ring_overruns`. The
+     *       parser cannot tell where bytes went missing: a short channel
+     *       message is resynchronized by the next status byte, but a sysex
+     *       frame keeps buffering until END_SYSEX, so the frame being parsed
+     *       (i.e. a capability response) is corrupted, and may swallow the
+     *       frames that follow the gap. Size the ring for the largest burst
+     *       expected, and query the contract again should `ring_overruns`
+     *       grow while it is acquired.
+     */
+    int
+    enableParserThread (
+        const size_t ring_capacity_ = DEFAULT_PARSER_RING_CAPACITY
+    );
+
+    const QueryMetrics *
+    getMetrics (
+        void
+    ) const override;
+
     Stream *
     getStream (
         void
     ) const override;
 
+    /*!
+     * \brief Supply the allocator for parser buffers, pin tables, contracts
+     *        and the shared state of the contract-ready future
+     *
+     * \param [in] allocator_ The allocator to use (i.e. a `BufferPool`
+     *                        shared by every query in the process)
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (i.e. buffers have already been obtained from another allocator)
+     *
+     * \note Must be called before `queryContractAsync`, and the allocator
+     *       must outlive the query, every contract it detaches and every
+     *       future it hands out
+     */
+    int
+    setAllocator (
+        BufferAllocator & allocator_
+    );
+
+    /*!
+     * \brief Feed the received bytes to an analog sampler
+     *
+     * \param [in] analog_sampler_ The sampler to feed (`nullptr` to detach),
+     *                             which must outlive its attachment
+     *
+     * \note The sampler is fed from the thread that parses the stream.
+     */
+    void
+    setAnalogSampler (
+        AnalogSampler * analog_sampler_
+    );
+
+    /*!
+     * \brief Send the queries through a bulk lane of an outbound scheduler
+     *
+     * \param [in] outbound_scheduler_ The scheduler to write through
+     *                                 (`nullptr` to write to the stream),
+     *                                 which must outlive its attachment
+     *
+     * \note Call before `queryContractAsync`, or while no query is in flight.
+     */
+    void
+    setOutboundScheduler (
+        OutboundScheduler * outbound_scheduler_
+    );
+
+    /*!
+     * \brief Keep a pin state mirror current from PIN_STATE_RESPONSE
+     *
+     * \param [in] pin_state_mirror_ The mirror to update (`nullptr` to
+     *                               detach), which must outlive its attachment
+     */
+    void
+    setPinStateMirror (
+        PinStateMirror * pin_state_mirror_
+    );
+
+    /*!
+     * \brief Set the interval at which the remote device reports samples
+     *
+     * \param [in] interval_ms_ The sampling interval, in milliseconds
+     * \param [in] reason_ The reason for the change, recorded in the metrics
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (i.e. `queryContractAsync` has not been called)
+     *
+     * \note May be called from any thread; writes through the marshaller are
+     *       serialized with the contract queries sent by the parser.
+     */
+    int
+    setSamplingInterval (
+        const uint16_t interval_ms_,
+        const QueryMetrics::SamplingChange reason_ = QueryMetricsSnapshot::SAMPLING_REQUESTED
+    );
+
+    /*!
+     * \brief Stream each pin configuration as soon as it is decoded
+     *
+     * The capability response is decoded as it arrives on the wire, and
+     * the callback is invoked for each pin as soon as its configuration is
+     * complete, well before the contract itself is ready. This allows early
+     * pins to be configured while the remainder of the response and the
+     * analog mapping are still in flight.
+     *
+     * \param [in] pinConfigReadyCallback_ Invoked on the serial event thread
+     *                                     with each pin configuration
+     * \param [in] pin_config_ready_callback_context_ A context supplied to
+     *                                               the callback when called
+     *
+     * \note The analog mapping is not yet known, so the `reserved` field of
+     *       the streamed configurations is zero.
+     */
+    void
+    setPinConfigCallback (
+        pinConfigReady pinConfigReadyCallback_,
+        void * pin_config_ready_callback_context_
+    );
+
+    /*!
+     * \brief Serve the device contract from a persistent cache
+     *
+     * When the firmware identity reported by the remote device is found in
+     * the cache, the contract is ready immediately. The capability and
+     * analog mapping queries still run in the background to revalidate the
+     * cached contract, and the cache is updated when the live contract
+     * differs.
+     *
+     * \param [in] contract_cache_ The cache to consult (`nullptr` to disable)
+     * \param [in] contractRevisedCallback_ A callback to indicate the live
+     *                                      contract differs from the cached
+     *                                      contract previously reported ready
+     * \param [in] contract_revised_callback_context_ A context supplied to
+     *                                               the callback when called
+     *
+     * \note Must be called before `queryContractAsync`
+     */
+    void
+    setContractCache (
+        ContractCache * contract_cache_,
+        contractReady contractRevisedCallback_ = nullptr,
+        void * contract_revised_callback_context_ = nullptr
+    );
+
+    /*!
+     * \brief Share the device contract with every identical board
+     *
+     * \param [in] registry_ The registry interning the contracts
+     *
+     * \return The interned, immutable contract, or `nullptr` when no
+     *         contract is available (i.e. `queryContractAsync` has not
+     *         completed)
+     *
+     * \note Unlike `detachDeviceContract`, ownership is shared; boards with
+     *       identical pin tables, whose queries use the same allocator (see
+     *       `setAllocator`), receive the same instance.
+     */
+    std::shared_ptr<const FirmataContract>
+    shareDeviceContract (
+        ContractRegistry & registry_ = ContractRegistry::global()
+    );
+
   private:
+    static const size_t CHUNK_BUFFER_SIZE = 256;
+
+    BufferAllocator * _allocator;
+    std::atomic<AnalogSampler *> _analog_sampler;
+    uint8_t _analog_mapping[PinSet::CAPACITY];
+    bool _analog_mapping_received;
+    size_t _analog_mapping_size;
+    pin_config_t * _cached_pin;
+    size_t _cached_pin_capacity;
+    size_t _cached_pin_count;
+    uint32_t _cached_fingerprint;
+    CapabilityDecoder _capability_decoder;
+    bool _capability_received;
+    uint8_t _chunk_buffer[CHUNK_BUFFER_SIZE];
+    ContractCache * _contract_cache;
+    std::atomic_bool _contract_cached;
+    std::shared_future<void> _contract_gate;
+    std::atomic_bool _contract_notified;
+    std::atomic_bool _contract_ready;
+    contractReady _contract_ready_callback;
+    void * _contract_ready_callback_context;
+    contractReady _contract_revised_callback;
+    void * _contract_revised_callback_context;
+    std::promise<void> _contract_signal;
+    std::atomic_bool _firmata_ready;
+    size_t _firmware_major;
+    size_t _firmware_minor;
+    char _firmware_name[ContractCache::FIRMWARE_NAME_SIZE];
     firmata::FirmataMarshaller _marshaller;
+    std::recursive_mutex _marshaller_mutex;  // Recursive, as a synchronous stream may reply (and be parsed) within a write
+    QueryMetrics _metrics;
+    OutboundScheduler::Lane * _outbound_lane;
+    OutboundScheduler * _outbound_scheduler;
     firmata::FirmataParser _parser;
     uint8_t * _parser_buffer;
     size_t _parser_buffer_size;
+    std::mutex _parser_mutex;
+    std::unique_ptr<SpscByteRing> _parser_ring;
+    bool _parser_stopping;
+    std::thread _parser_thread;
+    std::atomic_bool _parser_waiting;
+    std::condition_variable _parser_wakeup;
+    pin_config_t * _pin;
+    size_t _pin_capacity;
+    size_t _pin_count;
+    pinConfigReady _pin_config_ready_callback;
+    void * _pin_config_ready_callback_context;
+    std::atomic<PinStateMirror *> _pin_state_mirror;
+    std::chrono::steady_clock::time_point _queries_sent_at;
+    std::chrono::steady_clock::time_point _query_started_at;
     Stream * _stream;
+    CapabilityDecoder _streaming_decoder;
+    enum {
+        STREAM_IDLE,
+        STREAM_SYSEX_COMMAND,
+        STREAM_CAPABILITY_RESPONSE,
+    } _streaming_state;
+
+    void
+    completeContract (
+        void
+    );
+
+    void
+    enqueueFirmataStream (
+        void
+    );
+
+    void
+    notifyContractReady (
+        void
+    );
+
+    void
+    parseChunk (
+        const uint8_t * chunk_,
+        const size_t chunk_size_
+    );
 
     void
     processFirmataStream (
         void
     );
 
-    static std::promise<void> callback_signal;
-    static std::future<void> callback_gate;
-    static void * contract_ready_callback_context;
-    static std::atomic_bool contract_ready;
-    static contractReady contractReadyCallback;
-    static std::atomic_bool firmata_ready;
-    static pin_config_t * pin;
-    static size_t pin_count;
+    int
+    reservePinTable (
+        pin_config_t ** pin_table_,
+        size_t * pin_table_capacity_,
+        const size_t pin_count_
+    );
+
+    void
+    revalidateCachedContract (
+        void
+    );
+
+    void
+    runParserThread (
+        void
+    );
+
+    /*!
+     * \brief Pipeline the contract queries, once the device is known to be running
+     */
+    void
+    sendContractQueries (
+        void
+    );
+
+    void
+    streamCapabilityResponse (
+        const uint8_t * chunk_,
+        const size_t chunk_size_
+    );
+
+    static
+    size_t
+    countCapabilityPins (
+        const size_t argc_,
+        const uint8_t * argv_
+    );
 
     static
     void
@@ -77,6 +412,15 @@ class FirmataQuery : public DeviceQuery {
         void * context_
     );
 
+    static
+    void
+    firmwareReportCallback (
+        void * context_,
+        size_t major_,
+        size_t minor_,
+        const char * firmware_
+    );
+
     static
     void
     queryResponseCallback (
@@ -91,6 +435,22 @@ class FirmataQuery : public DeviceQuery {
     serialEventCallback (
         void * context_
     );
+
+    static
+    void
+    storePinConfig (
+        void * context_,
+        size_t pin_,
+        pin_config_t pin_data_
+    );
+
+    static
+    void
+    streamPinConfig (
+        void * context_,
+        size_t pin_,
+        pin_config_t pin_data_
+    );
 };
 
 } // protocol
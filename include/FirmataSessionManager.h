@@ -0,0 +1,100 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef FIRMATA_SESSION_MANAGER_H
+#define FIRMATA_SESSION_MANAGER_H
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "DeviceContract.h"
+#include "FirmataQuery.h"
+#include "Stream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Acquires the device contracts of many remote devices concurrently
+ *
+ * Each stream added to the manager is paired with its own `FirmataQuery`,
+ * so contract queries against any number of devices may be in flight at
+ * the same time. The total time to acquire every contract is bound by the
+ * slowest device, instead of the sum of all devices.
+ */
+class FirmataSessionManager {
+  public:
+    FirmataSessionManager (
+        void
+    );
+
+    ~FirmataSessionManager (
+        void
+    );
+
+    /*!
+     * \brief Add a stream to the set of managed devices
+     *
+     * \param [in] stream_ The serial stream connected to a remote device
+     *
+     * \return The index of the session associated with the stream
+     *
+     * \warning The stream must outlive the manager.
+     */
+    size_t
+    addStream (
+        Stream * stream_
+    );
+
+    /*!
+     * \brief Detach the device contract acquired for a session
+     *
+     * \param [in] session_ The index of the session returned by `addStream`
+     *
+     * \return A `DeviceContract` or `nullptr` when the contract is unavailable
+     *
+     * \warning The caller will own the memory at the DeviceContract pointer
+     *          that is returned.
+     *
+     * \sa DeviceQuery::detachDeviceContract
+     */
+    DeviceContract *
+    detachDeviceContract (
+        const size_t session_
+    );
+
+    /*!
+     * \brief Query the contracts of all managed devices concurrently
+     *
+     * \param [in] timeout_ The time allowed for all contracts to be acquired
+     *
+     * \return The number of sessions that failed to acquire a contract
+     */
+    size_t
+    queryContracts (
+        const std::chrono::milliseconds timeout_
+    );
+
+    /*!
+     * \brief The number of managed sessions
+     */
+    size_t
+    sessionCount (
+        void
+    ) const;
+
+  private:
+    struct Session {
+        FirmataQuery query;
+        Stream * stream;
+    };
+
+    std::vector<std::unique_ptr<Session>> _sessions;
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // FIRMATA_SESSION_MANAGER_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,61 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef MESSAGE_FRAMER_H
+#define MESSAGE_FRAMER_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Finds the message boundaries in a stream of outbound bytes
+ *
+ * The marshaller writes each message one byte at a time. The framer is fed
+ * the same bytes, and reports where each message begins and ends, using the
+ * length implied by its status byte (or END_SYSEX for sysex messages).
+ */
+class MessageFramer {
+  public:
+    enum Boundary : unsigned {
+        MESSAGE_CONTINUES = 0x0,
+        MESSAGE_BEGINS = 0x1,  // Every byte before this byte belongs to a complete message
+        MESSAGE_ENDS = 0x2,    // This byte completes a message
+    };
+
+    MessageFramer (
+        void
+    );
+
+    /*!
+     * \brief The number of data bytes following a status byte
+     *
+     * \return The count, or `SIZE_MAX` when the message runs until END_SYSEX
+     */
+    static
+    size_t
+    dataBytes (
+        const uint8_t status_
+    );
+
+    /*!
+     * \brief Feed the next byte of the stream
+     *
+     * \return The `Boundary` flags describing the byte
+     */
+    unsigned
+    push (
+        const uint8_t byte_
+    );
+
+  private:
+    size_t _bytes_remaining;  // Data bytes the message in progress awaits, or `SIZE_MAX` for sysex
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // MESSAGE_FRAMER_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
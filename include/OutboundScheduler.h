@@ -0,0 +1,346 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef OUTBOUND_SCHEDULER_H
+#define OUTBOUND_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FdStream.h"
+#include "MessageFramer.h"
+#include "QueryMetrics.h"
+#include "Stream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Orders the messages of several writers sharing one serial link
+ *
+ * Each writer is given a lane, which is a stream its marshaller writes to.
+ * A lane gathers bytes until a message is complete, then queues the whole
+ * message under the priority class of the lane. A dispatcher thread writes
+ * queued messages to the underlying stream, one whole message at a time, so
+ * messages are never interleaved mid-message:
+ *
+ * - the classes are served in strict priority order, so a control write
+ *   waits for no more than the message already being written, and
+ * - the lanes of a class are served by deficit round robin, so each lane
+ *   receives a fair share of the bytes sent for its class.
+ *
+ * Each class holds a bounded number of queued bytes, beyond which its
+ * writers block, so a bulk writer is held to the pace of the link without
+ * delaying the other classes.
+ *
+ * \note The scheduler can only reorder the messages it holds. Bytes handed
+ *       to the underlying stream are committed, so the stream should buffer
+ *       little of its own.
+ * \note A class served ahead of another may starve it, should the link be
+ *       saturated by the higher class alone.
+ */
+class OutboundScheduler {
+  public:
+    class Lane;
+
+    enum PriorityClass {
+        PRIORITY_CONTROL = 0,  // Safety-relevant writes (i.e. digital and analog writes)
+        PRIORITY_NORMAL,       // Configuration (i.e. pin modes, reporting)
+        PRIORITY_BULK,         // Sysex traffic (i.e. queries, I2C, strings)
+        PRIORITY_CLASS_COUNT,
+    };
+
+    static const size_t DEFAULT_CLASS_CAPACITY = 1024;
+    static const size_t DEFAULT_QUANTUM = 64;
+
+    /*!
+     * \param [in] stream_ The stream to write through
+     * \param [in] class_capacity_ The number of bytes each class may queue,
+     *                             beyond which its writers block
+     * \param [in] quantum_ The number of bytes a lane may send per round of
+     *                      its class
+     */
+    OutboundScheduler (
+        Stream & stream_,
+        const size_t class_capacity_ = DEFAULT_CLASS_CAPACITY,
+        const size_t quantum_ = DEFAULT_QUANTUM
+    );
+
+    /*!
+     * \brief Write each message to a descriptor in as few calls as it allows
+     *
+     * When the descriptor is full, the dispatcher waits for it to drain
+     * before writing the rest of the message, so a message is never cut
+     * short by a saturated link.
+     *
+     * \param [in] stream_ The stream to write through
+     * \param [in] class_capacity_ The number of bytes each class may queue,
+     *                             beyond which its writers block
+     * \param [in] quantum_ The number of bytes a lane may send per round of
+     *                      its class
+     */
+    OutboundScheduler (
+        FdStream & stream_,
+        const size_t class_capacity_ = DEFAULT_CLASS_CAPACITY,
+        const size_t quantum_ = DEFAULT_QUANTUM
+    );
+
+    ~OutboundScheduler (
+        void
+    );
+
+    /*!
+     * \brief The number of times a writer of a class blocked on a full queue
+     */
+    uint64_t
+    backpressureWaits (
+        const PriorityClass priority_class_
+    ) const;
+
+    /*!
+     * \brief The total number of bytes of a class written to the stream
+     */
+    uint64_t
+    bytesSent (
+        const PriorityClass priority_class_
+    ) const;
+
+    /*!
+     * \brief Write the queued messages of a lane, and release it
+     *
+     * \param [in] lane_ The lane to close, which must not be written again
+     *
+     * \note A message left incomplete by the lane is discarded.
+     */
+    void
+    closeLane (
+        Lane * lane_
+    );
+
+    /*!
+     * \brief Block until every queued message has been written
+     */
+    void
+    flush (
+        void
+    );
+
+    /*!
+     * \brief The number of messages of a class cut short by a failed link
+     */
+    uint64_t
+    framesFailed (
+        const PriorityClass priority_class_
+    ) const;
+
+    /*!
+     * \brief The total number of messages of a class written to the stream
+     */
+    uint64_t
+    framesSent (
+        const PriorityClass priority_class_
+    ) const;
+
+    /*!
+     * \brief Open a lane for a writer
+     *
+     * \param [in] priority_class_ The class of the messages written to the lane
+     *
+     * \return The lane, owned by the scheduler until it is closed
+     *
+     * \note A lane may be written by one thread at a time.
+     */
+    Lane *
+    openLane (
+        const PriorityClass priority_class_
+    );
+
+    /*!
+     * \brief The time the messages of a class waited in the queue
+     *
+     * The wait is measured from the completion of the message by its writer,
+     * until the dispatcher begins writing it to the stream.
+     */
+    HistogramSnapshot
+    queueLatency (
+        const PriorityClass priority_class_
+    ) const;
+
+  private:
+    struct Frame {
+        std::vector<uint8_t> bytes;
+        std::chrono::steady_clock::time_point enqueued_at;
+    };
+
+    struct ClassQueue {
+        std::deque<Lane *> active;  // Lanes with queued frames, in round robin order
+        std::atomic<uint64_t> backpressure_waits;
+        std::atomic<uint64_t> bytes_sent;
+        std::atomic<uint64_t> frames_failed;
+        std::atomic<uint64_t> frames_sent;
+        std::atomic<uint64_t> latency_buckets[HistogramSnapshot::BUCKET_COUNT];
+        std::atomic<uint64_t> latency_sum_us;
+        size_t queued_bytes;
+    };
+
+    const size_t _class_capacity;
+    ClassQueue _classes[PRIORITY_CLASS_COUNT];
+    std::condition_variable _dispatch_wakeup;
+    std::thread _dispatcher;
+    FdStream * const _fd_stream;  // The stream, when it accepts bulk writes
+    std::vector<std::unique_ptr<Lane>> _lanes;
+    std::mutex _mutex;
+    std::condition_variable _progress;
+    const size_t _quantum;
+    size_t _queued_frames;
+    bool _running;
+    Stream & _stream;
+    Lane * _writing_lane;
+
+    OutboundScheduler (
+        Stream & stream_,
+        FdStream * fd_stream_,
+        const size_t class_capacity_,
+        const size_t quantum_
+    );
+
+    /*!
+     * \brief Take the next frame to write, by class, then by lane
+     *
+     * \param [out] frame_ The frame to write
+     *
+     * \return The lane of the frame
+     */
+    Lane *
+    dequeue (
+        Frame * frame_
+    );
+
+    /*!
+     * \brief Queue the message completed by a lane
+     *
+     * \return `true` when the message was queued
+     */
+    bool
+    enqueue (
+        Lane & lane_
+    );
+
+    void
+    runDispatcher (
+        void
+    );
+
+    /*!
+     * \brief Write every byte of a frame, waiting on the link as needed
+     *
+     * \return `true` when the whole frame was written
+     */
+    bool
+    writeFrame (
+        const Frame & frame_
+    );
+
+    /*!
+     * \brief Block until every queued message of a lane has been written
+     */
+    void
+    waitForLane (
+        std::unique_lock<std::mutex> & lock_,
+        const Lane & lane_
+    );
+};
+
+/*!
+ * \brief A stream whose writes are queued by an outbound scheduler
+ *
+ * \note Reads pass straight through to the underlying stream.
+ */
+class OutboundScheduler::Lane : public Stream {
+  public:
+    size_t
+    available (
+        void
+    ) override;
+
+    /*!
+     * \brief Does nothing, because the underlying stream is shared
+     */
+    void
+    begin (
+        const size_t speed_,
+        const size_t config_
+    ) override;
+
+    /*!
+     * \brief Block until the messages written to the lane have been written
+     */
+    void
+    end (
+        void
+    ) override;
+
+    /*!
+     * \brief Block until the messages written to the lane have been written
+     */
+    void
+    flush (
+        void
+    ) override;
+
+    int
+    peek (
+        void
+    ) override;
+
+    PriorityClass
+    priorityClass (
+        void
+    ) const;
+
+    int
+    read (
+        void
+    ) override;
+
+    void
+    registerSerialEventCallback (
+        serialEvent upon_read_,
+        void * context_
+    ) override;
+
+    size_t
+    write (
+        uint8_t byte_
+    ) override;
+
+  private:
+    friend class OutboundScheduler;
+
+    bool _active;  // Listed among the active lanes of its class
+    size_t _deficit;
+    std::vector<uint8_t> _frame;  // The message in progress
+    std::deque<Frame> _frames;
+    MessageFramer _framer;
+    const PriorityClass _priority_class;
+    OutboundScheduler & _scheduler;
+
+    Lane (
+        OutboundScheduler & scheduler_,
+        const PriorityClass priority_class_
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // OUTBOUND_SCHEDULER_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,141 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef PIN_SET_H
+#define PIN_SET_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief A compact set of pin numbers
+ *
+ * Firmata addresses pins with a 7-bit pin number, so every pin of a remote
+ * device fits in a fixed 128-bit set. Set operations are a handful of word
+ * operations, and counting is a hardware population count.
+ */
+class PinSet {
+  public:
+    static constexpr size_t CAPACITY = 128;
+
+    constexpr
+    PinSet (
+        void
+    ) :
+        _words{ 0, 0 }
+    {
+    }
+
+    constexpr
+    PinSet (
+        const uint64_t low_word_,
+        const uint64_t high_word_
+    ) :
+        _words{ low_word_, high_word_ }
+    {
+    }
+
+    /*!
+     * \brief A set containing the pins [0, pin_count_)
+     */
+    static constexpr
+    PinSet
+    firstPins (
+        const size_t pin_count_
+    ) {
+        return ((pin_count_ >= CAPACITY) ? PinSet(~0ULL, ~0ULL)
+              : (pin_count_ >= 64) ? PinSet(~0ULL, ((1ULL << (pin_count_ - 64)) - 1))
+              : PinSet(((1ULL << pin_count_) - 1), 0));
+    }
+
+    constexpr
+    bool
+    contains (
+        const size_t pin_
+    ) const {
+        return ((pin_ < CAPACITY) && (0 != (_words[(pin_ / 64)] & (1ULL << (pin_ % 64)))));
+    }
+
+    size_t
+    count (
+        void
+    ) const {
+        return static_cast<size_t>(__builtin_popcountll(_words[0]) + __builtin_popcountll(_words[1]));
+    }
+
+    constexpr
+    bool
+    empty (
+        void
+    ) const {
+        return (0 == (_words[0] | _words[1]));
+    }
+
+    void
+    erase (
+        const size_t pin_
+    ) {
+        if ( pin_ < CAPACITY ) { _words[(pin_ / 64)] &= ~(1ULL << (pin_ % 64)); }
+    }
+
+    void
+    insert (
+        const size_t pin_
+    ) {
+        if ( pin_ < CAPACITY ) { _words[(pin_ / 64)] |= (1ULL << (pin_ % 64)); }
+    }
+
+    constexpr
+    bool
+    isSubsetOf (
+        const PinSet & other_
+    ) const {
+        return (0 == ((_words[0] & ~other_._words[0]) | (_words[1] & ~other_._words[1])));
+    }
+
+    /*!
+     * \brief Find the first pin in the set at or after `pin_`
+     *
+     * \return The pin number, or `CAPACITY` when no such pin exists
+     *
+     * \note Iterate with `for (size_t p = s.next(0) ; p < PinSet::CAPACITY ; p = s.next(p + 1))`
+     */
+    size_t
+    next (
+        size_t pin_
+    ) const {
+        for (; pin_ < CAPACITY ; pin_ = ((pin_ / 64) + 1) * 64) {
+            const uint64_t word = (_words[(pin_ / 64)] & (~0ULL << (pin_ % 64)));
+            if ( word ) { return (((pin_ / 64) * 64) + __builtin_ctzll(word)); }
+        }
+        return CAPACITY;
+    }
+
+    constexpr
+    uint64_t
+    word (
+        const size_t index_
+    ) const {
+        return _words[index_];
+    }
+
+    constexpr PinSet operator& (const PinSet & other_) const { return PinSet((_words[0] & other_._words[0]), (_words[1] & other_._words[1])); }
+    constexpr PinSet operator| (const PinSet & other_) const { return PinSet((_words[0] | other_._words[0]), (_words[1] | other_._words[1])); }
+    constexpr PinSet operator~ (void) const { return PinSet(~_words[0], ~_words[1]); }
+    constexpr bool operator== (const PinSet & other_) const { return ((_words[0] == other_._words[0]) && (_words[1] == other_._words[1])); }
+    constexpr bool operator!= (const PinSet & other_) const { return !(*this == other_); }
+    PinSet & operator&= (const PinSet & other_) { _words[0] &= other_._words[0]; _words[1] &= other_._words[1]; return *this; }
+    PinSet & operator|= (const PinSet & other_) { _words[0] |= other_._words[0]; _words[1] |= other_._words[1]; return *this; }
+
+  private:
+    uint64_t _words[2];
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // PIN_SET_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
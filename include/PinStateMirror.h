@@ -0,0 +1,308 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef PIN_STATE_MIRROR_H
+#define PIN_STATE_MIRROR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include <FirmataMarshaller.h>
+
+#include "DeviceAwaitable.h"
+#include "DeviceContract.h"
+#include "PinSet.h"
+#include "Stream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief The mode and state of a pin, as reported by the remote device
+ */
+struct PinStateReport {
+    uint8_t mode;  // `PinStateMirror::UNKNOWN_MODE` when the pin did not answer
+    uint32_t state;
+};
+
+/*!
+ * \brief A host-side shadow of the mode and state of each pin
+ *
+ * The mirror sits in front of the marshaller. Every pin mode and value sent
+ * through it is recorded, and a command that would not change the recorded
+ * state of the pin is suppressed instead of being sent. The mirror is also
+ * kept current by PIN_STATE_RESPONSE (once attached to a `FirmataQuery`
+ * with `setPinStateMirror`), so reads may be answered from the mirror while
+ * the recorded state is fresh enough.
+ *
+ * \note Until a pin is configured through the mirror (or reported by the
+ *       remote device), its mode and state are unknown, and nothing sent to
+ *       it is suppressed.
+ */
+class PinStateMirror {
+  public:
+    typedef std::chrono::steady_clock::duration duration;
+    typedef void(*pinStateReported)(void * context_, size_t pin_);
+
+    static const uint8_t UNKNOWN_MODE = 0xFF;
+
+    /*!
+     * \param [in] contract_ The contract used to validate modes and writes
+     */
+    PinStateMirror (
+        const DeviceContract & contract_
+    );
+
+    /*!
+     * \brief Write an analog (PWM) value, unless the pin already holds it
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (i.e. the pin does not support analog write)
+     */
+    int
+    analogWrite (
+        const size_t pin_,
+        const uint16_t value_
+    );
+
+    /*!
+     * \brief Begin sending commands on a stream
+     *
+     * \param [in] stream_ The stream connected to the remote device
+     */
+    void
+    begin (
+        Stream & stream_
+    );
+
+    /*!
+     * \brief The recorded mode of a pin
+     *
+     * \return The Firmata pin mode, or `UNKNOWN_MODE`
+     */
+    uint8_t
+    cachedPinMode (
+        const size_t pin_
+    ) const;
+
+    /*!
+     * \brief Withdraw the callback of a query awaiting a report
+     *
+     * \param [in] pin_ The pin queried
+     * \param [in] context_ The context the query was made with
+     *
+     * \return `true` when the callback will not be invoked, or `false` when
+     *         it has been (or is being) invoked
+     */
+    bool
+    cancelPinStateQuery (
+        const size_t pin_,
+        void * context_
+    );
+
+    /*!
+     * \brief Answer a read from the mirror
+     *
+     * \param [in] pin_ The pin to read
+     * \param [in] max_age_ The staleness bound of the answer
+     * \param [out] state_ The recorded state of the pin
+     *
+     * \return `true` when the state is known and was recorded within
+     *         `max_age_`, otherwise `false` (the caller should query the
+     *         remote device, i.e. with `queryPinState`)
+     */
+    bool
+    cachedPinState (
+        const size_t pin_,
+        const duration max_age_,
+        uint32_t * state_
+    ) const;
+
+    /*!
+     * \brief The number of commands sent to the marshaller
+     */
+    size_t
+    commandsSent (
+        void
+    ) const;
+
+    /*!
+     * \brief The number of commands suppressed because they changed nothing
+     */
+    size_t
+    commandsSuppressed (
+        void
+    ) const;
+
+    /*!
+     * \brief Write a digital value, unless the pin already holds it
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (i.e. the pin does not support digital write)
+     */
+    int
+    digitalWrite (
+        const size_t pin_,
+        const bool value_
+    );
+
+    /*!
+     * \brief Replace the observer of PIN_STATE_RESPONSE, and return the
+     *        observer it replaced
+     *
+     * \param [in] upon_report_ Invoked with the pin after its state is
+     *                          recorded (`nullptr` to detach)
+     * \param [in] context_ A context supplied to the callback when called
+     * \param [out] previous_callback_ The replaced callback
+     * \param [out] previous_context_ The context of the replaced callback
+     *
+     * \note The previous observer is returned before the new one can be
+     *       invoked, so the new one may forward each report to it.
+     *
+     * \sa PinStateMirror::setPinStateCallback
+     */
+    void
+    exchangePinStateCallback (
+        pinStateReported upon_report_,
+        void * context_,
+        pinStateReported * previous_callback_,
+        void ** previous_context_
+    );
+
+#if defined(__cpp_impl_coroutine)
+    /*!
+     * \brief Await the state of a pin, as reported by the remote device
+     *
+     * \param [in] pin_ The pin to query
+     * \param [in] timeout_ The time allowed for the device to answer
+     *
+     * \return An awaitable, resumed once the report has been recorded, whose
+     *         result is the mode and state of the pin
+     *
+     * \note The coroutine resumes on the thread that parses the report, or
+     *       upon the timeout on the timer thread.
+     */
+    PinStateAwaitable
+    pinState (
+        const size_t pin_,
+        const duration timeout_ = std::chrono::seconds(1)
+    ) {
+        return PinStateAwaitable(*this, pin_, timeout_);
+    }
+#endif
+
+    /*!
+     * \brief Record a PIN_STATE_RESPONSE
+     *
+     * \param [in] argc_ The number of bytes in the sysex payload
+     * \param [in] argv_ The sysex payload (pin, mode, then the state in
+     *                   7-bit bytes, least significant first)
+     */
+    void
+    pinStateResponse (
+        const size_t argc_,
+        const uint8_t * argv_
+    );
+
+    /*!
+     * \brief Request the state of a pin from the remote device
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     */
+    int
+    queryPinState (
+        const size_t pin_
+    );
+
+    /*!
+     * \brief Request the state of a pin, and be called back upon its report
+     *
+     * \param [in] pin_ The pin to query
+     * \param [in] upon_report_ Invoked once, after the next report of the pin
+     *                          is recorded
+     * \param [in] context_ A context supplied to the callback when called
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (i.e. another query of the pin is awaiting its report)
+     */
+    int
+    queryPinState (
+        const size_t pin_,
+        pinStateReported upon_report_,
+        void * context_
+    );
+
+    /*!
+     * \brief Observe each PIN_STATE_RESPONSE as it is recorded
+     *
+     * \param [in] upon_report_ Invoked with the pin after its state is
+     *                          recorded (`nullptr` to detach)
+     * \param [in] context_ A context supplied to the callback when called
+     *
+     * \note The callback is invoked with the mirror unlocked, so it may call
+     *       back into the mirror. Once this call returns, the previous
+     *       callback will not be invoked again, and has returned from any
+     *       invocation on another thread.
+     */
+    void
+    setPinStateCallback (
+        pinStateReported upon_report_,
+        void * context_
+    );
+
+    /*!
+     * \brief Set the mode of a pin, unless it is already in that mode
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (i.e. the pin does not support the mode)
+     */
+    int
+    setPinMode (
+        const size_t pin_,
+        const uint8_t mode_
+    );
+
+  private:
+    struct PinState {
+        uint8_t mode;
+        bool state_known;
+        uint32_t state;
+        std::chrono::steady_clock::time_point updated_at;
+        pinStateReported awaiting_callback;  // The query awaiting the next report
+        void * awaiting_context;
+    };
+
+    static const size_t CAPABILITY_COUNT = 5;
+
+    PinSet _capability_pins[CAPABILITY_COUNT];
+    size_t _commands_sent;
+    size_t _commands_suppressed;
+    firmata::FirmataMarshaller _marshaller;
+    mutable std::mutex _mutex;
+    PinState _pin_state[PinSet::CAPACITY];
+    pinStateReported _pin_state_reported_callback;
+    void * _pin_state_reported_callback_context;
+    std::condition_variable _reports_done;
+    size_t _reports_in_flight;  // Invocations of the callback in progress
+
+    bool
+    modeAvailableOnPin (
+        const size_t pin_,
+        const uint8_t mode_
+    ) const;
+
+    void
+    recordState (
+        const size_t pin_,
+        const uint32_t state_
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // PIN_STATE_MIRROR_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,121 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef PIN_STATE_SWEEP_H
+#define PIN_STATE_SWEEP_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <FirmataMarshaller.h>
+
+#include "PinSet.h"
+#include "PinStateMirror.h"
+#include "Stream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Query the mode and state of every pin, with requests pipelined
+ *
+ * Querying one pin at a time costs a full round trip per pin. The sweep
+ * instead keeps up to `window` PIN_STATE_QUERY requests in flight, and
+ * issues the next query as each response arrives. Responses are correlated
+ * by pin number (they may arrive in any order), and are recorded by the
+ * `PinStateMirror` attached to the `FirmataQuery` parsing the stream.
+ *
+ * While it runs, the sweep observes the mirror in place of any observer
+ * set with `setPinStateCallback`, forwards every report to that observer,
+ * and restores it once the sweep is done.
+ *
+ * \note A window of one reproduces the sequential, one round trip per pin,
+ *       behavior. Larger windows trade receive buffer space on the remote
+ *       device for fewer round trips.
+ */
+class PinStateSweep {
+  public:
+    typedef std::chrono::steady_clock::duration duration;
+
+    static const size_t DEFAULT_WINDOW = 8;
+
+    /*!
+     * \param [in] mirror_ The mirror receiving PIN_STATE_RESPONSE
+     * \param [in] pin_count_ The number of pins to sweep (i.e. `pinCount()`)
+     * \param [in] window_ The maximum number of queries in flight
+     */
+    PinStateSweep (
+        PinStateMirror & mirror_,
+        const size_t pin_count_,
+        const size_t window_ = DEFAULT_WINDOW
+    );
+
+    /*!
+     * \brief Begin sending queries on a stream
+     *
+     * \param [in] stream_ The stream connected to the remote device
+     */
+    void
+    begin (
+        Stream & stream_
+    );
+
+    /*!
+     * \brief The total number of queries sent
+     */
+    size_t
+    queriesSent (
+        void
+    ) const;
+
+    /*!
+     * \brief Query every pin, and block until all have answered
+     *
+     * \param [in] timeout_ The time allowed for the whole sweep
+     * \param [out] snapshot_ The mode and state of each pin, indexed by pin
+     *                        (optional)
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (i.e. a pin did not answer before the timeout)
+     *
+     * \note The snapshot is filled even when the sweep times out, with the
+     *       pins that did not answer reported as `UNKNOWN_MODE`.
+     */
+    int
+    sweep (
+        const duration timeout_,
+        std::vector<PinStateReport> * snapshot_ = nullptr
+    );
+
+  private:
+    size_t _answered;
+    std::condition_variable _condition;
+    size_t _in_flight;
+    firmata::FirmataMarshaller _marshaller;
+    PinStateMirror & _mirror;
+    mutable std::mutex _mutex;
+    size_t _next_pin;
+    PinSet _outstanding;
+    const size_t _pin_count;
+    PinStateMirror::pinStateReported _previous_callback;  // The observer replaced for the sweep
+    void * _previous_context;
+    size_t _queries_sent;
+    const size_t _window;
+
+    static
+    void
+    pinStateReported (
+        void * context_,
+        size_t pin_
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // PIN_STATE_SWEEP_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
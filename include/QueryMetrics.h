@@ -0,0 +1,184 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef QUERY_METRICS_H
+#define QUERY_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief A point-in-time copy of a latency histogram
+ *
+ * Bucket `i` counts the samples of at most 2^i microseconds, and more than
+ * the bound of the bucket before it (the last bucket also counts every
+ * larger sample), so each bound is an inclusive `le` bound.
+ */
+struct HistogramSnapshot {
+    static const size_t BUCKET_COUNT = 32;
+
+    uint64_t buckets[BUCKET_COUNT];
+    uint64_t count;
+    uint64_t sum_us;
+};
+
+/*!
+ * \brief A point-in-time copy of the metrics of a query
+ */
+struct QueryMetricsSnapshot {
+    enum Phase {
+        VERSION_WAIT = 0,
+        CAPABILITY_RESPONSE,
+        ANALOG_MAPPING_RESPONSE,
+        CONTRACT_ACQUISITION,
+        PHASE_COUNT,
+    };
+
+    enum SamplingChange {
+        SAMPLING_REQUESTED = 0,
+        SAMPLING_BACKLOG,
+        SAMPLING_OVERRUN,
+        SAMPLING_RECOVERED,
+        SAMPLING_CHANGE_COUNT,
+    };
+
+    uint64_t buffer_growths;
+    uint64_t bytes_received;
+    uint64_t contracts_acquired;
+    uint64_t frames_received;
+    uint64_t parse_errors;
+    uint64_t parser_wakeups;
+    HistogramSnapshot phases[PHASE_COUNT];
+    uint64_t queries_started;
+    uint64_t ring_high_water_mark;
+    uint64_t ring_overruns;
+    uint64_t sampling_interval_changes[SAMPLING_CHANGE_COUNT];
+    uint64_t sampling_interval_ms;
+};
+
+/*!
+ * \brief Lock-free counters and phase latency histograms for a query
+ *
+ * Every update is a relaxed atomic operation, so metrics may be recorded
+ * from the serial event thread and read from any other thread without
+ * locking. Readers take a `snapshot`, which may be rendered in the text
+ * exposition format with `exposition`.
+ */
+class QueryMetrics {
+  public:
+    typedef QueryMetricsSnapshot::Phase Phase;
+    typedef QueryMetricsSnapshot::SamplingChange SamplingChange;
+
+    QueryMetrics (
+        void
+    );
+
+    void
+    addBytesReceived (
+        const size_t bytes_
+    );
+
+    void
+    addFramesReceived (
+        const size_t frames_
+    );
+
+    void
+    addRingOverruns (
+        const size_t bytes_
+    );
+
+    /*!
+     * \brief Render a snapshot in the Prometheus text exposition format
+     *
+     * \param [in] snapshot_ The snapshot to render
+     * \param [in] device_ The value of the `device` label on each sample
+     *
+     * \return The rendered text, one sample per line
+     */
+    static
+    std::string
+    exposition (
+        const QueryMetricsSnapshot & snapshot_,
+        const char * device_
+    );
+
+    void
+    recordBufferGrowth (
+        void
+    );
+
+    void
+    recordContractAcquired (
+        void
+    );
+
+    void
+    recordParseError (
+        void
+    );
+
+    void
+    recordParserWakeup (
+        void
+    );
+
+    void
+    recordPhase (
+        const Phase phase_,
+        const std::chrono::steady_clock::duration elapsed_
+    );
+
+    void
+    recordQueryStarted (
+        void
+    );
+
+    void
+    recordRingOccupancy (
+        const size_t bytes_
+    );
+
+    void
+    recordSamplingInterval (
+        const uint16_t interval_ms_,
+        const SamplingChange reason_
+    );
+
+    QueryMetricsSnapshot
+    snapshot (
+        void
+    ) const;
+
+  private:
+    struct Histogram {
+        std::atomic<uint64_t> buckets[HistogramSnapshot::BUCKET_COUNT];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum_us;
+    };
+
+    std::atomic<uint64_t> _buffer_growths;
+    std::atomic<uint64_t> _bytes_received;
+    std::atomic<uint64_t> _contracts_acquired;
+    std::atomic<uint64_t> _frames_received;
+    std::atomic<uint64_t> _parse_errors;
+    std::atomic<uint64_t> _parser_wakeups;
+    Histogram _phases[QueryMetricsSnapshot::PHASE_COUNT];
+    std::atomic<uint64_t> _queries_started;
+    std::atomic<uint64_t> _ring_high_water_mark;
+    std::atomic<uint64_t> _ring_overruns;
+    std::atomic<uint64_t> _sampling_interval_changes[QueryMetricsSnapshot::SAMPLING_CHANGE_COUNT];
+    std::atomic<uint64_t> _sampling_interval_ms;
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // QUERY_METRICS_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
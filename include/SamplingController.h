@@ -0,0 +1,94 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef SAMPLING_CONTROLLER_H
+#define SAMPLING_CONTROLLER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "AnalogSampler.h"
+#include "FirmataQuery.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Adapts the sampling interval of a device to its consumers
+ *
+ * Once per `update`, the controller measures the lag of the consumers at
+ * the ingest rings of an `AnalogSampler`. When samples have been dropped,
+ * or the deepest ring is more than half full, the sampling interval is
+ * doubled. Once every ring has stayed below an eighth full for several
+ * consecutive updates, the interval is halved again. Changes are sent with
+ * the marshaller of the `FirmataQuery`, and the interval and the reason for
+ * each change are recorded in its metrics.
+ *
+ * \note `update` is expected to be called periodically from one thread
+ *       (i.e. the consumer, once per batch).
+ */
+class SamplingController {
+  public:
+    static const uint16_t DEFAULT_INTERVAL_MS = 19;
+    static const uint16_t DEFAULT_MAX_INTERVAL_MS = 1000;
+    static const uint16_t DEFAULT_MIN_INTERVAL_MS = 10;
+    static const size_t RECOVERY_UPDATES = 4;
+
+    SamplingController (
+        FirmataQuery & query_,
+        const AnalogSampler & sampler_,
+        const uint16_t min_interval_ms_ = DEFAULT_MIN_INTERVAL_MS,
+        const uint16_t max_interval_ms_ = DEFAULT_MAX_INTERVAL_MS
+    );
+
+    /*!
+     * \brief Send the initial sampling interval
+     *
+     * \param [in] interval_ms_ The initial interval, in milliseconds
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     */
+    int
+    begin (
+        const uint16_t interval_ms_ = DEFAULT_INTERVAL_MS
+    );
+
+    /*!
+     * \brief The sampling interval most recently sent, in milliseconds
+     */
+    uint16_t
+    interval (
+        void
+    ) const;
+
+    /*!
+     * \brief Measure the consumer lag, and adjust the interval
+     *
+     * \return `true` when the interval was changed
+     */
+    bool
+    update (
+        void
+    );
+
+  private:
+    size_t _calm_updates;
+    uint16_t _interval_ms;
+    const uint16_t _max_interval_ms;
+    const uint16_t _min_interval_ms;
+    FirmataQuery & _query;
+    const AnalogSampler & _sampler;
+    size_t _samples_dropped;
+
+    bool
+    changeInterval (
+        const uint32_t interval_ms_,
+        const QueryMetrics::SamplingChange reason_
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // SAMPLING_CONTROLLER_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,131 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef SERIAL_REACTOR_H
+#define SERIAL_REACTOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "FdStream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Multiplexes many serial links onto a few threads with epoll
+ *
+ * Each attached `FdStream` is serviced when its descriptor becomes
+ * readable, which raises the serial event of the `FirmataQuery` (or any
+ * other client) registered on the stream. A host with hundreds of links
+ * needs only as many threads as it has workers, rather than one per link.
+ *
+ * Descriptors are registered one-shot, so a stream is only ever serviced
+ * by one worker at a time and is re-armed once its bytes are dispatched.
+ * When several workers are started, whichever worker is idle picks up the
+ * next ready stream, so a busy link does not hold up the others.
+ */
+class SerialReactor {
+  public:
+    SerialReactor (
+        void
+    );
+
+    ~SerialReactor (
+        void
+    );
+
+    /*!
+     * \brief Begin servicing a stream
+     *
+     * \param [in] stream_ The stream to service; it must outlive its
+     *                     attachment to the reactor
+     *
+     * \return 0 on success, or the line number of the failure
+     */
+    int
+    attach (
+        FdStream & stream_
+    );
+
+    /*!
+     * \brief Stop servicing a stream
+     *
+     * \return 0 on success, or the line number of the failure
+     *
+     * \note Detach a stream only while the reactor is stopped, or from
+     *       within the serial event of that same stream.
+     */
+    int
+    detach (
+        FdStream & stream_
+    );
+
+    /*!
+     * \brief The number of times a stream was serviced
+     */
+    size_t
+    dispatches (
+        void
+    ) const;
+
+    /*!
+     * \brief The number of streams whose remote end hung up
+     *
+     * \note A stream that hangs up is no longer serviced, but remains
+     *       attached until it is detached.
+     */
+    size_t
+    hangups (
+        void
+    ) const;
+
+    /*!
+     * \brief Start the worker threads
+     *
+     * \param [in] worker_count_ The number of threads servicing the streams
+     *
+     * \return 0 on success, or the line number of the failure
+     */
+    int
+    start (
+        const size_t worker_count_ = 1
+    );
+
+    /*!
+     * \brief Stop and join the worker threads
+     */
+    void
+    stop (
+        void
+    );
+
+    /*!
+     * \brief The number of times a worker returned from `epoll_wait`
+     */
+    size_t
+    wakeups (
+        void
+    ) const;
+
+  private:
+    std::atomic<size_t> _dispatches;
+    int _epoll_fd;
+    std::atomic<size_t> _hangups;
+    int _stop_fd;
+    std::atomic<size_t> _wakeups;
+    std::vector<std::thread> _workers;
+
+    void
+    run (
+        void
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // SERIAL_REACTOR_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,111 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef SEVEN_BIT_CODEC_H
+#define SEVEN_BIT_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Converts between 8-bit data and the 7-bit pairs of sysex payloads
+ *
+ * Sysex payloads may only carry 7-bit bytes, so Firmata sends each 8-bit
+ * byte as a pair: the low seven bits, then the high bit (i.e. the firmware
+ * name, STRING_DATA, I2C_REPLY and SERIAL_DATA payloads). The conversion
+ * is vectorized where the processor allows, and the fastest kernel is
+ * selected at runtime, on first use.
+ */
+class SevenBitCodec {
+  public:
+    enum Kernel {
+        KERNEL_SCALAR = 0,
+        KERNEL_SSE2,
+        KERNEL_AVX2,
+        KERNEL_NEON,
+        KERNEL_COUNT,
+    };
+
+    /*!
+     * \brief Join 7-bit pairs into 8-bit data
+     *
+     * \param [in] encoded_ The pairs (low seven bits, then high bit)
+     * \param [in] encoded_size_ The number of encoded bytes (a trailing,
+     *                           unpaired byte is ignored)
+     * \param [out] data_ The destination, of at least `encoded_size_ / 2` bytes
+     *
+     * \return The number of bytes decoded
+     */
+    static
+    size_t
+    decode (
+        const uint8_t * encoded_,
+        const size_t encoded_size_,
+        uint8_t * data_
+    );
+
+    /*!
+     * \brief Split 8-bit data into 7-bit pairs
+     *
+     * \param [in] data_ The data
+     * \param [in] size_ The number of bytes of data
+     * \param [out] encoded_ The destination, of at least `2 * size_` bytes
+     *
+     * \return The number of bytes encoded (`2 * size_`)
+     */
+    static
+    size_t
+    encode (
+        const uint8_t * data_,
+        const size_t size_,
+        uint8_t * encoded_
+    );
+
+    /*!
+     * \brief The kernel in use
+     */
+    static
+    Kernel
+    kernel (
+        void
+    );
+
+    /*!
+     * \brief Whether a kernel is supported by the processor
+     */
+    static
+    bool
+    kernelAvailable (
+        const Kernel kernel_
+    );
+
+    /*!
+     * \brief The name of a kernel (i.e. "avx2")
+     */
+    static
+    const char *
+    kernelName (
+        const Kernel kernel_
+    );
+
+    /*!
+     * \brief Override the kernel selected at runtime (i.e. to benchmark)
+     *
+     * \return If an error occurred, then a non-zero value will be returned
+     *         (i.e. the kernel is not supported by the processor)
+     */
+    static
+    int
+    useKernel (
+        const Kernel kernel_
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // SEVEN_BIT_CODEC_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,108 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef SPSC_BYTE_RING_H
+#define SPSC_BYTE_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief A lock-free, single-producer/single-consumer byte ring
+ *
+ * One thread may `push` while another thread may `pop`, without locking.
+ * Bytes that do not fit are dropped and counted as overruns, because the
+ * producer is typically a transport thread that must never block.
+ *
+ * \note The capacity is rounded up to a power of two.
+ */
+class SpscByteRing {
+  public:
+    SpscByteRing (
+        const size_t capacity_
+    );
+
+    ~SpscByteRing (
+        void
+    );
+
+    size_t
+    capacity (
+        void
+    ) const;
+
+    /*!
+     * \brief The greatest number of bytes ever held by the ring
+     */
+    size_t
+    highWaterMark (
+        void
+    ) const;
+
+    /*!
+     * \brief The number of bytes dropped because the ring was full
+     */
+    size_t
+    overruns (
+        void
+    ) const;
+
+    /*!
+     * \brief Remove bytes from the ring (consumer only)
+     *
+     * \param [out] data_ The destination of the bytes
+     * \param [in] max_size_ The maximum number of bytes to remove
+     *
+     * \return The number of bytes removed
+     */
+    size_t
+    pop (
+        uint8_t * data_,
+        const size_t max_size_
+    );
+
+    /*!
+     * \brief Append bytes to the ring (producer only)
+     *
+     * \param [in] data_ The bytes to append
+     * \param [in] size_ The number of bytes to append
+     *
+     * \return The number of bytes appended; the remainder were dropped
+     */
+    size_t
+    push (
+        const uint8_t * data_,
+        const size_t size_
+    );
+
+    /*!
+     * \brief The number of bytes held by the ring
+     */
+    size_t
+    size (
+        void
+    ) const;
+
+  private:
+    uint8_t * _buffer;
+    size_t _mask;
+
+    // The indices are written by different threads, so keep them on
+    // separate cache lines
+    std::atomic<size_t> _head;
+    uint8_t _head_padding[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> _tail;
+    uint8_t _tail_padding[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> _high_water_mark;
+    std::atomic<size_t> _overruns;
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // SPSC_BYTE_RING_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
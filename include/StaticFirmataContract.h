@@ -0,0 +1,197 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef STATIC_FIRMATA_CONTRACT_H
+#define STATIC_FIRMATA_CONTRACT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "DeviceContract.h"
+#include "FirmataBoards.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief A device contract known at compile time
+ *
+ * For boards known ahead of time, the pin configuration table is built into
+ * the binary and every query is a non-virtual `constexpr` function, so
+ * capability checks against constant pins fold away entirely.
+ *
+ * \tparam Board A board description providing `PIN_COUNT` and a `PIN_CONFIG`
+ *               table (i.e. `ArduinoUno`)
+ *
+ * \sa remote_wiring::protocol::StaticFirmataContractAdapter
+ */
+template <typename Board>
+class StaticFirmataContract {
+  public:
+    static constexpr
+    size_t
+    analogChannelForPin (
+        const size_t pin_
+    ) {
+        return ((pin_ < Board::PIN_COUNT) ? Board::PIN_CONFIG[pin_].reserved : NO_ANALOG_CHANNEL);
+    }
+
+    static constexpr
+    bool
+    analogReadAvailableOnPin (
+        const size_t pin_
+    ) {
+        return capabilityAvailableOnPin(ANALOG_READ, pin_);
+    }
+
+    static constexpr
+    size_t
+    analogReadBitsOfResolutionForPin (
+        const size_t pin_
+    ) {
+        return ((pin_ < Board::PIN_COUNT) ? Board::PIN_CONFIG[pin_].analog_read_resolution_bits : 0);
+    }
+
+    static constexpr
+    bool
+    analogWriteAvailableOnPin (
+        const size_t pin_
+    ) {
+        return capabilityAvailableOnPin(ANALOG_WRITE, pin_);
+    }
+
+    static constexpr
+    size_t
+    analogWriteBitsOfResolutionForPin (
+        const size_t pin_
+    ) {
+        return ((pin_ < Board::PIN_COUNT) ? Board::PIN_CONFIG[pin_].analog_write_resolution_bits : 0);
+    }
+
+    static constexpr
+    bool
+    digitalReadAvailableOnPin (
+        const size_t pin_
+    ) {
+        return capabilityAvailableOnPin(DIGITAL_READ, pin_);
+    }
+
+    static constexpr
+    bool
+    digitalReadPullupAvailableOnPin (
+        const size_t pin_
+    ) {
+        return capabilityAvailableOnPin(DIGITAL_READ_WITH_PULLUP, pin_);
+    }
+
+    static constexpr
+    bool
+    digitalWriteAvailableOnPin (
+        const size_t pin_
+    ) {
+        return capabilityAvailableOnPin(DIGITAL_WRITE, pin_);
+    }
+
+    static constexpr
+    size_t
+    pinCount (
+        void
+    ) {
+        return Board::PIN_COUNT;
+    }
+
+  private:
+    static constexpr
+    bool
+    capabilityAvailableOnPin (
+        const pin_config_t capability_,
+        const size_t pin_
+    ) {
+        return ((pin_ < Board::PIN_COUNT) && (0x00 != (Board::PIN_CONFIG[pin_].supported_modes & capability_)));
+    }
+};
+
+/*!
+ * \brief Presents a compile-time contract through the `DeviceContract` interface
+ *
+ * The adapter holds no state, and forwards each virtual call to the
+ * corresponding `StaticFirmataContract` function.
+ */
+template <typename Board>
+class StaticFirmataContractAdapter : public DeviceContract {
+  public:
+    typedef StaticFirmataContract<Board> contract_type;
+
+    size_t
+    analogChannelForPin (
+        const size_t pin_
+    ) const override {
+        return contract_type::analogChannelForPin(pin_);
+    }
+
+    bool
+    analogReadAvailableOnPin (
+        const size_t pin_
+    ) const override {
+        return contract_type::analogReadAvailableOnPin(pin_);
+    }
+
+    size_t
+    analogReadBitsOfResolutionForPin (
+        const size_t pin_
+    ) const override {
+        return contract_type::analogReadBitsOfResolutionForPin(pin_);
+    }
+
+    bool
+    analogWriteAvailableOnPin (
+        const size_t pin_
+    ) const override {
+        return contract_type::analogWriteAvailableOnPin(pin_);
+    }
+
+    size_t
+    analogWriteBitsOfResolutionForPin (
+        const size_t pin_
+    ) const override {
+        return contract_type::analogWriteBitsOfResolutionForPin(pin_);
+    }
+
+    bool
+    digitalReadAvailableOnPin (
+        const size_t pin_
+    ) const override {
+        return contract_type::digitalReadAvailableOnPin(pin_);
+    }
+
+    bool
+    digitalReadPullupAvailableOnPin (
+        const size_t pin_
+    ) const override {
+        return contract_type::digitalReadPullupAvailableOnPin(pin_);
+    }
+
+    bool
+    digitalWriteAvailableOnPin (
+        const size_t pin_
+    ) const override {
+        return contract_type::digitalWriteAvailableOnPin(pin_);
+    }
+
+    size_t
+    pinCount (
+       void
+    ) const override {
+        return contract_type::pinCount();
+    }
+};
+
+typedef StaticFirmataContract<ArduinoDue> ArduinoDueContract;
+typedef StaticFirmataContract<ArduinoMega> ArduinoMegaContract;
+typedef StaticFirmataContract<ArduinoUno> ArduinoUnoContract;
+
+} // protocol
+} // remote_wiring
+
+#endif // STATIC_FIRMATA_CONTRACT_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
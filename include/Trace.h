@@ -0,0 +1,177 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/*!
+ * \brief Compile-time trace levels
+ *
+ * Define `PROTOCOL_TRACE_LEVEL` when building the library to select the
+ * most verbose level compiled in. Trace statements above the selected
+ * level expand to nothing, so their arguments are never evaluated.
+ * Release builds (`NDEBUG`) default to `PROTOCOL_TRACE_LEVEL_NONE`.
+ */
+#define PROTOCOL_TRACE_LEVEL_NONE 0
+#define PROTOCOL_TRACE_LEVEL_ERROR 1
+#define PROTOCOL_TRACE_LEVEL_WARN 2
+#define PROTOCOL_TRACE_LEVEL_INFO 3
+#define PROTOCOL_TRACE_LEVEL_DEBUG 4
+
+#ifndef PROTOCOL_TRACE_LEVEL
+  #ifdef NDEBUG
+    #define PROTOCOL_TRACE_LEVEL PROTOCOL_TRACE_LEVEL_NONE
+  #else
+    #define PROTOCOL_TRACE_LEVEL PROTOCOL_TRACE_LEVEL_DEBUG
+  #endif
+#endif
+
+#if (PROTOCOL_TRACE_LEVEL >= PROTOCOL_TRACE_LEVEL_ERROR)
+  #define PROTOCOL_TRACE_ERROR(...) ::remote_wiring::protocol::trace(PROTOCOL_TRACE_LEVEL_ERROR, __VA_ARGS__)
+#else
+  #define PROTOCOL_TRACE_ERROR(...) do {} while (0)
+#endif
+#if (PROTOCOL_TRACE_LEVEL >= PROTOCOL_TRACE_LEVEL_WARN)
+  #define PROTOCOL_TRACE_WARN(...) ::remote_wiring::protocol::trace(PROTOCOL_TRACE_LEVEL_WARN, __VA_ARGS__)
+#else
+  #define PROTOCOL_TRACE_WARN(...) do {} while (0)
+#endif
+#if (PROTOCOL_TRACE_LEVEL >= PROTOCOL_TRACE_LEVEL_INFO)
+  #define PROTOCOL_TRACE_INFO(...) ::remote_wiring::protocol::trace(PROTOCOL_TRACE_LEVEL_INFO, __VA_ARGS__)
+#else
+  #define PROTOCOL_TRACE_INFO(...) do {} while (0)
+#endif
+#if (PROTOCOL_TRACE_LEVEL >= PROTOCOL_TRACE_LEVEL_DEBUG)
+  #define PROTOCOL_TRACE_DEBUG(...) ::remote_wiring::protocol::trace(PROTOCOL_TRACE_LEVEL_DEBUG, __VA_ARGS__)
+#else
+  #define PROTOCOL_TRACE_DEBUG(...) do {} while (0)
+#endif
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief A destination for trace messages
+ */
+struct TraceSink {
+    virtual
+    ~TraceSink (
+        void
+    ) {
+
+    }
+
+    /*!
+     * \brief Record a trace message
+     *
+     * \param [in] level_ The `PROTOCOL_TRACE_LEVEL_*` of the message
+     * \param [in] message_ The formatted, null-terminated message
+     */
+    virtual
+    void
+    write (
+        const int level_,
+        const char * message_
+    ) = 0;
+};
+
+/*!
+ * \brief A bounded, in-memory trace sink
+ *
+ * Holds the most recent messages in a fixed ring of fixed-size records.
+ * Once full, each new message overwrites the oldest, so tracing never
+ * blocks on I/O and never grows memory.
+ */
+class TraceRingBuffer : public TraceSink {
+  public:
+    static const size_t MESSAGE_SIZE = 120;
+
+    struct Record {
+        int level;
+        char message[MESSAGE_SIZE];
+    };
+
+    TraceRingBuffer (
+        const size_t capacity_
+    );
+
+    /*!
+     * \brief The number of messages overwritten before they were read
+     */
+    size_t
+    dropped (
+        void
+    ) const;
+
+    /*!
+     * \brief Remove the buffered messages, oldest first
+     *
+     * \param [out] records_ The buffer to receive the records
+     * \param [in] max_records_ The number of records `records_` can hold
+     *
+     * \return The number of records read
+     */
+    size_t
+    read (
+        Record * records_,
+        const size_t max_records_
+    );
+
+    void
+    write (
+        const int level_,
+        const char * message_
+    ) override;
+
+  private:
+    size_t _dropped;
+    size_t _head;
+    mutable std::mutex _mutex;
+    std::vector<Record> _records;
+    size_t _size;
+};
+
+/*!
+ * \brief Direct trace messages to a sink
+ *
+ * \param [in] sink_ The sink to receive every trace message (`nullptr`
+ *                   discards them)
+ *
+ * \note By default, messages are held by a 256-record `TraceRingBuffer`
+ *       returned by `defaultTraceSink`
+ */
+void
+setTraceSink (
+    TraceSink * sink_
+);
+
+/*!
+ * \brief The ring buffer that receives trace messages by default
+ */
+TraceRingBuffer &
+defaultTraceSink (
+    void
+);
+
+/*!
+ * \brief Format a message and record it with the current sink
+ *
+ * \note Use the `PROTOCOL_TRACE_*` macros, so disabled levels compile away
+ */
+void
+trace (
+    const int level_,
+    const char * format_,
+    ...
+) __attribute__((format(printf, 2, 3)));
+
+} // protocol
+} // remote_wiring
+
+#endif // TRACE_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,224 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef WRITE_COMBINING_STREAM_H
+#define WRITE_COMBINING_STREAM_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "FdStream.h"
+#include "MessageFramer.h"
+#include "Stream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief Stages outbound bytes, and writes whole messages in one system call
+ *
+ * The marshaller writes one byte at a time, which costs an `FdStream` one
+ * system call per byte. The write-combining stream gathers those bytes
+ * into a staging buffer, tracking where each message ends, and writes the
+ * staged bytes to the underlying stream in a single call when:
+ *
+ * - the complete messages staged reach the flush threshold,
+ * - the oldest staged byte has waited for the flush delay, or
+ * - `flush` is called.
+ *
+ * When the link is saturated (the descriptor accepts only part of a
+ * write), the remainder stays staged, and a background thread writes it
+ * as the descriptor drains. Once the buffer is full, `write` blocks until
+ * there is room, so writers are held to the pace of the link.
+ *
+ * Should the link fail, the staged bytes are dropped (and counted), so
+ * neither writers nor `flush` wait upon a link that will never drain.
+ *
+ * \note Reads pass straight through to the underlying stream.
+ */
+class WriteCombiningStream : public Stream {
+  public:
+    typedef std::chrono::steady_clock::duration duration;
+
+    enum FlushReason {
+        FLUSH_THRESHOLD = 0,
+        FLUSH_DEADLINE,
+        FLUSH_EXPLICIT,
+        FLUSH_REASON_COUNT,
+    };
+
+    static const size_t DEFAULT_CAPACITY = 4096;
+    static const size_t DEFAULT_FLUSH_THRESHOLD = 256;
+
+    /*!
+     * \param [in] stream_ The stream to write through
+     * \param [in] flush_threshold_ The number of bytes of complete messages
+     *                              that triggers a flush
+     * \param [in] flush_delay_ The longest a staged byte waits to be written
+     * \param [in] capacity_ The size of the staging buffer, beyond which
+     *                       writers block
+     */
+    WriteCombiningStream (
+        FdStream & stream_,
+        const size_t flush_threshold_ = DEFAULT_FLUSH_THRESHOLD,
+        const duration flush_delay_ = std::chrono::milliseconds(1),
+        const size_t capacity_ = DEFAULT_CAPACITY
+    );
+
+    ~WriteCombiningStream (
+        void
+    );
+
+    size_t
+    available (
+        void
+    ) override;
+
+    /*!
+     * \brief The number of times a writer blocked on a full buffer
+     */
+    uint64_t
+    backpressureWaits (
+        void
+    ) const;
+
+    void
+    begin (
+        const size_t speed_,
+        const size_t config_
+    ) override;
+
+    /*!
+     * \brief The total number of staged bytes dropped by a failed link
+     */
+    uint64_t
+    bytesDropped (
+        void
+    ) const;
+
+    /*!
+     * \brief The total number of bytes written to the underlying stream
+     */
+    uint64_t
+    bytesWritten (
+        void
+    ) const;
+
+    void
+    end (
+        void
+    ) override;
+
+    /*!
+     * \brief Write every staged byte, and block until it has been written
+     */
+    void
+    flush (
+        void
+    ) override;
+
+    /*!
+     * \brief The number of flushes started for a reason
+     */
+    uint64_t
+    flushes (
+        const FlushReason reason_
+    ) const;
+
+    /*!
+     * \brief The total number of complete messages staged
+     */
+    uint64_t
+    messagesStaged (
+        void
+    ) const;
+
+    int
+    peek (
+        void
+    ) override;
+
+    int
+    read (
+        void
+    ) override;
+
+    void
+    registerSerialEventCallback (
+        serialEvent upon_read_,
+        void * context_
+    ) override;
+
+    size_t
+    write (
+        uint8_t byte_
+    ) override;
+
+    /*!
+     * \brief The total number of writes made to the underlying stream
+     *
+     * \note Each write is one system call.
+     */
+    uint64_t
+    writeCalls (
+        void
+    ) const;
+
+  private:
+    std::atomic<uint64_t> _backpressure_waits;
+    uint8_t * _buffer;
+    const size_t _buffer_capacity;
+    size_t _buffer_head;
+    size_t _buffer_tail;
+    std::atomic<uint64_t> _bytes_dropped;
+    std::atomic<uint64_t> _bytes_written;
+    size_t _complete_tail;  // The end of the last complete message staged
+    std::condition_variable _condition;
+    std::chrono::steady_clock::time_point _deadline;
+    const duration _flush_delay;
+    const size_t _flush_threshold;
+    std::thread _flusher;
+    std::atomic<uint64_t> _flushes[FLUSH_REASON_COUNT];
+    bool _flusher_idle;
+    MessageFramer _framer;
+    std::atomic<uint64_t> _messages_staged;
+    std::mutex _mutex;
+    bool _running;
+    bool _saturated;
+    FdStream & _stream;
+    std::atomic<uint64_t> _write_calls;
+
+    /*!
+     * \brief Drop every staged byte, because the link has failed
+     */
+    void
+    discard (
+        void
+    );
+
+    /*!
+     * \brief Write staged bytes, up to an offset, to the underlying stream
+     *
+     * \return `true` when every byte up to the offset was written
+     */
+    bool
+    drain (
+        const size_t until_
+    );
+
+    void
+    runFlusher (
+        void
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // WRITE_COMBINING_STREAM_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
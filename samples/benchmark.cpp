@@ -0,0 +1,650 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <AnalogSampler.h>
+#include <CaptureRecorder.h>
+#include <CaptureReplayer.h>
+#include <CaptureStream.h>
+#include <DigitalWriteEngine.h>
+#include <FdStream.h>
+#include <FirmataBoards.h>
+#include <FirmataConstants.h>
+#include <FirmataQuery.h>
+#include <FirmataResponder.h>
+#include <LoopbackStream.h>
+#include <OutboundScheduler.h>
+#include <PinStateMirror.h>
+#include <PinStateSweep.h>
+#include <QueryMetrics.h>
+#include <SevenBitCodec.h>
+#include <StaticFirmataContract.h>
+#include <Trace.h>
+#include <WriteCombiningStream.h>
+
+// Hardware-free benchmarks of the protocol hot paths. A scripted responder
+// plays the part of the remote device over an in-memory stream.
+//
+// Build the library with -DPROTOCOL_TRACE_LEVEL=PROTOCOL_TRACE_LEVEL_NONE
+// (the default with NDEBUG) to measure the paths with tracing compiled away.
+
+using namespace remote_wiring::protocol;
+typedef std::chrono::steady_clock Clock;
+
+static volatile size_t sink;
+
+static double elapsedNs (Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static void report (const char * name, std::vector<double> & samples_ns, const double throughput, const char * throughput_unit) {
+    std::sort(samples_ns.begin(), samples_ns.end());
+    const auto at = [&samples_ns](double p) { return samples_ns[std::min((samples_ns.size() - 1), static_cast<size_t>(p * samples_ns.size()))]; };
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+              << " p50=" << std::setw(10) << at(0.50) << "ns"
+              << " p90=" << std::setw(10) << at(0.90) << "ns"
+              << " p99=" << std::setw(10) << at(0.99) << "ns"
+              << " max=" << std::setw(10) << samples_ns.back() << "ns"
+              << "  " << std::setprecision(2) << throughput << " " << throughput_unit << std::endl;
+}
+
+static DeviceContract * acquireContract (FirmataQuery & query, LoopbackStream & stream) {
+    FirmataResponder responder(stream, ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT);
+    if ( 0 != query.queryContractAsync(&stream, nullptr, nullptr) ) { return nullptr; }
+    responder.begin();
+    if ( std::future_status::ready != query.contractReadyFuture().wait_for(std::chrono::seconds(1)) ) { return nullptr; }
+    return query.detachDeviceContract();
+}
+
+static void benchmarkContractDecode (const size_t iterations) {
+    std::vector<double> samples;
+    const Clock::time_point total = Clock::now();
+
+    for (size_t i = 0 ; i < iterations ; ++i) {
+        LoopbackStream stream;
+        FirmataQuery query;
+        const Clock::time_point start = Clock::now();
+        std::unique_ptr<DeviceContract> contract(acquireContract(query, stream));
+        samples.push_back(elapsedNs(start));
+        sink = (contract ? contract->pinCount() : 0);
+    }
+
+    report("contract_acquire", samples, (iterations / (elapsedNs(total) / 1e9)), "contracts/s");
+}
+
+static std::vector<uint8_t> buildTraffic (const size_t total_bytes) {
+    std::vector<uint8_t> traffic;
+
+    // High-rate analog reporting, interleaved with digital port reports
+    for (uint16_t value = 0 ; traffic.size() < total_bytes ; ++value) {
+        const uint8_t channel = (value % 16);
+        traffic.push_back(firmata::ANALOG_MESSAGE | channel);
+        traffic.push_back(value & 0x7F);
+        traffic.push_back((value >> 7) & 0x07);
+        if ( 0 == (value % 8) ) {
+            traffic.push_back(firmata::DIGITAL_MESSAGE | (channel % 9));
+            traffic.push_back(value & 0x7F);
+            traffic.push_back(0x01);
+        }
+    }
+
+    return traffic;
+}
+
+static void benchmarkParseThroughput (const size_t total_bytes, const size_t chunk_size) {
+    LoopbackStream stream;
+    FirmataQuery query;
+    std::unique_ptr<DeviceContract> contract(acquireContract(query, stream));
+    const std::vector<uint8_t> traffic(buildTraffic(total_bytes));
+    std::vector<double> samples;
+
+    const Clock::time_point total = Clock::now();
+    for (size_t offset = 0 ; offset < traffic.size() ; offset += chunk_size) {
+        const Clock::time_point start = Clock::now();
+        stream.inject(&traffic[offset], std::min(chunk_size, (traffic.size() - offset)));
+        stream.pump();
+        samples.push_back(elapsedNs(start));
+    }
+
+    report("parse_chunk", samples, ((traffic.size() / (1024.0 * 1024.0)) / (elapsedNs(total) / 1e9)), "MiB/s");
+}
+
+static void injectReplay (void * context, const uint8_t * data, size_t size) {
+    LoopbackStream * stream = reinterpret_cast<LoopbackStream *>(context);
+    stream->inject(data, size);
+    stream->pump();
+}
+
+// Parse throughput with the traffic recorded on the way in, then the same
+// capture replayed through a fresh query as fast as possible
+static void benchmarkCapture (const size_t total_bytes, const size_t chunk_size) {
+    char path[] = "/tmp/firmata_benchmark_XXXXXX";
+    const int fd = ::mkstemp(path);
+    LoopbackStream stream;
+    CaptureRecorder recorder;
+    CaptureStream capture(stream, recorder, 0);
+    FirmataQuery query;
+    const std::vector<uint8_t> traffic(buildTraffic(total_bytes));
+    std::vector<double> samples;
+
+    if ( fd < 0 ) { return; }
+    ::close(fd);
+    if ( 0 != recorder.open(path) ) { return; }
+    FirmataResponder responder(stream, ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT);
+    query.queryContractAsync(&capture, nullptr, nullptr);
+    responder.begin();
+    std::unique_ptr<DeviceContract> contract(query.detachDeviceContract());
+    if ( !contract ) { recorder.close(); ::unlink(path); return; }
+
+    Clock::time_point total = Clock::now();
+    for (size_t offset = 0 ; offset < traffic.size() ; offset += chunk_size) {
+        const Clock::time_point start = Clock::now();
+        stream.inject(&traffic[offset], std::min(chunk_size, (traffic.size() - offset)));
+        stream.pump();
+        samples.push_back(elapsedNs(start));
+    }
+    recorder.close();
+    report("parse_chunk_captured", samples, ((traffic.size() / (1024.0 * 1024.0)) / (elapsedNs(total) / 1e9)), "MiB/s");
+
+    CaptureReplayer replayer;
+    LoopbackStream replay_stream;
+    FirmataQuery replay_query;
+    if ( 0 != replayer.open(path) ) { ::unlink(path); return; }
+    replay_query.queryContractAsync(&replay_stream, nullptr, nullptr);
+    samples.clear();
+    total = Clock::now();
+    replayer.replay(0, injectReplay, &replay_stream);
+    samples.push_back(elapsedNs(total));
+    std::unique_ptr<DeviceContract> replayed_contract(replay_query.detachDeviceContract());
+    report("capture_replay", samples, ((replay_query.getMetrics()->snapshot().bytes_received / (1024.0 * 1024.0)) / (samples[0] / 1e9)), "MiB/s");
+    std::cout << "    capture_bytes=" << recorder.bytesRecorded() << " records_dropped=" << recorder.recordsDropped()
+              << " contract_replayed=" << (replayed_contract && (replayed_contract->pinCount() == contract->pinCount())) << std::endl;
+    ::unlink(path);
+}
+
+// Analog reports decoded into per-pin rings, drained in batches once per chunk
+static void benchmarkAnalogIngest (const size_t total_bytes, const size_t chunk_size) {
+    LoopbackStream stream;
+    FirmataQuery query;
+    std::unique_ptr<DeviceContract> contract(acquireContract(query, stream));
+    const std::vector<uint8_t> traffic(buildTraffic(total_bytes));
+    std::vector<double> samples;
+    size_t samples_read = 0;
+    size_t samples_dropped = 0;
+
+    if ( !contract ) { return; }
+    AnalogSampler sampler(*contract);
+    query.setAnalogSampler(&sampler);
+    sampler.begin(stream);
+
+    const PinSet pins = sampler.pins();
+    size_t checksum = 0;  // Consumes each sample, without a volatile access per sample
+    const Clock::time_point total = Clock::now();
+    for (size_t offset = 0 ; offset < traffic.size() ; offset += chunk_size) {
+        const Clock::time_point start = Clock::now();
+        stream.inject(&traffic[offset], std::min(chunk_size, (traffic.size() - offset)));
+        stream.pump();
+        for (size_t pin = pins.next(0) ; pin < PinSet::CAPACITY ; pin = pins.next(pin + 1)) {
+            const AnalogSample * batch;
+            for (size_t count ; (count = sampler.peek(pin, &batch)) ; sampler.release(pin, count)) {
+                for (size_t i = 0 ; i < count ; ++i) { checksum += batch[i].value; }
+                samples_read += count;
+            }
+        }
+        samples.push_back(elapsedNs(start));
+    }
+    for (size_t pin = pins.next(0) ; pin < PinSet::CAPACITY ; pin = pins.next(pin + 1)) { samples_dropped += sampler.samplesDropped(pin); }
+    query.setAnalogSampler(nullptr);
+    sink = checksum;
+
+    report("analog_ingest_chunk", samples, ((samples_read / 1e6) / (elapsedNs(total) / 1e9)), "Msamples/s");
+    std::cout << "    samples_read=" << samples_read << " samples_dropped=" << samples_dropped << std::endl;
+}
+
+static void slowPinConfigCallback (void * context, size_t pin, const PinConfig & config) {
+    const Clock::time_point start = Clock::now();
+    (void)context; (void)pin; (void)config;
+    while ( elapsedNs(start) < 10000.0 ) {}
+}
+
+// Time the transport thread spends in each serial event while a slow user
+// callback runs, parsing inline versus handing the bytes to a parser thread
+static void benchmarkSerialEventHandoff (const size_t iterations) {
+    const char * names[] = { "serial_event_inline", "serial_event_handoff" };
+
+    for (size_t mode = 0 ; mode < 2 ; ++mode) {
+        std::vector<double> samples;
+        QueryMetricsSnapshot snapshot = QueryMetricsSnapshot();
+        const Clock::time_point total = Clock::now();
+
+        for (size_t i = 0 ; i < iterations ; ++i) {
+            LoopbackStream stream;
+            FirmataQuery query;
+            FirmataResponder responder(stream, ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT);
+
+            if ( mode ) { query.enableParserThread(); }
+            query.setPinConfigCallback(slowPinConfigCallback, nullptr);
+            query.queryContractAsync(&stream, nullptr, nullptr);
+
+            // The responder raises the first serial event itself
+            const Clock::time_point start = Clock::now();
+            responder.begin();
+            samples.push_back(elapsedNs(start));
+            while ( std::future_status::ready != query.contractReadyFuture().wait_for(std::chrono::microseconds(100)) ) {
+                const Clock::time_point start = Clock::now();
+                if ( stream.pump() ) { samples.push_back(elapsedNs(start)); }
+            }
+            snapshot = query.getMetrics()->snapshot();
+        }
+
+        report(names[mode], samples, (iterations / (elapsedNs(total) / 1e9)), "contracts/s");
+        if ( mode ) {
+            std::cout << "    parser_wakeups=" << snapshot.parser_wakeups
+                      << " ring_high_water_mark=" << snapshot.ring_high_water_mark
+                      << " ring_overruns=" << snapshot.ring_overruns << std::endl;
+        }
+    }
+}
+
+static void benchmarkCapabilityLookup (const size_t iterations) {
+    LoopbackStream stream;
+    FirmataQuery query;
+    std::unique_ptr<DeviceContract> contract(acquireContract(query, stream));
+    StaticFirmataContractAdapter<ArduinoMega> static_adapter;
+    const DeviceContract * contracts[] = { contract.get(), &static_adapter };
+    const char * names[] = { "lookup_per_pin_runtime", "lookup_per_pin_static" };
+    std::vector<double> samples;
+
+    if ( !contract ) { return; }
+
+    // One virtual call per pin, as a configuration validator would make
+    for (size_t c = 0 ; c < 2 ; ++c) {
+        samples.clear();
+        const Clock::time_point total = Clock::now();
+        for (size_t i = 0 ; i < iterations ; ++i) {
+            const Clock::time_point start = Clock::now();
+            size_t count = 0;
+            for (size_t pin = 0 ; pin < contracts[c]->pinCount() ; ++pin) { count += contracts[c]->analogWriteAvailableOnPin(pin); }
+            samples.push_back(elapsedNs(start));
+            sink = count;
+        }
+        report(names[c], samples, ((iterations * contracts[c]->pinCount()) / (elapsedNs(total) / 1e9) / 1e6), "Mchecks/s");
+    }
+
+    // One bulk query per sweep
+    samples.clear();
+    const Clock::time_point total = Clock::now();
+    for (size_t i = 0 ; i < iterations ; ++i) {
+        const Clock::time_point start = Clock::now();
+        sink = contract->countPinsWithCapability(ANALOG_WRITE);
+        samples.push_back(elapsedNs(start));
+    }
+    report("lookup_bulk_runtime", samples, ((iterations * contract->pinCount()) / (elapsedNs(total) / 1e9) / 1e6), "Mchecks/s");
+}
+
+// Wire cost of toggling 40 outputs (five 8-pin ports) per tick, as
+// individual SET_DIGITAL_PIN_VALUE messages versus coalesced port messages
+static void benchmarkDigitalWrite (const size_t ticks) {
+    StaticFirmataContractAdapter<ArduinoMega> contract;
+    LoopbackStream stream;
+    DigitalWriteEngine engine(contract);
+    firmata::FirmataMarshaller marshaller;
+    std::vector<double> samples;
+    const size_t FIRST_PIN = 24;
+    const size_t PIN_COUNT = 40;
+
+    marshaller.begin(stream);
+    for (size_t tick = 0 ; tick < ticks ; ++tick) {
+        for (size_t pin = FIRST_PIN ; pin < (FIRST_PIN + PIN_COUNT) ; ++pin) { marshaller.sendDigital(pin, (tick & 1)); }
+    }
+    const size_t per_pin_bytes = stream.writeCount();
+
+    engine.begin(stream);
+    const Clock::time_point total = Clock::now();
+    for (size_t tick = 0 ; tick < ticks ; ++tick) {
+        const Clock::time_point start = Clock::now();
+        for (size_t pin = FIRST_PIN ; pin < (FIRST_PIN + PIN_COUNT) ; ++pin) { engine.digitalWrite(pin, (tick & 1)); }
+        engine.flush();
+        samples.push_back(elapsedNs(start));
+    }
+    const size_t coalesced_bytes = (stream.writeCount() - per_pin_bytes);
+
+    report("digital_write_tick", samples, (ticks / (elapsedNs(total) / 1e9)), "ticks/s");
+    std::cout << "    bytes/tick per_pin=" << (per_pin_bytes / ticks) << " coalesced=" << (coalesced_bytes / ticks)
+              << " (" << std::setprecision(2) << ((coalesced_bytes / ticks) * 10 / 57.6) << "ms at 57600 baud vs "
+              << ((per_pin_bytes / ticks) * 10 / 57.6) << "ms)" << std::endl;
+}
+
+// 7-bit pair encoding of sysex payloads, per kernel, for I2C-sized and
+// bulk serial passthrough payloads (samples are the mean of a batch)
+static void benchmarkSevenBitCodec (const size_t total_bytes) {
+    const size_t payload_sizes[] = { 32, 4096 };
+    const SevenBitCodec::Kernel selected = SevenBitCodec::kernel();
+    const size_t BATCH = 64;  // Calls per sample, so small payloads outweigh the clock
+
+    for (size_t kernel = 0 ; kernel < SevenBitCodec::KERNEL_COUNT ; ++kernel) {
+        if ( 0 != SevenBitCodec::useKernel(static_cast<SevenBitCodec::Kernel>(kernel)) ) { continue; }
+        for (size_t payload_size : payload_sizes) {
+            std::vector<uint8_t> data(payload_size), encoded(2 * payload_size);
+            const size_t iterations = (total_bytes / payload_size);
+            std::vector<double> encode_samples, decode_samples;
+            std::string name(SevenBitCodec::kernelName(static_cast<SevenBitCodec::Kernel>(kernel)));
+
+            for (size_t i = 0 ; i < payload_size ; ++i) { data[i] = static_cast<uint8_t>(i * 131); }
+            Clock::time_point total = Clock::now();
+            for (size_t i = 0 ; i < iterations ; i += BATCH) {
+                const Clock::time_point start = Clock::now();
+                for (size_t j = 0 ; j < BATCH ; ++j) { SevenBitCodec::encode(data.data(), payload_size, encoded.data()); }
+                encode_samples.push_back(elapsedNs(start) / BATCH);
+            }
+            report(("sysex_encode_" + name + "_" + std::to_string(payload_size)).c_str(), encode_samples, ((total_bytes / (1024.0 * 1024.0)) / (elapsedNs(total) / 1e9)), "MiB/s");
+
+            total = Clock::now();
+            for (size_t i = 0 ; i < iterations ; i += BATCH) {
+                const Clock::time_point start = Clock::now();
+                for (size_t j = 0 ; j < BATCH ; ++j) { SevenBitCodec::decode(encoded.data(), encoded.size(), data.data()); }
+                decode_samples.push_back(elapsedNs(start) / BATCH);
+            }
+            report(("sysex_decode_" + name + "_" + std::to_string(payload_size)).c_str(), decode_samples, ((total_bytes / (1024.0 * 1024.0)) / (elapsedNs(total) / 1e9)), "MiB/s");
+            sink = data[0];
+        }
+    }
+    SevenBitCodec::useKernel(selected);
+}
+
+// A descriptor stream that counts the byte writes made to it, each of which
+// is at least one system call
+class CountingFdStream : public FdStream {
+  public:
+    explicit CountingFdStream (const int fd) : FdStream(fd), _write_calls(0) {}
+
+    size_t write (uint8_t byte) override {
+        ++_write_calls;
+        return FdStream::write(byte);
+    }
+
+    uint64_t writeCalls (void) const { return _write_calls; }
+
+  private:
+    uint64_t _write_calls;
+};
+
+// System calls per message when a busy host streams analog writes to a
+// descriptor, written byte by byte versus through a write-combining buffer
+static void benchmarkWriteCombining (const size_t messages) {
+    const char * names[] = { "outbound_per_byte", "outbound_combined" };
+
+    for (size_t mode = 0 ; mode < 2 ; ++mode) {
+        int link[2];
+        if ( 0 != ::pipe(link) ) { return; }
+        std::thread reader([&link]() {
+            uint8_t buffer[4096];
+            while ( ::read(link[0], buffer, sizeof(buffer)) > 0 ) {}
+        });
+        CountingFdStream descriptor(link[1]);
+        descriptor.begin(57600, 0x06);
+        std::unique_ptr<WriteCombiningStream> combining(mode ? new WriteCombiningStream(descriptor) : nullptr);
+        Stream & stream = (mode ? static_cast<Stream &>(*combining) : static_cast<Stream &>(descriptor));
+        firmata::FirmataMarshaller marshaller;
+        std::vector<double> samples;
+
+        marshaller.begin(stream);
+        const Clock::time_point total = Clock::now();
+        for (size_t i = 0 ; i < messages ; ++i) {
+            const Clock::time_point start = Clock::now();
+            marshaller.sendAnalog((i % 16), (i & 0x3FFF));
+            samples.push_back(elapsedNs(start));
+        }
+        stream.flush();
+        report(names[mode], samples, (messages / (elapsedNs(total) / 1e9)), "msgs/s");
+        std::cout << "    syscalls/message=" << std::setprecision(3)
+                  << (static_cast<double>(mode ? combining->writeCalls() : descriptor.writeCalls()) / messages);
+        if ( mode ) {
+            std::cout << " threshold_flushes=" << combining->flushes(WriteCombiningStream::FLUSH_THRESHOLD)
+                      << " deadline_flushes=" << combining->flushes(WriteCombiningStream::FLUSH_DEADLINE)
+                      << " backpressure_waits=" << combining->backpressureWaits();
+        }
+        std::cout << std::endl;
+
+        combining.reset();
+        ::close(link[1]);
+        reader.join();
+        ::close(link[0]);
+    }
+}
+
+// A link that holds each reply from the device for a fixed latency, as the
+// latency timer of a USB serial adapter does. Host writes reach the
+// responder at once, and its replies are delivered on a separate thread.
+class DelayedLink {
+  public:
+    DelayedLink (LoopbackStream & host, LoopbackStream & device, const Clock::duration latency) :
+        _device(device),
+        _host(host),
+        _latency(latency),
+        _running(true)
+    {
+        _host.setWriteHandler(DelayedLink::forward, &_device);
+        _device.registerSerialEventCallback(DelayedLink::capture, this);
+        _delivery = std::thread(&DelayedLink::deliver, this);
+    }
+
+    ~DelayedLink () {
+        { std::lock_guard<std::mutex> lock(_mutex); _running = false; }
+        _condition.notify_one();
+        _delivery.join();
+        _device.registerSerialEventCallback(nullptr, nullptr);
+        _host.setWriteHandler(nullptr, nullptr);
+    }
+
+  private:
+    struct Reply {
+        Clock::time_point due;
+        std::vector<uint8_t> bytes;
+    };
+
+    std::condition_variable _condition;
+    std::thread _delivery;
+    LoopbackStream & _device;
+    LoopbackStream & _host;
+    const Clock::duration _latency;
+    std::mutex _mutex;
+    std::deque<Reply> _replies;
+    bool _running;
+
+    static void forward (void * context, uint8_t byte) {
+        reinterpret_cast<LoopbackStream *>(context)->write(byte);
+    }
+
+    static void capture (void * context) {
+        DelayedLink * link = reinterpret_cast<DelayedLink *>(context);
+        Reply reply;
+        reply.due = (Clock::now() + link->_latency);
+        for (int byte ; (byte = link->_device.read()) >= 0 ; ) { reply.bytes.push_back(static_cast<uint8_t>(byte)); }
+        { std::lock_guard<std::mutex> lock(link->_mutex); link->_replies.push_back(std::move(reply)); }
+        link->_condition.notify_one();
+    }
+
+    void deliver (void) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while ( _running ) {
+            if ( _replies.empty() ) { _condition.wait(lock); continue; }
+            if ( Clock::now() < _replies.front().due ) { _condition.wait_until(lock, _replies.front().due); continue; }
+            Reply reply(std::move(_replies.front()));
+            _replies.pop_front();
+            lock.unlock();
+            _host.inject(reply.bytes.data(), reply.bytes.size());
+            _host.pump();
+            lock.lock();
+        }
+    }
+};
+
+// Time to collect the mode and state of every pin of a Mega over a link
+// with a 2ms round trip, for increasing numbers of queries in flight
+static void benchmarkPinStateSweep (const size_t iterations) {
+    const size_t windows[] = { 1, 2, 4, 8, 16, 32 };
+    LoopbackStream host;
+    LoopbackStream device;
+    FirmataResponder responder(device, ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT);
+    FirmataQuery query;
+    DelayedLink link(host, device, std::chrono::milliseconds(2));
+
+    if ( 0 != query.queryContractAsync(&host, nullptr, nullptr) ) { return; }
+    responder.begin();
+    if ( std::future_status::ready != query.contractReadyFuture().wait_for(std::chrono::seconds(1)) ) { return; }
+    std::unique_ptr<DeviceContract> contract(query.detachDeviceContract());
+    PinStateMirror mirror(*contract);
+    std::vector<PinStateReport> snapshot;
+
+    query.setPinStateMirror(&mirror);
+    for (size_t w = 0 ; w < (sizeof(windows) / sizeof(windows[0])) ; ++w) {
+        PinStateSweep sweep(mirror, contract->pinCount(), windows[w]);
+        std::vector<double> samples;
+        std::string name("pin_sweep_window_" + std::to_string(windows[w]));
+
+        sweep.begin(host);
+        const Clock::time_point total = Clock::now();
+        for (size_t i = 0 ; i < iterations ; ++i) {
+            const Clock::time_point start = Clock::now();
+            if ( 0 != sweep.sweep(std::chrono::seconds(5), &snapshot) ) { std::cout << name << " timed out" << std::endl; break; }
+            samples.push_back(elapsedNs(start));
+        }
+        if ( samples.empty() ) { continue; }
+        report(name.c_str(), samples, ((samples.size() * contract->pinCount()) / (elapsedNs(total) / 1e9)), "pins/s");
+    }
+    query.setPinStateMirror(nullptr);
+}
+
+// A UART at 115200 baud with a 16 byte transmit FIFO; a write blocks while
+// the FIFO is full. The link times each DIGITAL_MESSAGE from the moment it
+// was written to a lane, until its last byte leaves the wire.
+class PacedLink : public Stream {
+  public:
+    static const size_t FIFO_DEPTH = 16;
+
+    std::atomic<Clock::rep> sent_at[128];
+    std::vector<double> control_latency_ns;
+
+    PacedLink () : _busy_until(Clock::now()), _control_bytes(0), _sequence(0) {}
+
+    size_t available (void) override { return 0; }
+    void begin (const size_t, const size_t) override {}
+    void end (void) override {}
+    void flush (void) override { std::this_thread::sleep_until(_busy_until); }
+    int peek (void) override { return -1; }
+    int read (void) override { return -1; }
+    void registerSerialEventCallback (serialEvent, void *) override {}
+
+    size_t write (uint8_t byte) override {
+        const Clock::time_point now = Clock::now();
+        if ( _busy_until < now ) { _busy_until = now; }
+        if ( (_busy_until - now) >= (FIFO_DEPTH * BYTE_TIME) ) { std::this_thread::sleep_until(_busy_until - ((FIFO_DEPTH / 2) * BYTE_TIME)); }
+        _busy_until += BYTE_TIME;
+
+        if ( (byte & 0xF0) == firmata::DIGITAL_MESSAGE ) {
+            _control_bytes = 1;
+        } else if ( (byte & 0x80) || !_control_bytes ) {
+            _control_bytes = 0;
+        } else if ( 1 == _control_bytes++ ) {
+            _sequence = byte;
+        } else {
+            const Clock::time_point sent(Clock::duration(sent_at[_sequence].load()));
+            control_latency_ns.push_back(std::chrono::duration<double, std::nano>(_busy_until - sent).count());
+            _control_bytes = 0;
+        }
+        return 1;
+    }
+
+  private:
+    static constexpr Clock::duration BYTE_TIME = std::chrono::microseconds(87);
+
+    Clock::time_point _busy_until;
+    size_t _control_bytes;
+    uint8_t _sequence;
+};
+constexpr Clock::duration PacedLink::BYTE_TIME;
+
+// The (inclusive) bound of the histogram bucket holding a percentile of the samples
+static uint64_t histogramPercentileUs (const HistogramSnapshot & histogram, const double p) {
+    uint64_t seen = 0;
+    for (size_t bucket = 0 ; bucket < HistogramSnapshot::BUCKET_COUNT ; ++bucket) {
+        if ( (seen += histogram.buckets[bucket]) >= (p * histogram.count) ) { return (1ULL << bucket); }
+    }
+    return (1ULL << (HistogramSnapshot::BUCKET_COUNT - 1));
+}
+
+// Latency of digital writes issued every 2ms, while four writers saturate a
+// 115200 baud link with 64 byte sysex strings; first sharing their class,
+// then served ahead of it
+static void benchmarkOutboundScheduler (const std::chrono::milliseconds duration) {
+    const char * names[] = { "control_shared_class", "control_priority_class" };
+    const size_t BULK_WRITERS = 4;
+
+    for (size_t mode = 0 ; mode < 2 ; ++mode) {
+        PacedLink link;
+        OutboundScheduler scheduler(link);
+        OutboundScheduler::Lane * control = scheduler.openLane(mode ? OutboundScheduler::PRIORITY_CONTROL : OutboundScheduler::PRIORITY_BULK);
+        std::atomic_bool running(true);
+        std::vector<std::thread> writers;
+
+        for (size_t writer = 0 ; writer < BULK_WRITERS ; ++writer) {
+            OutboundScheduler::Lane * bulk = scheduler.openLane(OutboundScheduler::PRIORITY_BULK);
+            writers.emplace_back([bulk, &running]() {
+                while ( running ) {
+                    bulk->write(firmata::START_SYSEX);
+                    bulk->write(firmata::STRING_DATA);
+                    for (size_t i = 0 ; i < 61 ; ++i) { bulk->write('a' + (i % 26)); }
+                    bulk->write(firmata::END_SYSEX);
+                }
+            });
+        }
+
+        const Clock::time_point total = Clock::now();
+        for (uint8_t sequence = 0 ; (Clock::now() - total) < duration ; sequence = ((sequence + 1) & 0x7F)) {
+            link.sent_at[sequence].store(Clock::now().time_since_epoch().count());
+            control->write(firmata::DIGITAL_MESSAGE);
+            control->write(sequence);
+            control->write(0x00);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        running = false;
+        for (size_t writer = 0 ; writer < writers.size() ; ++writer) { writers[writer].join(); }
+        scheduler.flush();
+
+        report(names[mode], link.control_latency_ns, (scheduler.bytesSent(OutboundScheduler::PRIORITY_BULK) / (elapsedNs(total) / 1e9)), "bytes/s");
+        const HistogramSnapshot control_wait = scheduler.queueLatency(control->priorityClass());
+        const HistogramSnapshot bulk_wait = scheduler.queueLatency(OutboundScheduler::PRIORITY_BULK);
+        std::cout << "    queue_wait_p99: control<" << histogramPercentileUs(control_wait, 0.99) << "us"
+                  << " bulk<" << histogramPercentileUs(bulk_wait, 0.99) << "us"
+                  << " bulk_backpressure_waits=" << scheduler.backpressureWaits(OutboundScheduler::PRIORITY_BULK) << std::endl;
+    }
+}
+
+int main (void) {
+    std::cout << ">>Firmata Protocol Benchmarks<<" << std::endl;
+    std::cout << "trace level: " << PROTOCOL_TRACE_LEVEL << std::endl;
+
+    benchmarkContractDecode(200);
+    benchmarkParseThroughput((8 * 1024 * 1024), 4096);
+    benchmarkCapture((8 * 1024 * 1024), 4096);
+    benchmarkAnalogIngest((8 * 1024 * 1024), 4096);
+    benchmarkSerialEventHandoff(50);
+    benchmarkCapabilityLookup(100000);
+    benchmarkDigitalWrite(10000);
+    benchmarkSevenBitCodec(64 * 1024 * 1024);
+    benchmarkWriteCombining(200000);
+    benchmarkOutboundScheduler(std::chrono::milliseconds(1000));
+    benchmarkPinStateSweep(5);
+
+    return 0;
+}
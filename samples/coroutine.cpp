@@ -0,0 +1,78 @@
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <DeviceContract.h>
+#include <FirmataBoards.h>
+#include <FirmataQuery.h>
+#include <FirmataResponder.h>
+#include <LoopbackStream.h>
+
+// Build with -std=c++20
+//
+// Acquires the contracts of many simulated devices from a single thread.
+// Each device is served by a coroutine that suspends on `co_await
+// query.contract(stream)`, and is resumed by the parser callback once its
+// contract is ready; no thread waits on a future.
+
+using namespace remote_wiring::protocol;
+
+// A fire-and-forget coroutine, started eagerly
+struct Detached {
+    struct promise_type {
+        Detached get_return_object (void) { return Detached(); }
+        std::suspend_never initial_suspend (void) noexcept { return {}; }
+        std::suspend_never final_suspend (void) noexcept { return {}; }
+        void return_void (void) {}
+        void unhandled_exception (void) { std::terminate(); }
+    };
+};
+
+// The responder is attached as the device boots, so the queries sent
+// beforehand go unanswered, as they would while a board resets
+struct Device {
+    LoopbackStream stream;
+    FirmataQuery query;
+    std::optional<FirmataResponder> responder;
+
+    void boot (void) {
+        responder.emplace(stream, ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT);
+        responder->begin();
+    }
+};
+
+static size_t analog_pins;
+static size_t contracts_acquired;
+
+static Detached acquire (Device & device) {
+    std::unique_ptr<DeviceContract> contract = co_await device.query.contract(&device.stream);
+    if ( !contract ) { co_return; }
+
+    ++contracts_acquired;
+    analog_pins += contract->countPinsWithCapability(ANALOG_READ);
+}
+
+int main (int argc, char * argv[]) {
+    const size_t device_count = ((argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000);
+    std::vector<std::unique_ptr<Device>> devices;
+
+    std::cout << ">>Firmata Coroutine Sample<<" << std::endl;
+    for (size_t i = 0 ; i < device_count ; ++i) { devices.emplace_back(new Device); }
+
+    // Every coroutine suspends, awaiting its device
+    const auto start = std::chrono::steady_clock::now();
+    for (auto & device : devices) { acquire(*device); }
+    std::cout << "in flight: " << (device_count - contracts_acquired) << std::endl;
+
+    // Each device boots, and its coroutine resumes from the parser callback
+    for (auto & device : devices) { device->boot(); }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    std::cout << "contracts acquired: " << contracts_acquired << " of " << device_count
+              << " (" << analog_pins << " analog pins) in " << elapsed.count() << "us" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <FdStream.h>
+#include <FirmataBoards.h>
+#include <FirmataConstants.h>
+#include <FirmataQuery.h>
+#include <FirmataResponder.h>
+#include <LoopbackStream.h>
+#include <QueryMetrics.h>
+#include <SerialReactor.h>
+
+// Usage: reactor_benchmark [links=64] [seconds=2] [workers=1]
+//
+// Simulates many boards over pseudo-terminals and compares the host cost of
+// servicing them with one thread per link against the epoll reactor. The
+// boards run in a child process, so the resource usage reported is that of
+// the host alone. Each board answers the contract queries, then streams an
+// analog message every millisecond.
+
+using namespace remote_wiring::protocol;
+typedef std::chrono::steady_clock Clock;
+
+struct Link {
+    int master;
+    int slave;
+};
+
+static bool openLinks (const size_t count, std::vector<Link> & links) {
+    for (size_t i = 0 ; i < count ; ++i) {
+        Link link;
+        link.master = ::posix_openpt(O_RDWR | O_NOCTTY);
+        if ( link.master < 0 || ::grantpt(link.master) || ::unlockpt(link.master) ) { return false; }
+        link.slave = ::open(::ptsname(link.master), (O_RDWR | O_NOCTTY));
+        if ( link.slave < 0 ) { return false; }
+        links.push_back(link);
+    }
+    return true;
+}
+
+static void forward (LoopbackStream & board, const int master) {
+    uint8_t buffer[512];
+    size_t size = 0;
+    for (int byte ; -1 != (byte = board.read()) ;) {
+        buffer[size++] = static_cast<uint8_t>(byte);
+        if ( sizeof(buffer) == size ) { if ( ::write(master, buffer, size) < 0 ) { return; } size = 0; }
+    }
+    if ( size && ::write(master, buffer, size) < 0 ) { return; }
+}
+
+// Plays every board from a single thread of the child process
+static void simulateBoards (const std::vector<Link> & links) {
+    std::vector<std::unique_ptr<LoopbackStream>> boards;
+    std::vector<std::unique_ptr<FirmataResponder>> responders;
+    std::vector<pollfd> fds;
+
+    for (const Link & link : links) {
+        ::close(link.slave);
+        boards.emplace_back(new LoopbackStream);
+        responders.emplace_back(new FirmataResponder(*boards.back(), ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT));
+        responders.back()->begin();
+        forward(*boards.back(), link.master);
+        fds.push_back(pollfd{ link.master, POLLIN, 0 });
+    }
+
+    for (uint16_t sample = 0 ;; ++sample) {
+        const uint8_t analog[3] = { static_cast<uint8_t>(firmata::ANALOG_MESSAGE), static_cast<uint8_t>(sample & 0x7F), static_cast<uint8_t>((sample >> 7) & 0x07) };
+        if ( ::poll(fds.data(), fds.size(), 1) > 0 ) {
+            for (size_t i = 0 ; i < fds.size() ; ++i) {
+                uint8_t request[256];
+                if ( !(fds[i].revents & POLLIN) ) { continue; }
+                const ssize_t size = ::read(fds[i].fd, request, sizeof(request));
+                for (ssize_t j = 0 ; j < size ; ++j) { boards[i]->write(request[j]); }
+                forward(*boards[i], fds[i].fd);
+            }
+        }
+        for (const Link & link : links) {
+            if ( ::write(link.master, analog, sizeof(analog)) < 0 ) { return; }
+        }
+    }
+}
+
+static double cpuMs (const rusage & usage) {
+    return (((usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0) + ((usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0));
+}
+
+static void runMode (const bool use_reactor, const size_t link_count, const size_t seconds, const size_t worker_count) {
+    std::vector<Link> links;
+    if ( !openLinks(link_count, links) ) {
+        std::cerr << "Unable to open " << link_count << " pseudo-terminals" << std::endl;
+        return;
+    }
+
+    const pid_t child = ::fork();
+    if ( 0 == child ) {
+        simulateBoards(links);
+        ::_exit(0);
+    }
+
+    std::vector<std::unique_ptr<FdStream>> streams;
+    std::vector<std::unique_ptr<FirmataQuery>> queries;
+    for (const Link & link : links) {
+        ::close(link.master);
+        streams.emplace_back(new FdStream(link.slave));
+        streams.back()->begin(57600, 0x06);
+        queries.emplace_back(new FirmataQuery);
+    }
+
+    rusage before, after;
+    ::getrusage(RUSAGE_SELF, &before);
+    const Clock::time_point start = Clock::now();
+
+    for (size_t i = 0 ; i < link_count ; ++i) {
+        queries[i]->queryContractAsync(streams[i].get(), nullptr, nullptr);
+    }
+
+    // Service the links
+    SerialReactor reactor;
+    std::atomic_bool running(true);
+    std::atomic<size_t> thread_wakeups(0);
+    std::vector<std::thread> link_threads;
+    if ( use_reactor ) {
+        for (auto & stream : streams) { reactor.attach(*stream); }
+        reactor.start(worker_count);
+    } else {
+        for (auto & stream : streams) {
+            FdStream * link = stream.get();
+            link_threads.emplace_back([link, &running, &thread_wakeups]() {
+                pollfd fd = { link->fd(), POLLIN, 0 };
+                while ( running ) {
+                    if ( ::poll(&fd, 1, 100) <= 0 ) { continue; }
+                    thread_wakeups.fetch_add(1, std::memory_order_relaxed);
+                    if ( link->service() < 0 ) { break; }
+                }
+            });
+        }
+    }
+
+    size_t contracts = 0;
+    for (auto & query : queries) {
+        if ( std::future_status::ready == query->contractReadyFuture().wait_for(std::chrono::seconds(10)) ) { ++contracts; }
+    }
+    const double acquire_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+
+    if ( use_reactor ) {
+        reactor.stop();
+    } else {
+        running = false;
+        for (auto & thread : link_threads) { thread.join(); }
+    }
+    ::getrusage(RUSAGE_SELF, &after);
+    ::kill(child, SIGTERM);
+    ::waitpid(child, nullptr, 0);
+
+    size_t bytes = 0;
+    for (auto & query : queries) {
+        bytes += query->getMetrics()->snapshot().bytes_received;
+        delete query->detachDeviceContract();
+    }
+    queries.clear();
+    for (const Link & link : links) { ::close(link.slave); }
+
+    std::cout << (use_reactor ? "reactor" : "thread_per_link") << ","
+              << link_count << ","
+              << (use_reactor ? worker_count : link_count) << ","
+              << contracts << ","
+              << acquire_ms << ","
+              << (cpuMs(after) - cpuMs(before)) << ","
+              << (use_reactor ? reactor.wakeups() : thread_wakeups.load()) << ","
+              << ((after.ru_nvcsw + after.ru_nivcsw) - (before.ru_nvcsw + before.ru_nivcsw)) << ","
+              << bytes << std::endl;
+}
+
+int main (int argc, char * argv[]) {
+    const size_t link_count = ((argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 64);
+    const size_t seconds = ((argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 2);
+    const size_t worker_count = ((argc > 3) ? std::strtoul(argv[3], nullptr, 10) : 1);
+
+    std::cout << ">>Firmata Reactor Benchmark<<" << std::endl;
+    std::cout << "mode,links,threads,contracts,acquire_ms,cpu_ms,wakeups,context_switches,bytes" << std::endl;
+    runMode(false, link_count, seconds, worker_count);
+    runMode(true, link_count, seconds, worker_count);
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <CaptureReplayer.h>
+#include <FirmataQuery.h>
+#include <LoopbackStream.h>
+#include <QueryMetrics.h>
+
+// Usage: replay <capture> [stream_id=0] [speed=0]
+//
+// Summarizes a capture recorded with `CaptureStream`, then feeds the bytes
+// one of its streams received through a `FirmataQuery`, either as fast as
+// possible (speed 0) or at a multiple of the recorded pace (speed 1 replays
+// at wire speed), to reproduce what the host saw.
+
+using namespace remote_wiring::protocol;
+typedef std::chrono::steady_clock Clock;
+
+static void injectReplay (void * context, const uint8_t * data, size_t size) {
+    LoopbackStream * stream = reinterpret_cast<LoopbackStream *>(context);
+    stream->inject(data, size);
+    stream->pump();
+}
+
+int main (int argc, char * argv[]) {
+    if ( argc < 2 ) {
+        std::cerr << "Usage: " << argv[0] << " <capture> [stream_id=0] [speed=0]" << std::endl;
+        return 1;
+    }
+    const uint16_t stream_id = static_cast<uint16_t>((argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 0);
+    const double speed = ((argc > 3) ? std::strtod(argv[3], nullptr) : CaptureReplayer::AS_FAST_AS_POSSIBLE);
+
+    CaptureReplayer replayer;
+    if ( 0 != replayer.open(argv[1]) ) {
+        std::cerr << "Unable to open capture " << argv[1] << std::endl;
+        return 1;
+    }
+
+    // Summarize the traffic of each stream
+    std::map<uint16_t, std::pair<uint64_t, uint64_t>> bytes;
+    uint64_t records = 0, duration_ns = 0;
+    for (const CaptureRecord * record = replayer.first() ; record ; record = replayer.next(record)) {
+        std::pair<uint64_t, uint64_t> & stream_bytes = bytes[record->stream_id];
+        ((CAPTURE_RX == record->direction) ? stream_bytes.first : stream_bytes.second) += record->size;
+        duration_ns = std::max(duration_ns, record->timestamp_ns);
+        ++records;
+    }
+    std::cout << "capture: " << records << " records over " << std::fixed << std::setprecision(3) << (duration_ns / 1e9) << "s" << std::endl;
+    for (const auto & stream : bytes) {
+        std::cout << "  stream " << stream.first << ": rx=" << stream.second.first << " tx=" << stream.second.second << " bytes" << std::endl;
+    }
+
+    LoopbackStream stream;
+    FirmataQuery query;
+    query.queryContractAsync(&stream, nullptr, nullptr);
+    const Clock::time_point start = Clock::now();
+    replayer.replay(stream_id, injectReplay, &stream, speed);
+    const double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const QueryMetricsSnapshot snapshot = query.getMetrics()->snapshot();
+    std::unique_ptr<DeviceContract> contract(query.detachDeviceContract());
+    std::cout << "replay: " << snapshot.bytes_received << " bytes, " << snapshot.frames_received << " frames, "
+              << snapshot.parse_errors << " parse errors in " << elapsed_s << "s ("
+              << std::setprecision(2) << ((snapshot.bytes_received / (1024.0 * 1024.0)) / elapsed_s) << " MiB/s)" << std::endl;
+    if ( contract ) {
+        std::cout << "contract: " << contract->pinCount() << " pins" << std::endl;
+    } else {
+        std::cout << "contract: not acquired" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <AnalogSampler.h>
+#include <DigitalWriteEngine.h>
+#include <FdStream.h>
+#include <FirmataBoards.h>
+#include <FirmataConstants.h>
+#include <FirmataQuery.h>
+#include <FirmataResponder.h>
+#include <LoopbackStream.h>
+#include <QueryMetrics.h>
+#include <SerialReactor.h>
+
+// Usage: soak [boards=256] [seconds=10] [layout=mixed] [rate_hz=50] [workers=1] [simulators=1]
+//
+// Soaks the host against a fleet of simulated boards over pseudo-terminals.
+// Each board is a `FirmataResponder` (uno, mega, or alternating for mixed)
+// run by one of `simulators` child processes. Once the host has acquired
+// every contract, it enables analog reporting on every board, and each
+// board reports every enabled channel `rate_hz` times a second, while the
+// host drains the samples and toggles a digital output on every board ten
+// times a second. The report covers startup time, sustained throughput, and
+// the CPU and memory the host spends per board.
+//
+// Raise the descriptor limit (ulimit -n) and /proc/sys/kernel/pty/max to
+// soak more than a few hundred boards.
+
+using namespace remote_wiring::protocol;
+typedef std::chrono::steady_clock Clock;
+
+struct Link {
+    int master;
+    int slave;
+    bool mega;
+};
+
+struct SimulatorTotals {
+    uint64_t bytes_received;
+    uint64_t reports_sent;
+};
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void requestStop (int signal) {
+    (void)signal;
+    stop_requested = 1;
+}
+
+static bool openLinks (const size_t count, const std::string & layout, std::vector<Link> & links) {
+    for (size_t i = 0 ; i < count ; ++i) {
+        Link link;
+        link.master = ::posix_openpt(O_RDWR | O_NOCTTY);
+        if ( link.master < 0 || ::grantpt(link.master) || ::unlockpt(link.master) ) { return false; }
+        link.slave = ::open(::ptsname(link.master), (O_RDWR | O_NOCTTY));
+        if ( link.slave < 0 ) { return false; }
+        link.mega = ((layout == "mega") || ((layout == "mixed") && (i & 1)));
+        links.push_back(link);
+    }
+    return true;
+}
+
+static size_t residentKb (void) {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return ((resident * ::sysconf(_SC_PAGESIZE)) / 1024);
+}
+
+static double cpuMs (const rusage & usage) {
+    return (((usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0) + ((usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0));
+}
+
+// A simulated board, with the analog reporting state a responder lacks
+struct Board {
+    std::unique_ptr<LoopbackStream> stream;
+    std::unique_ptr<FirmataResponder> responder;
+    int fd;
+    uint16_t enabled_channels;
+    int report_channel;  // The channel of a REPORT_ANALOG awaiting its argument, or -1
+    uint64_t ticks;
+
+    void receive (const uint8_t byte) {
+        if ( report_channel >= 0 ) {
+            enabled_channels = (byte ? (enabled_channels | (1 << report_channel)) : (enabled_channels & ~(1 << report_channel)));
+            report_channel = -1;
+        } else if ( firmata::REPORT_ANALOG == (byte & 0xF0) ) {
+            report_channel = (byte & 0x0F);
+        }
+        stream->write(byte);
+    }
+};
+
+static void forward (LoopbackStream & board, const int master) {
+    uint8_t buffer[512];
+    size_t size = 0;
+    for (int byte ; -1 != (byte = board.read()) ;) {
+        buffer[size++] = static_cast<uint8_t>(byte);
+        if ( sizeof(buffer) == size ) { if ( ::write(master, buffer, size) < 0 ) { return; } size = 0; }
+    }
+    if ( size && ::write(master, buffer, size) < 0 ) { return; }
+}
+
+// Plays a slice of the boards from a single thread of a child process
+static void simulateBoards (const std::vector<Link> & links, const size_t first, const size_t last, const size_t rate_hz, const int totals_fd) {
+    std::vector<Board> boards(last - first);
+    std::vector<pollfd> fds;
+    SimulatorTotals totals = SimulatorTotals();
+
+    std::signal(SIGTERM, requestStop);
+    for (size_t i = 0 ; i < links.size() ; ++i) {
+        ::close(links[i].slave);
+        if ( i < first || i >= last ) { ::close(links[i].master); }
+    }
+    for (size_t i = 0 ; i < boards.size() ; ++i) {
+        const Link & link = links[first + i];
+        Board & board = boards[i];
+        board.stream.reset(new LoopbackStream);
+        board.responder.reset(link.mega ? new FirmataResponder(*board.stream, ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT)
+                                        : new FirmataResponder(*board.stream, ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT));
+        board.fd = link.master;
+        board.enabled_channels = 0;
+        board.report_channel = -1;
+        board.ticks = 0;
+        board.responder->begin();
+        forward(*board.stream, board.fd);
+        fds.push_back(pollfd{ board.fd, POLLIN, 0 });
+    }
+
+    const Clock::time_point start = Clock::now();
+    while ( !stop_requested ) {
+        if ( ::poll(fds.data(), fds.size(), 1) > 0 ) {
+            for (size_t i = 0 ; i < fds.size() ; ++i) {
+                uint8_t request[256];
+                if ( !(fds[i].revents & POLLIN) ) { continue; }
+                const ssize_t size = ::read(fds[i].fd, request, sizeof(request));
+                for (ssize_t j = 0 ; j < size ; ++j) { boards[i].receive(request[j]); }
+                if ( size > 0 ) { totals.bytes_received += size; }
+                forward(*boards[i].stream, fds[i].fd);
+            }
+        }
+
+        // Report each enabled channel once per tick, skipping ticks missed
+        // while the host applied backpressure
+        const uint64_t tick = static_cast<uint64_t>(std::chrono::duration<double>(Clock::now() - start).count() * rate_hz);
+        for (Board & board : boards) {
+            uint8_t report[(AnalogSampler::CHANNEL_COUNT * 3)];
+            size_t size = 0;
+            if ( board.ticks == tick ) { continue; }
+            board.ticks = tick;
+            for (size_t channel = 0 ; channel < AnalogSampler::CHANNEL_COUNT ; ++channel) {
+                if ( !(board.enabled_channels & (1 << channel)) ) { continue; }
+                report[size++] = static_cast<uint8_t>(firmata::ANALOG_MESSAGE | channel);
+                report[size++] = static_cast<uint8_t>(tick & 0x7F);
+                report[size++] = static_cast<uint8_t>((tick >> 7) & 0x07);
+                ++totals.reports_sent;
+            }
+            if ( size && ::write(board.fd, report, size) < 0 ) { stop_requested = 1; break; }
+        }
+    }
+
+    if ( ::write(totals_fd, &totals, sizeof(totals)) < 0 ) { return; }
+}
+
+static void percentiles (std::vector<double> & samples, double * p50, double * p99, double * max) {
+    std::sort(samples.begin(), samples.end());
+    *p50 = (samples.empty() ? 0.0 : samples[samples.size() / 2]);
+    *p99 = (samples.empty() ? 0.0 : samples[std::min((samples.size() - 1), static_cast<size_t>(0.99 * samples.size()))]);
+    *max = (samples.empty() ? 0.0 : samples.back());
+}
+
+int main (int argc, char * argv[]) {
+    const size_t board_count = ((argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 256);
+    const size_t seconds = ((argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 10);
+    const std::string layout((argc > 3) ? argv[3] : "mixed");
+    const size_t rate_hz = ((argc > 4) ? std::strtoul(argv[4], nullptr, 10) : 50);
+    const size_t worker_count = ((argc > 5) ? std::strtoul(argv[5], nullptr, 10) : 1);
+    const size_t simulator_count = std::max(static_cast<size_t>(1), std::min(board_count, ((argc > 6) ? std::strtoul(argv[6], nullptr, 10) : 1)));
+
+    std::cout << ">>Firmata Fleet Soak<<" << std::endl;
+    std::cout << "boards=" << board_count << " seconds=" << seconds << " layout=" << layout << " rate_hz=" << rate_hz
+              << " workers=" << worker_count << " simulators=" << simulator_count << std::endl;
+
+    // Each board holds a descriptor on both sides until the fork
+    rlimit limit;
+    if ( 0 == ::getrlimit(RLIMIT_NOFILE, &limit) ) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    const size_t baseline_kb = residentKb();
+    std::vector<Link> links;
+    if ( !openLinks(board_count, layout, links) ) {
+        std::cerr << "Unable to open " << board_count << " pseudo-terminals" << std::endl;
+        return 1;
+    }
+
+    int totals_pipe[2];
+    if ( 0 != ::pipe(totals_pipe) ) { return 1; }
+    std::vector<pid_t> simulators;
+    for (size_t s = 0 ; s < simulator_count ; ++s) {
+        const pid_t child = ::fork();
+        if ( 0 == child ) {
+            ::close(totals_pipe[0]);
+            simulateBoards(links, ((s * board_count) / simulator_count), (((s + 1) * board_count) / simulator_count), rate_hz, totals_pipe[1]);
+            ::_exit(0);
+        }
+        simulators.push_back(child);
+    }
+    ::close(totals_pipe[1]);
+
+    std::vector<std::unique_ptr<FdStream>> streams;
+    std::vector<std::unique_ptr<FirmataQuery>> queries;
+    for (const Link & link : links) {
+        ::close(link.master);
+        streams.emplace_back(new FdStream(link.slave));
+        streams.back()->begin(57600, 0x06);
+        queries.emplace_back(new FirmataQuery);
+    }
+
+    // Startup: acquire every contract
+    rusage before, after;
+    SerialReactor reactor;
+    const Clock::time_point start = Clock::now();
+    for (size_t i = 0 ; i < board_count ; ++i) {
+        queries[i]->queryContractAsync(streams[i].get(), nullptr, nullptr);
+    }
+    for (auto & stream : streams) { reactor.attach(*stream); }
+    reactor.start(worker_count);
+
+    std::vector<std::unique_ptr<DeviceContract>> contracts(board_count);
+    std::vector<double> acquire_ms;
+    for (size_t i = 0 ; i < board_count ; ++i) {
+        if ( std::future_status::ready != queries[i]->contractReadyFuture().wait_until(start + std::chrono::seconds(60)) ) { continue; }
+        contracts[i].reset(queries[i]->detachDeviceContract());
+        acquire_ms.push_back(queries[i]->getMetrics()->snapshot().phases[QueryMetricsSnapshot::CONTRACT_ACQUISITION].sum_us / 1000.0);
+    }
+    const double startup_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    const size_t acquired_kb = residentKb();
+
+    // Sustained traffic: analog reports in, digital writes out
+    std::vector<std::unique_ptr<AnalogSampler>> samplers(board_count);
+    std::vector<std::unique_ptr<DigitalWriteEngine>> engines(board_count);
+    std::vector<size_t> output_pins(board_count, PinSet::CAPACITY);
+    for (size_t i = 0 ; i < board_count ; ++i) {
+        if ( !contracts[i] ) { continue; }
+        samplers[i].reset(new AnalogSampler(*contracts[i]));
+        queries[i]->setAnalogSampler(samplers[i].get());
+        samplers[i]->begin(*streams[i]);
+        engines[i].reset(new DigitalWriteEngine(*contracts[i]));
+        engines[i]->begin(*streams[i]);
+        output_pins[i] = contracts[i]->pinsWithCapability(DIGITAL_WRITE).next(2);
+    }
+
+    uint64_t samples_read = 0;
+    uint64_t bytes_before = 0;
+    for (auto & query : queries) { bytes_before += query->getMetrics()->snapshot().bytes_received; }
+    ::getrusage(RUSAGE_SELF, &before);
+    const Clock::time_point soak_start = Clock::now();
+    for (size_t round = 0 ; (Clock::now() - soak_start) < std::chrono::seconds(seconds) ; ++round) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        for (size_t i = 0 ; i < board_count ; ++i) {
+            if ( !samplers[i] ) { continue; }
+            const PinSet pins = samplers[i]->pins();
+            for (size_t pin = pins.next(0) ; pin < PinSet::CAPACITY ; pin = pins.next(pin + 1)) {
+                const AnalogSample * batch;
+                for (size_t count ; (count = samplers[i]->peek(pin, &batch)) ; ) {
+                    samples_read += count;
+                    samplers[i]->release(pin, count);
+                }
+            }
+            if ( (0 == (round % 10)) && (output_pins[i] < PinSet::CAPACITY) ) {
+                engines[i]->digitalWrite(output_pins[i], ((round / 10) & 1));
+                engines[i]->flush();
+            }
+        }
+    }
+    const double soak_s = std::chrono::duration<double>(Clock::now() - soak_start).count();
+    ::getrusage(RUSAGE_SELF, &after);
+    const size_t soaked_kb = residentKb();
+
+    for (size_t i = 0 ; i < board_count ; ++i) {
+        if ( samplers[i] ) { queries[i]->setAnalogSampler(nullptr); }
+    }
+    reactor.stop();
+
+    SimulatorTotals totals = SimulatorTotals();
+    for (pid_t child : simulators) { ::kill(child, SIGTERM); }
+    for (size_t s = 0 ; s < simulator_count ; ++s) {
+        SimulatorTotals slice;
+        if ( sizeof(slice) != ::read(totals_pipe[0], &slice, sizeof(slice)) ) { break; }
+        totals.bytes_received += slice.bytes_received;
+        totals.reports_sent += slice.reports_sent;
+    }
+    for (pid_t child : simulators) { ::waitpid(child, nullptr, 0); }
+
+    uint64_t bytes_received = 0, parse_errors = 0, samples_dropped = 0, messages_sent = 0;
+    for (size_t i = 0 ; i < board_count ; ++i) {
+        const QueryMetricsSnapshot snapshot = queries[i]->getMetrics()->snapshot();
+        bytes_received += snapshot.bytes_received;
+        parse_errors += snapshot.parse_errors;
+        if ( samplers[i] ) { samples_dropped += samplers[i]->samplesDropped(); }
+        if ( engines[i] ) { messages_sent += engines[i]->messagesSent(); }
+    }
+    for (const Link & link : links) { ::close(link.slave); }
+
+    double p50, p99, max;
+    percentiles(acquire_ms, &p50, &p99, &max);
+    std::cout << std::fixed << std::setprecision(2)
+              << "startup:    contracts=" << acquire_ms.size() << "/" << board_count << " total_ms=" << startup_ms
+              << " acquire_ms p50=" << p50 << " p99=" << p99 << " max=" << max << std::endl
+              << "throughput: samples/s=" << (samples_read / soak_s) << " reports/s=" << (totals.reports_sent / soak_s)
+              << " rx_bytes/s=" << ((bytes_received - bytes_before) / soak_s) << " tx_messages/s=" << (messages_sent / soak_s)
+              << " samples_dropped=" << samples_dropped << " parse_errors=" << parse_errors
+              << " device_rx_bytes=" << totals.bytes_received << std::endl
+              << "cpu:        host_ms/s=" << ((cpuMs(after) - cpuMs(before)) / soak_s)
+              << " per_board_us/s=" << (((cpuMs(after) - cpuMs(before)) * 1000.0) / soak_s / board_count)
+              << " reactor_wakeups=" << reactor.wakeups() << std::endl
+              << "memory:     rss_kb=" << soaked_kb << " per_board_kb acquired=" << (static_cast<double>(acquired_kb - baseline_kb) / board_count)
+              << " soaked=" << (static_cast<double>(soaked_kb - baseline_kb) / board_count) << std::endl;
+
+    return 0;
+}
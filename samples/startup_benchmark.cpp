@@ -0,0 +1,45 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <FirmataSessionManager.h>
+#include <UartSerial.h>
+
+// Usage: startup_benchmark /dev/ttyACM0 [/dev/ttyACM1 ...]
+//
+// Acquires the contracts of the first 1, 2, ... N boards concurrently and
+// reports the wall time of each round. With per-instance query state, the
+// total time should stay flat as boards are added.
+int main (int argc, char * argv[]) {
+    if ( argc < 2 ) {
+        std::cout << "Usage: " << argv[0] << " <device> [<device> ...]" << std::endl;
+        return 1;
+    }
+
+    std::cout << ">>Firmata N-Device Startup Benchmark<<" << std::endl;
+    std::cout << "devices,failures,wall_ms" << std::endl;
+
+    for (int device_count = 1 ; device_count < argc ; ++device_count) {
+        std::vector<std::unique_ptr<remote_wiring::UartSerial>> links;
+        remote_wiring::protocol::FirmataSessionManager sessions;
+
+        for (int i = 1 ; i <= device_count ; ++i) {
+            links.emplace_back(new remote_wiring::UartSerial(argv[i]));
+            links.back()->begin();
+            sessions.addStream(links.back().get());
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const size_t failures = sessions.queryContracts(std::chrono::milliseconds(15000));
+        const auto wall_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+        std::cout << device_count << "," << failures << "," << wall_time.count() << std::endl;
+
+        for (size_t i = 0 ; i < sessions.sessionCount() ; ++i) {
+            delete sessions.detachDeviceContract(i);
+        }
+        for (auto & link : links) { link->end(); }
+    }
+
+    return 0;
+}
@@ -20,7 +20,7 @@ int main (int argc, char * argv[]) {
     usb.begin();
     if ( 0 != query.queryContractAsync(&usb, onContractReady, &p) ) {
         std::cout << "Failed to query contract!" << std::endl;
-    } else if ( std::future_status::ready != f.wait_for(std::chrono::seconds(1)) ) {
+    } else if ( std::future_status::ready != f.wait_for(std::chrono::seconds(10)) ) {
         std::cout << "Query timed out!" << std::endl;
     } else {
         std::cout << std::endl << "Query succeed." << std::endl;
@@ -0,0 +1,194 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "AnalogSampler.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "FirmataConstants.h"
+
+using namespace remote_wiring::protocol;
+
+AnalogSampler::AnalogSampler (
+    const DeviceContract & contract_,
+    const size_t samples_per_pin_
+) :
+    _frame_size(0),
+    _mask(0),
+    _ring_count(0),
+    _rings(nullptr),
+    _sample_buffer(nullptr)
+{
+    size_t capacity = 1;
+
+    ::memset(_channel_ring, NO_RING, sizeof(_channel_ring));
+    ::memset(_pin_ring, NO_RING, sizeof(_pin_ring));
+
+    // Sample every analog input whose channel is known
+    const PinSet analog_pins = contract_.pinsWithCapability(ANALOG_READ);
+    for (size_t pin = analog_pins.next(0) ; pin < PinSet::CAPACITY ; pin = analog_pins.next(pin + 1)) {
+        const size_t channel = contract_.analogChannelForPin(pin);
+        if ( (channel >= CHANNEL_COUNT) || (NO_RING != _channel_ring[channel]) ) { continue; }
+        _channel_ring[channel] = static_cast<uint8_t>(_ring_count);
+        _pin_ring[pin] = static_cast<uint8_t>(_ring_count);
+        _pins.insert(pin);
+        ++_ring_count;
+    }
+
+    // One block of samples, partitioned between the rings
+    while ( capacity < samples_per_pin_ ) { capacity <<= 1; }
+    _mask = (capacity - 1);
+    _rings = new Ring[_ring_count];
+    _sample_buffer = new AnalogSample[(_ring_count * capacity)];
+    for (size_t i = 0 ; i < _ring_count ; ++i) {
+        _rings[i].head = 0;
+        _rings[i].tail = 0;
+        _rings[i].dropped = 0;
+        _rings[i].samples = (_sample_buffer + (i * capacity));
+    }
+}
+
+AnalogSampler::~AnalogSampler (
+    void
+) {
+    delete[] _sample_buffer;
+    delete[] _rings;
+}
+
+size_t
+AnalogSampler::backlog (
+    void
+) const {
+    size_t backlog = 0;
+
+    for (size_t i = 0 ; i < _ring_count ; ++i) {
+        const size_t head = _rings[i].head.load(std::memory_order_acquire);
+        backlog = std::max(backlog, (_rings[i].tail.load(std::memory_order_acquire) - head));
+    }
+
+    return backlog;
+}
+
+void
+AnalogSampler::begin (
+    Stream & stream_
+) {
+    _marshaller.begin(stream_);
+    for (size_t channel = 0 ; channel < CHANNEL_COUNT ; ++channel) {
+        if ( NO_RING != _channel_ring[channel] ) { _marshaller.reportAnalogEnable(static_cast<uint8_t>(channel)); }
+    }
+}
+
+void
+AnalogSampler::end (
+    void
+) {
+    for (size_t channel = 0 ; channel < CHANNEL_COUNT ; ++channel) {
+        if ( NO_RING != _channel_ring[channel] ) { _marshaller.reportAnalogDisable(static_cast<uint8_t>(channel)); }
+    }
+    _marshaller.end();
+}
+
+void
+AnalogSampler::ingest (
+    const uint8_t * data_,
+    const size_t size_,
+    const std::chrono::steady_clock::time_point received_at_
+) {
+    for (size_t i = 0 ; i < size_ ; ++i) {
+        const uint8_t byte = data_[i];
+
+        if ( byte & 0x80 ) {
+            // Track only analog messages; any other status ends the frame
+            _frame_size = (((byte & 0xF0) == firmata::ANALOG_MESSAGE) ? 1 : 0);
+            _frame[0] = byte;
+        } else if ( _frame_size ) {
+            _frame[_frame_size++] = byte;
+            if ( 3 == _frame_size ) {
+                push((_frame[0] & 0x0F), static_cast<uint16_t>(_frame[1] | (_frame[2] << 7)), received_at_);
+                _frame_size = 0;
+            }
+        }
+    }
+}
+
+size_t
+AnalogSampler::peek (
+    const size_t pin_,
+    const AnalogSample ** samples_
+) const {
+    if ( (pin_ >= PinSet::CAPACITY) || (NO_RING == _pin_ring[pin_]) ) { return 0; }
+    const Ring & ring = _rings[_pin_ring[pin_]];
+    const size_t head = ring.head.load(std::memory_order_relaxed);
+    const size_t tail = ring.tail.load(std::memory_order_acquire);
+    const size_t offset = (head & _mask);
+
+    *samples_ = (ring.samples + offset);
+    return std::min((tail - head), ((_mask + 1) - offset));
+}
+
+PinSet
+AnalogSampler::pins (
+    void
+) const {
+    return _pins;
+}
+
+void
+AnalogSampler::push (
+    const uint8_t channel_,
+    const uint16_t value_,
+    const std::chrono::steady_clock::time_point received_at_
+) {
+    if ( NO_RING == _channel_ring[channel_] ) { return; }
+    Ring & ring = _rings[_channel_ring[channel_]];
+    const size_t tail = ring.tail.load(std::memory_order_relaxed);
+
+    if ( (tail - ring.head.load(std::memory_order_acquire)) > _mask ) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring.samples[tail & _mask].received_at = received_at_;
+    ring.samples[tail & _mask].value = value_;
+    ring.tail.store((tail + 1), std::memory_order_release);
+}
+
+void
+AnalogSampler::release (
+    const size_t pin_,
+    const size_t count_
+) {
+    if ( (pin_ >= PinSet::CAPACITY) || (NO_RING == _pin_ring[pin_]) ) { return; }
+    Ring & ring = _rings[_pin_ring[pin_]];
+
+    ring.head.store((ring.head.load(std::memory_order_relaxed) + count_), std::memory_order_release);
+}
+
+size_t
+AnalogSampler::samplesDropped (
+    const size_t pin_
+) const {
+    if ( (pin_ >= PinSet::CAPACITY) || (NO_RING == _pin_ring[pin_]) ) { return 0; }
+
+    return _rings[_pin_ring[pin_]].dropped.load(std::memory_order_relaxed);
+}
+
+size_t
+AnalogSampler::samplesDropped (
+    void
+) const {
+    size_t dropped = 0;
+
+    for (size_t i = 0 ; i < _ring_count ; ++i) { dropped += _rings[i].dropped.load(std::memory_order_relaxed); }
+
+    return dropped;
+}
+
+size_t
+AnalogSampler::samplesPerPin (
+    void
+) const {
+    return (_mask + 1);
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
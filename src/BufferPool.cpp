@@ -0,0 +1,121 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "BufferPool.h"
+
+#include <cstdlib>
+
+using namespace remote_wiring::protocol;
+
+struct HeapAllocator : public BufferAllocator {
+    void *
+    allocate (
+        const size_t size_
+    ) override {
+        return ::malloc(size_);
+    }
+
+    void
+    deallocate (
+        void * buffer_,
+        const size_t size_
+    ) override {
+        (void)size_;
+        ::free(buffer_);
+    }
+};
+
+BufferAllocator &
+BufferAllocator::heap (
+    void
+) {
+    static HeapAllocator heap_allocator;
+    return heap_allocator;
+}
+
+BufferPool::BufferPool (
+    void
+) :
+    _allocations(0),
+    _heap_allocations(0)
+{
+    for (size_t i = 0 ; i < SIZE_CLASS_COUNT ; ++i) { _free_lists[i] = nullptr; }
+}
+
+BufferPool::~BufferPool (
+    void
+) {
+    for (size_t i = 0 ; i < SIZE_CLASS_COUNT ; ++i) {
+        for (FreeBlock * block = _free_lists[i], * next ; block ; block = next) {
+            next = block->next;
+            ::free(block);
+        }
+    }
+}
+
+void *
+BufferPool::allocate (
+    const size_t size_
+) {
+    const size_t size_class = sizeClassOf(size_);
+    void * buffer = nullptr;
+
+    ++_allocations;
+    if ( size_class < SIZE_CLASS_COUNT ) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if ( _free_lists[size_class] ) {
+            buffer = _free_lists[size_class];
+            _free_lists[size_class] = _free_lists[size_class]->next;
+        }
+    }
+
+    // Populate the size class from the heap
+    if ( !buffer ) {
+        ++_heap_allocations;
+        buffer = ::malloc((size_class < SIZE_CLASS_COUNT) ? (MIN_BLOCK_SIZE << size_class) : size_);
+    }
+
+    return buffer;
+}
+
+size_t
+BufferPool::allocations (
+    void
+) const {
+    return _allocations;
+}
+
+void
+BufferPool::deallocate (
+    void * buffer_,
+    const size_t size_
+) {
+    const size_t size_class = sizeClassOf(size_);
+
+    if ( !buffer_ ) { return; }
+    if ( size_class >= SIZE_CLASS_COUNT ) {
+        ::free(buffer_);
+    } else {
+        std::lock_guard<std::mutex> lock(_mutex);
+        FreeBlock * block = reinterpret_cast<FreeBlock *>(buffer_);
+        block->next = _free_lists[size_class];
+        _free_lists[size_class] = block;
+    }
+}
+
+size_t
+BufferPool::heapAllocations (
+    void
+) const {
+    return _heap_allocations;
+}
+
+size_t
+BufferPool::sizeClassOf (
+    const size_t size_
+) {
+    size_t size_class = 0;
+    for (size_t block_size = MIN_BLOCK_SIZE ; (block_size < size_) && (size_class < SIZE_CLASS_COUNT) ; block_size <<= 1) { ++size_class; }
+    return size_class;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
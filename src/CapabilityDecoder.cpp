@@ -0,0 +1,81 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "CapabilityDecoder.h"
+
+#include "FirmataConstants.h"
+
+using namespace remote_wiring::protocol;
+
+CapabilityDecoder::CapabilityDecoder (
+    pinDecoded pinDecodedCallback_,
+    void * pin_decoded_callback_context_
+) :
+    _mode(0),
+    _mode_byte(true),
+    _pin_decoded_callback(pinDecodedCallback_),
+    _pin_decoded_callback_context(pin_decoded_callback_context_),
+    _pin_count(0)
+{
+    _codec.data = 0;
+}
+
+void
+CapabilityDecoder::begin (
+    void
+) {
+    _codec.data = 0;
+    _mode_byte = true;
+    _pin_count = 0;
+}
+
+void
+CapabilityDecoder::decode (
+    const uint8_t byte_
+) {
+    if ( !_mode_byte ) {
+        // Resolution byte of the preceding mode
+        switch (_mode) {
+          case firmata::PIN_MODE_ANALOG:
+            _codec.config.analog_read_resolution_bits = byte_;
+            break;
+          case firmata::PIN_MODE_PWM:
+            _codec.config.analog_write_resolution_bits = byte_;
+            break;
+        }
+        _mode_byte = true;
+    } else if ( firmata::PIN_MODE_IGNORE == byte_ ) {
+        // End of the current pin
+        if ( _pin_decoded_callback ) { _pin_decoded_callback(_pin_decoded_callback_context, _pin_count, _codec.data); }
+        ++_pin_count;
+        _codec.data = 0;
+    } else {
+        _mode = byte_;
+        switch (_mode) {
+          case firmata::PIN_MODE_ANALOG:
+            _codec.config.supported_modes |= ANALOG_READ;
+            break;
+          case firmata::PIN_MODE_INPUT:
+            _codec.config.supported_modes |= DIGITAL_READ;
+            break;
+          case firmata::PIN_MODE_OUTPUT:
+            _codec.config.supported_modes |= DIGITAL_WRITE;
+            break;
+          case firmata::PIN_MODE_PULLUP:
+            _codec.config.supported_modes |= DIGITAL_READ_WITH_PULLUP;
+            break;
+          case firmata::PIN_MODE_PWM:
+            _codec.config.supported_modes |= ANALOG_WRITE;
+            break;
+        }
+        _mode_byte = false;
+    }
+}
+
+size_t
+CapabilityDecoder::pinCount (
+    void
+) const {
+    return _pin_count;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,176 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "CaptureRecorder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Trace.h"
+
+using namespace remote_wiring::protocol;
+
+// Leave room for at least one record header and an aligned payload
+static const size_t MIN_BUFFER_SIZE = 64;
+
+CaptureRecorder::CaptureRecorder (
+    const size_t buffer_size_
+) :
+    _buffer(nullptr),
+    _buffer_capacity(std::max(MIN_BUFFER_SIZE, (buffer_size_ & ~static_cast<size_t>(7)))),
+    _buffer_size(0),
+    _bytes_recorded(0),
+    _fd(-1),
+    _file_size(0),
+    _records_buffered(0),
+    _records_dropped(0)
+{
+}
+
+CaptureRecorder::~CaptureRecorder (
+    void
+) {
+    (void)close();
+}
+
+uint64_t
+CaptureRecorder::bytesRecorded (
+    void
+) const {
+    return _bytes_recorded.load(std::memory_order_relaxed);
+}
+
+int
+CaptureRecorder::close (
+    void
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    int error = 0;
+
+    if ( _fd < 0 ) { return 0; }
+    error = writeBuffer();
+    if ( 0 != ::close(_fd) && !error ) { error = __LINE__; }
+    _fd = -1;
+    delete[] _buffer;
+    _buffer = nullptr;
+
+    return error;
+}
+
+int
+CaptureRecorder::flush (
+    void
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if ( _fd < 0 ) { return __LINE__; }
+    return writeBuffer();
+}
+
+int
+CaptureRecorder::open (
+    const char * path_
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    CaptureFileHeader header;
+
+    if ( _fd >= 0 ) { return __LINE__; }
+    if ( 0 > (_fd = ::open(path_, (O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC), 0644)) ) {
+        PROTOCOL_TRACE_ERROR("CaptureRecorder::open - Unable to create %s (errno %d)", path_, errno);
+        return __LINE__;
+    }
+
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_VERSION;
+    header.header_size = sizeof(header);
+    header.wall_clock_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if ( static_cast<ssize_t>(sizeof(header)) != ::write(_fd, &header, sizeof(header)) ) {
+        PROTOCOL_TRACE_ERROR("CaptureRecorder::open - Unable to write the header of %s (errno %d)", path_, errno);
+        ::close(_fd);
+        _fd = -1;
+        return __LINE__;
+    }
+
+    _buffer = new uint8_t[_buffer_capacity];
+    _buffer_size = 0;
+    _file_size = sizeof(header);
+    _records_buffered = 0;
+    _started_at = std::chrono::steady_clock::now();
+
+    return 0;
+}
+
+int
+CaptureRecorder::record (
+    const uint16_t stream_id_,
+    const CaptureDirection direction_,
+    const uint8_t * data_,
+    const size_t size_,
+    const time_point observed_at_
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    CaptureRecord record;
+    int error = 0;
+
+    if ( _fd < 0 ) { return __LINE__; }
+    record.timestamp_ns = static_cast<uint64_t>(std::max(std::chrono::nanoseconds::zero(), std::chrono::duration_cast<std::chrono::nanoseconds>(observed_at_ - _started_at)).count());
+    record.stream_id = stream_id_;
+    record.direction = direction_;
+    record.reserved = 0;
+
+    for (size_t offset = 0 ; offset < size_ ; offset += record.size) {
+        // Make room for the header and at least one aligned word of payload
+        if ( (_buffer_capacity - _buffer_size) < captureRecordSpan(1) ) { error = writeBuffer(); }
+        record.size = static_cast<uint32_t>(std::min((size_ - offset), ((_buffer_capacity - _buffer_size - sizeof(CaptureRecord)) & ~static_cast<size_t>(7))));
+        std::memcpy((_buffer + _buffer_size), &record, sizeof(record));
+        std::memcpy((_buffer + _buffer_size + sizeof(record)), (data_ + offset), record.size);
+        std::memset((_buffer + _buffer_size + sizeof(record) + record.size), 0, (captureRecordSpan(record.size) - sizeof(record) - record.size));
+        _buffer_size += captureRecordSpan(record.size);
+        ++_records_buffered;
+    }
+    _bytes_recorded.fetch_add(size_, std::memory_order_relaxed);
+
+    return error;
+}
+
+uint64_t
+CaptureRecorder::recordsDropped (
+    void
+) const {
+    return _records_dropped.load(std::memory_order_relaxed);
+}
+
+int
+CaptureRecorder::writeBuffer (
+    void
+) {
+    int error = 0;
+
+    for (size_t offset = 0 ; offset < _buffer_size ;) {
+        const ssize_t bytes_written = ::write(_fd, (_buffer + offset), (_buffer_size - offset));
+        if ( bytes_written < 0 && EINTR == errno ) { continue; }
+        if ( bytes_written <= 0 ) {
+            PROTOCOL_TRACE_ERROR("CaptureRecorder::writeBuffer - %u records dropped (errno %d)", static_cast<unsigned int>(_records_buffered), errno);
+            _records_dropped.fetch_add(_records_buffered, std::memory_order_relaxed);
+
+            // Cut off any partial record, so later records stay aligned
+            if ( 0 != ::ftruncate(_fd, static_cast<off_t>(_file_size)) || 0 > ::lseek(_fd, static_cast<off_t>(_file_size), SEEK_SET) ) {
+                PROTOCOL_TRACE_ERROR("CaptureRecorder::writeBuffer - Unable to restore the end of the capture (errno %d)", errno);
+            }
+            error = __LINE__;
+            break;
+        }
+        offset += bytes_written;
+    }
+    if ( !error ) { _file_size += _buffer_size; }
+    _buffer_size = 0;
+    _records_buffered = 0;
+
+    return error;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,156 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "CaptureReplayer.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Trace.h"
+
+using namespace remote_wiring::protocol;
+
+constexpr double CaptureReplayer::AS_FAST_AS_POSSIBLE;
+constexpr double CaptureReplayer::WIRE_SPEED;
+
+CaptureReplayer::CaptureReplayer (
+    void
+) :
+    _data(nullptr),
+    _size(0)
+{
+}
+
+CaptureReplayer::~CaptureReplayer (
+    void
+) {
+    close();
+}
+
+void
+CaptureReplayer::close (
+    void
+) {
+    if ( !_data ) { return; }
+    ::munmap(const_cast<uint8_t *>(_data), _size);
+    _data = nullptr;
+    _size = 0;
+}
+
+const CaptureRecord *
+CaptureReplayer::first (
+    void
+) const {
+    if ( !_data ) { return nullptr; }
+    return recordAt(header()->header_size);
+}
+
+const CaptureFileHeader *
+CaptureReplayer::header (
+    void
+) const {
+    return reinterpret_cast<const CaptureFileHeader *>(_data);
+}
+
+const CaptureRecord *
+CaptureReplayer::next (
+    const CaptureRecord * record_
+) const {
+    return recordAt((reinterpret_cast<const uint8_t *>(record_) - _data) + captureRecordSpan(record_->size));
+}
+
+int
+CaptureReplayer::open (
+    const char * path_
+) {
+    struct stat status;
+    const CaptureFileHeader * capture_header;
+    void * data;
+    int fd;
+    int error;
+
+    if ( _data ) { return __LINE__; }
+    if ( 0 > (fd = ::open(path_, (O_RDONLY | O_CLOEXEC))) ) {
+        PROTOCOL_TRACE_ERROR("CaptureReplayer::open - Unable to open %s (errno %d)", path_, errno);
+        return __LINE__;
+    }
+
+    if ( 0 != ::fstat(fd, &status) ) {
+        error = __LINE__;
+    } else if ( static_cast<size_t>(status.st_size) < sizeof(CaptureFileHeader) ) {
+        PROTOCOL_TRACE_ERROR("CaptureReplayer::open - %s is too short to be a capture", path_);
+        error = __LINE__;
+    } else if ( MAP_FAILED == (data = ::mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) ) {
+        error = __LINE__;
+    } else {
+        _data = reinterpret_cast<const uint8_t *>(data);
+        _size = static_cast<size_t>(status.st_size);
+        capture_header = header();
+
+        // Newer versions may extend the header, but never move the records
+        if ( 0 != std::memcmp(capture_header->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) ) {
+            PROTOCOL_TRACE_ERROR("CaptureReplayer::open - %s is not a capture", path_);
+            error = __LINE__;
+        } else if ( (capture_header->version < 1) || (capture_header->header_size < sizeof(CaptureFileHeader)) || (capture_header->header_size % 8) || (capture_header->header_size > _size) ) {
+            PROTOCOL_TRACE_ERROR("CaptureReplayer::open - %s has an invalid header", path_);
+            error = __LINE__;
+        } else {
+            ::madvise(data, _size, MADV_SEQUENTIAL);
+            error = 0;
+        }
+        if ( error ) { close(); }
+    }
+    ::close(fd);
+
+    return error;
+}
+
+const uint8_t *
+CaptureReplayer::payload (
+    const CaptureRecord * record_
+) {
+    return (reinterpret_cast<const uint8_t *>(record_) + sizeof(CaptureRecord));
+}
+
+const CaptureRecord *
+CaptureReplayer::recordAt (
+    const size_t offset_
+) const {
+    const CaptureRecord * record;
+
+    // A record cut short ends the capture
+    if ( (offset_ + sizeof(CaptureRecord)) > _size ) { return nullptr; }
+    record = reinterpret_cast<const CaptureRecord *>(_data + offset_);
+    if ( (offset_ + sizeof(CaptureRecord) + record->size) > _size ) { return nullptr; }
+
+    return record;
+}
+
+int
+CaptureReplayer::replay (
+    const uint16_t stream_id_,
+    replayBytes upon_bytes_,
+    void * context_,
+    const double speed_
+) const {
+    const std::chrono::steady_clock::time_point started_at = std::chrono::steady_clock::now();
+
+    if ( !_data || !upon_bytes_ ) { return __LINE__; }
+    for (const CaptureRecord * record = first() ; record ; record = next(record)) {
+        if ( (record->stream_id != stream_id_) || (CAPTURE_RX != record->direction) ) { continue; }
+        if ( speed_ > AS_FAST_AS_POSSIBLE ) {
+            std::this_thread::sleep_until(started_at + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::nano>(record->timestamp_ns / speed_)));
+        }
+        upon_bytes_(context_, payload(record), record->size);
+    }
+
+    return 0;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
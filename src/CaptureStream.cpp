@@ -0,0 +1,147 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "CaptureStream.h"
+
+using namespace remote_wiring::protocol;
+
+CaptureStream::CaptureStream (
+    Stream & stream_,
+    CaptureRecorder & recorder_,
+    const uint16_t stream_id_
+) :
+    _recorder(recorder_),
+    _serial_event_callback(nullptr),
+    _serial_event_context(nullptr),
+    _stream(stream_),
+    _stream_id(stream_id_)
+{
+    _rx.size = 0;
+    _tx.size = 0;
+}
+
+CaptureStream::~CaptureStream (
+    void
+) {
+    if ( _serial_event_callback ) { _stream.registerSerialEventCallback(nullptr, nullptr); }
+    flush();
+}
+
+void
+CaptureStream::append (
+    Pending & pending_,
+    const CaptureDirection direction_,
+    const uint8_t byte_
+) {
+    if ( !pending_.size ) { pending_.observed_at = std::chrono::steady_clock::now(); }
+    pending_.data[pending_.size++] = byte_;
+    if ( PENDING_SIZE == pending_.size ) { emit(pending_, direction_); }
+}
+
+size_t
+CaptureStream::available (
+    void
+) {
+    const size_t bytes_available = _stream.available();
+
+    // Readers drain until nothing is available, which closes the record
+    if ( !bytes_available && _rx.size ) { emit(_rx, CAPTURE_RX); }
+
+    return bytes_available;
+}
+
+void
+CaptureStream::begin (
+    const size_t speed_,
+    const size_t config_
+) {
+    _stream.begin(speed_, config_);
+}
+
+void
+CaptureStream::emit (
+    Pending & pending_,
+    const CaptureDirection direction_
+) {
+    if ( !pending_.size ) { return; }
+    (void)_recorder.record(_stream_id, direction_, pending_.data, pending_.size, pending_.observed_at);
+    pending_.size = 0;
+}
+
+void
+CaptureStream::end (
+    void
+) {
+    flush();
+    _stream.end();
+}
+
+void
+CaptureStream::flush (
+    void
+) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        emit(_tx, CAPTURE_TX);
+    }
+    _stream.flush();
+}
+
+int
+CaptureStream::peek (
+    void
+) {
+    return _stream.peek();
+}
+
+int
+CaptureStream::read (
+    void
+) {
+    const int byte = _stream.read();
+
+    if ( byte >= 0 ) { append(_rx, CAPTURE_RX, static_cast<uint8_t>(byte)); }
+
+    return byte;
+}
+
+void
+CaptureStream::registerSerialEventCallback (
+    serialEvent upon_read_,
+    void * context_
+) {
+    _serial_event_callback = upon_read_;
+    _serial_event_context = context_;
+    _stream.registerSerialEventCallback((upon_read_ ? CaptureStream::serialEventCallback : nullptr), (upon_read_ ? this : nullptr));
+}
+
+void
+CaptureStream::serialEventCallback (
+    void * context_
+) {
+    CaptureStream * stream = reinterpret_cast<CaptureStream *>(context_);
+
+    // Whatever was sent before this event is recorded ahead of the reply
+    {
+        std::lock_guard<std::mutex> lock(stream->_mutex);
+        stream->emit(stream->_tx, CAPTURE_TX);
+    }
+    stream->_serial_event_callback(stream->_serial_event_context);
+    stream->emit(stream->_rx, CAPTURE_RX);
+}
+
+size_t
+CaptureStream::write (
+    uint8_t byte_
+) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Each status byte begins a new message, and closes the last one
+        if ( (byte_ & 0x80) && _tx.size ) { emit(_tx, CAPTURE_TX); }
+        append(_tx, CAPTURE_TX, byte_);
+    }
+
+    return _stream.write(byte_);
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,286 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "ContractCache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace remote_wiring::protocol;
+
+static const char CACHE_MAGIC[4] = { 'F', 'W', 'C', 'C' };
+static const uint16_t CACHE_FORMAT_VERSION = 1;
+
+ContractCache::ContractCache (
+    const char * file_path_
+) :
+    _file_path(file_path_),
+    _mapping(nullptr),
+    _mapping_size(0)
+{
+}
+
+ContractCache::~ContractCache (
+    void
+) {
+    unmapFile();
+}
+
+const ContractCache::EntryHeader *
+ContractCache::findEntry (
+    const char * firmware_name_,
+    const size_t major_,
+    const size_t minor_
+) const {
+    if ( !_mapping || !firmware_name_ ) { return nullptr; }
+
+    const FileHeader * header = reinterpret_cast<const FileHeader *>(_mapping);
+    const EntryHeader * entry = reinterpret_cast<const EntryHeader *>(_mapping + sizeof(FileHeader));
+    for (size_t i = 0 ; i < header->entry_count ; ++i, ++entry) {
+        if ( (entry->major == major_) && (entry->minor == minor_) && (0 == ::strncmp(entry->firmware_name, firmware_name_, FIRMWARE_NAME_SIZE)) ) {
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+uint32_t
+ContractCache::fingerprint (
+    const pin_config_t * pin_data_,
+    const size_t pin_count_
+) {
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0 ; i < pin_count_ ; ++i) {
+        const uint32_t data = static_cast<uint32_t>(pin_data_[i]);
+        for (size_t shift = 0 ; shift < 32 ; shift += 8) {
+            hash ^= ((data >> shift) & 0xFF);
+            hash *= 16777619u;
+        }
+    }
+
+    return hash;
+}
+
+int
+ContractCache::load (
+    void
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    unmapFile();
+    return mapFile();
+}
+
+size_t
+ContractCache::lookup (
+    const char * firmware_name_,
+    const size_t major_,
+    const size_t minor_,
+    pin_config_t * pin_data_,
+    const size_t pin_data_size_,
+    uint32_t * fingerprint_
+) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const EntryHeader * entry = findEntry(firmware_name_, major_, minor_);
+
+    if ( !entry ) { return 0; }
+    if ( fingerprint_ ) { *fingerprint_ = entry->fingerprint; }
+    if ( pin_data_ ) {
+        const uint32_t * cached_pin = reinterpret_cast<const uint32_t *>(_mapping + entry->pin_offset);
+        for (size_t i = 0 ; (i < entry->pin_count) && (i < pin_data_size_) ; ++i) {
+            pin_data_[i] = cached_pin[i];
+        }
+    }
+
+    return entry->pin_count;
+}
+
+int
+ContractCache::mapFile (
+    void
+) {
+    int error;
+    int fd;
+    struct stat file_stat;
+
+    if ( 0 > (fd = ::open(_file_path, O_RDONLY)) ) {
+        // A missing cache is an empty cache
+        error = ((ENOENT == errno) ? 0 : __LINE__);
+    } else if ( 0 != ::fstat(fd, &file_stat) ) {
+        error = __LINE__;
+    } else if ( static_cast<size_t>(file_stat.st_size) < sizeof(FileHeader) ) {
+        error = __LINE__;
+    } else {
+        void * mapping = ::mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if ( MAP_FAILED == mapping ) {
+            error = __LINE__;
+        } else {
+            const FileHeader * header = reinterpret_cast<const FileHeader *>(mapping);
+            const size_t directory_end = (sizeof(FileHeader) + (sizeof(EntryHeader) * header->entry_count));
+            const EntryHeader * entry = reinterpret_cast<const EntryHeader *>(reinterpret_cast<const uint8_t *>(mapping) + sizeof(FileHeader));
+
+            error = 0;
+            if ( (0 != ::memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC))) || (CACHE_FORMAT_VERSION != header->format_version) ) {
+                error = __LINE__;
+            } else if ( directory_end > static_cast<size_t>(file_stat.st_size) ) {
+                error = __LINE__;
+            } else {
+                // Reject entries whose pin tables fall outside the file
+                for (size_t i = 0 ; i < header->entry_count ; ++i, ++entry) {
+                    if ( (entry->pin_offset + (sizeof(uint32_t) * entry->pin_count)) > static_cast<size_t>(file_stat.st_size) ) {
+                        error = __LINE__;
+                        break;
+                    }
+                }
+            }
+
+            if ( error ) {
+                ::munmap(mapping, file_stat.st_size);
+            } else {
+                _mapping = reinterpret_cast<const uint8_t *>(mapping);
+                _mapping_size = file_stat.st_size;
+            }
+        }
+    }
+    if ( 0 <= fd ) { ::close(fd); }
+
+    return error;
+}
+
+int
+ContractCache::store (
+    const char * firmware_name_,
+    const size_t major_,
+    const size_t minor_,
+    const pin_config_t * pin_data_,
+    const size_t pin_count_
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const std::string lock_path = (std::string(_file_path) + ".lock");
+    int error;
+    int lock_fd;
+
+    if ( !firmware_name_ || !pin_data_ || (pin_count_ > UINT16_MAX) ) { return __LINE__; }
+    if ( (major_ > UINT8_MAX) || (minor_ > UINT8_MAX) ) { return __LINE__; }
+
+    // Serialize writers across processes, as the cache file is replaced on
+    // each store (and a lock held on the replaced file would protect nothing)
+    if ( 0 > (lock_fd = ::open(lock_path.c_str(), (O_RDWR | O_CREAT | O_CLOEXEC), (S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH))) ) { return __LINE__; }
+    while ( (0 != (error = ::flock(lock_fd, LOCK_EX))) && (EINTR == errno) );
+    if ( 0 != error ) {
+        error = __LINE__;
+    } else {
+        // Merge with the file as it stands, rather than as it was loaded; an
+        // unreadable file is replaced by one holding the new entry alone
+        unmapFile();
+        (void)mapFile();
+        error = rewriteFile(firmware_name_, major_, minor_, pin_data_, pin_count_);
+    }
+    ::close(lock_fd);  // Releases the lock
+
+    return error;
+}
+
+int
+ContractCache::rewriteFile (
+    const char * firmware_name_,
+    const size_t major_,
+    const size_t minor_,
+    const pin_config_t * pin_data_,
+    const size_t pin_count_
+) {
+    std::vector<EntryHeader> entries;
+    std::vector<std::vector<uint32_t>> tables;
+    const FileHeader * header = (_mapping ? reinterpret_cast<const FileHeader *>(_mapping) : nullptr);
+    int error;
+
+    // Carry over every other entry
+    const EntryHeader * entry = (header ? reinterpret_cast<const EntryHeader *>(_mapping + sizeof(FileHeader)) : nullptr);
+    for (size_t i = 0 ; header && (i < header->entry_count) ; ++i, ++entry) {
+        if ( (entry->major == major_) && (entry->minor == minor_) && (0 == ::strncmp(entry->firmware_name, firmware_name_, FIRMWARE_NAME_SIZE)) ) { continue; }
+        const uint32_t * table = reinterpret_cast<const uint32_t *>(_mapping + entry->pin_offset);
+        entries.push_back(*entry);
+        tables.push_back(std::vector<uint32_t>(table, (table + entry->pin_count)));
+    }
+    if ( entries.size() >= UINT16_MAX ) { return __LINE__; }
+
+    // Append the new entry
+    EntryHeader new_entry;
+    ::memset(&new_entry, 0, sizeof(new_entry));
+    ::strncpy(new_entry.firmware_name, firmware_name_, (FIRMWARE_NAME_SIZE - 1));
+    new_entry.major = static_cast<uint8_t>(major_);
+    new_entry.minor = static_cast<uint8_t>(minor_);
+    new_entry.pin_count = static_cast<uint16_t>(pin_count_);
+    new_entry.fingerprint = fingerprint(pin_data_, pin_count_);
+    entries.push_back(new_entry);
+    tables.push_back(std::vector<uint32_t>(pin_data_, (pin_data_ + pin_count_)));
+
+    // Lay out the pin tables after the directory
+    size_t offset = (sizeof(FileHeader) + (sizeof(EntryHeader) * entries.size()));
+    for (size_t i = 0 ; i < entries.size() ; ++i) {
+        entries[i].pin_offset = static_cast<uint32_t>(offset);
+        offset += (sizeof(uint32_t) * tables[i].size());
+    }
+
+    FileHeader new_header;
+    ::memcpy(new_header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    new_header.format_version = CACHE_FORMAT_VERSION;
+    new_header.entry_count = static_cast<uint16_t>(entries.size());
+
+    // Write beside the original, then atomically replace it
+    std::string temp_path = (std::string(_file_path) + ".XXXXXX");
+    const int fd = ::mkstemp(&temp_path[0]);
+    FILE * file = ((0 > fd) ? nullptr : ::fdopen(fd, "wb"));
+    if ( !file ) {
+        if ( 0 <= fd ) {
+            ::close(fd);
+            ::remove(temp_path.c_str());
+        }
+        error = __LINE__;
+    } else {
+        // Readable by all, as a file created by `fopen` would be
+        bool written = (0 == ::fchmod(fd, (S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)));
+        written = written && (1 == ::fwrite(&new_header, sizeof(new_header), 1, file));
+        written = written && (entries.size() == ::fwrite(entries.data(), sizeof(EntryHeader), entries.size(), file));
+        for (size_t i = 0 ; written && (i < tables.size()) ; ++i) {
+            written = (tables[i].size() == ::fwrite(tables[i].data(), sizeof(uint32_t), tables[i].size(), file));
+        }
+        written = (0 == ::fclose(file)) && written;
+
+        if ( !written ) {
+            ::remove(temp_path.c_str());
+            error = __LINE__;
+        } else if ( 0 != ::rename(temp_path.c_str(), _file_path) ) {
+            ::remove(temp_path.c_str());
+            error = __LINE__;
+        } else {
+            unmapFile();
+            error = mapFile();
+        }
+    }
+
+    return error;
+}
+
+void
+ContractCache::unmapFile (
+    void
+) {
+    if ( _mapping ) {
+        ::munmap(const_cast<uint8_t *>(_mapping), _mapping_size);
+        _mapping = nullptr;
+        _mapping_size = 0;
+    }
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
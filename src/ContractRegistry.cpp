@@ -0,0 +1,67 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "ContractRegistry.h"
+
+#include "ContractCache.h"
+
+using namespace remote_wiring::protocol;
+
+ContractRegistry::ContractRegistry (
+    void
+) {
+}
+
+ContractRegistry &
+ContractRegistry::global (
+    void
+) {
+    static ContractRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<const FirmataContract>
+ContractRegistry::intern (
+    const pin_config_t * pin_data_,
+    const size_t pin_count_,
+    BufferAllocator & allocator_
+) {
+    const uint32_t fingerprint = ContractCache::fingerprint(pin_data_, ((pin_count_ < PinSet::CAPACITY) ? pin_count_ : PinSet::CAPACITY));
+    FirmataContract * candidate;
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Look for a contract decoded from an identical table, by the same allocator, to share
+    auto range = _contracts.equal_range(fingerprint);
+    for (auto entry = range.first ; entry != range.second ;) {
+        std::shared_ptr<const FirmataContract> interned = entry->second.contract.lock();
+        if ( !interned ) {
+            entry = _contracts.erase(entry);
+        } else if ( (&allocator_ == entry->second.allocator) && interned->describes(pin_data_, pin_count_) ) {
+            return interned;
+        } else {
+            ++entry;
+        }
+    }
+
+    // Decode the table only when it is new
+    if ( nullptr == (candidate = new (allocator_) FirmataContract(pin_data_, pin_count_)) ) { return nullptr; }
+    std::shared_ptr<const FirmataContract> contract(candidate);
+    _contracts.emplace(fingerprint, Entry{ &allocator_, contract });
+
+    return contract;
+}
+
+size_t
+ContractRegistry::size (
+    void
+) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t live_contracts = 0;
+
+    for (const auto & entry : _contracts) {
+        if ( !entry.second.contract.expired() ) { ++live_contracts; }
+    }
+
+    return live_contracts;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,310 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "DeviceAwaitable.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "DeviceContract.h"
+#include "DeviceQuery.h"
+#include "PinStateMirror.h"
+#include "Trace.h"
+
+using namespace remote_wiring::protocol;
+
+/*!
+ * \brief Expires the deadlines of every awaitable, on a single thread
+ */
+class AwaitableCompletion::Timer {
+  public:
+    static
+    Timer &
+    instance (
+        void
+    ) {
+        static Timer timer;
+        return timer;
+    }
+
+    void
+    arm (
+        AwaitableCompletion & completion_,
+        const std::chrono::steady_clock::time_point deadline_,
+        exchangeExpired upon_expiry_,
+        void * context_
+    ) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        completion_._expiry_context = context_;
+        completion_._upon_expiry = upon_expiry_;
+        completion_._deadline = _deadlines.emplace(deadline_, &completion_);
+        completion_._armed = true;
+
+        // The timer sleeps until the earliest deadline
+        if ( completion_._deadline == _deadlines.begin() ) { _condition.notify_one(); }
+    }
+
+    void
+    disarm (
+        AwaitableCompletion & completion_
+    ) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if ( !completion_._armed ) { return; }
+        _deadlines.erase(completion_._deadline);
+        completion_._armed = false;
+    }
+
+  private:
+    std::condition_variable _condition;
+    deadline_map _deadlines;
+    std::mutex _mutex;
+    bool _running;
+    std::thread _thread;
+
+    Timer (
+        void
+    ) :
+        _running(true)
+    {
+        _thread = std::thread(&Timer::run, this);
+    }
+
+    ~Timer (
+        void
+    ) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running = false;
+        }
+        _condition.notify_one();
+        _thread.join();
+    }
+
+    void
+    run (
+        void
+    ) {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        while ( _running ) {
+            if ( _deadlines.empty() ) {
+                _condition.wait(lock);
+                continue;
+            }
+            if ( std::chrono::steady_clock::now() < _deadlines.begin()->first ) {
+                _condition.wait_until(lock, _deadlines.begin()->first);
+                continue;
+            }
+
+            AwaitableCompletion * completion = _deadlines.begin()->second;
+            _deadlines.erase(_deadlines.begin());
+            completion->_armed = false;
+
+            // The exchange completed first, and will resume the coroutine itself
+            if ( !completion->_upon_expiry(completion->_expiry_context) ) { continue; }
+
+            // Nothing else will resume the coroutine, so it outlives the unlock
+            lock.unlock();
+            completion->resume();
+            lock.lock();
+        }
+    }
+};
+
+// The time a timeout elapses, saturating rather than overflowing
+static std::chrono::steady_clock::time_point
+deadlineAfter (
+    const std::chrono::steady_clock::duration timeout_
+) {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    return ((timeout_ < (std::chrono::steady_clock::time_point::max() - now)) ? (now + timeout_) : std::chrono::steady_clock::time_point::max());
+}
+
+AwaitableCompletion::AwaitableCompletion (
+    void
+) :
+    _arrived(false),
+    _armed(false),
+    _expiry_context(nullptr),
+    _upon_expiry(nullptr)
+{
+}
+
+void
+AwaitableCompletion::armDeadline (
+    const std::chrono::steady_clock::time_point deadline_,
+    exchangeExpired upon_expiry_,
+    void * context_
+) {
+    Timer::instance().arm(*this, deadline_, upon_expiry_, context_);
+}
+
+void
+AwaitableCompletion::disarmDeadline (
+    void
+) {
+    Timer::instance().disarm(*this);
+}
+
+void
+AwaitableCompletion::resume (
+    void
+) {
+    // The coroutine has suspended, and is waiting on this callback
+    if ( _arrived.exchange(true, std::memory_order_acq_rel) ) { _coroutine.resume(); }
+}
+
+bool
+AwaitableCompletion::suspend (
+    std::coroutine_handle<> coroutine_
+) {
+    _coroutine = coroutine_;
+
+    // Suspend, unless the callback has already arrived
+    return !_arrived.exchange(true, std::memory_order_acq_rel);
+}
+
+ContractAwaitable::ContractAwaitable (
+    DeviceQuery & query_,
+    Stream * stream_,
+    const duration timeout_
+) :
+    _error(0),
+    _query(query_),
+    _stream(stream_),
+    _timeout(timeout_)
+{
+}
+
+bool
+ContractAwaitable::await_ready (
+    void
+) const noexcept {
+    return false;
+}
+
+std::unique_ptr<DeviceContract>
+ContractAwaitable::await_resume (
+    void
+) {
+    if ( _error ) { return nullptr; }
+
+    return std::unique_ptr<DeviceContract>(_query.detachDeviceContract());
+}
+
+bool
+ContractAwaitable::await_suspend (
+    std::coroutine_handle<> coroutine_
+) {
+    // The callback may arrive on another thread before the query returns
+    if ( 0 != (_error = _query.queryContractAsync(_stream, ContractAwaitable::contractReadyCallback, this)) ) { return false; }
+    _completion.armDeadline(deadlineAfter(_timeout), ContractAwaitable::contractExpired, this);
+    if ( _completion.suspend(coroutine_) ) { return true; }
+
+    // The contract is already here, so the deadline must not outlive the awaitable
+    _completion.disarmDeadline();
+    return false;
+}
+
+bool
+ContractAwaitable::contractExpired (
+    void * context_
+) {
+    ContractAwaitable * awaitable = reinterpret_cast<ContractAwaitable *>(context_);
+
+    if ( !awaitable->_query.cancelContractQuery() ) { return false; }
+    PROTOCOL_TRACE_WARN("ContractAwaitable - The device did not report its contract before the deadline");
+    awaitable->_error = __LINE__;
+
+    return true;
+}
+
+void
+ContractAwaitable::contractReadyCallback (
+    void * context_
+) {
+    ContractAwaitable * awaitable = reinterpret_cast<ContractAwaitable *>(context_);
+
+    awaitable->_completion.disarmDeadline();
+    awaitable->_completion.resume();
+}
+
+PinStateAwaitable::PinStateAwaitable (
+    PinStateMirror & mirror_,
+    const size_t pin_,
+    const duration timeout_
+) :
+    _error(0),
+    _mirror(mirror_),
+    _pin(pin_),
+    _timeout(timeout_)
+{
+}
+
+bool
+PinStateAwaitable::await_ready (
+    void
+) const noexcept {
+    return false;
+}
+
+PinStateReport
+PinStateAwaitable::await_resume (
+    void
+) {
+    PinStateReport report = { PinStateMirror::UNKNOWN_MODE, 0 };
+
+    if ( _error ) { return report; }
+    report.mode = _mirror.cachedPinMode(_pin);
+    (void)_mirror.cachedPinState(_pin, duration::max(), &report.state);
+
+    return report;
+}
+
+bool
+PinStateAwaitable::await_suspend (
+    std::coroutine_handle<> coroutine_
+) {
+    // The report may arrive on another thread before the query returns
+    if ( 0 != (_error = _mirror.queryPinState(_pin, PinStateAwaitable::pinStateReported, this)) ) { return false; }
+    _completion.armDeadline(deadlineAfter(_timeout), PinStateAwaitable::pinStateExpired, this);
+    if ( _completion.suspend(coroutine_) ) { return true; }
+
+    // The report is already here, so the deadline must not outlive the awaitable
+    _completion.disarmDeadline();
+    return false;
+}
+
+bool
+PinStateAwaitable::pinStateExpired (
+    void * context_
+) {
+    PinStateAwaitable * awaitable = reinterpret_cast<PinStateAwaitable *>(context_);
+
+    if ( !awaitable->_mirror.cancelPinStateQuery(awaitable->_pin, awaitable) ) { return false; }
+    PROTOCOL_TRACE_WARN("PinStateAwaitable - Pin %u did not report its state before the deadline", static_cast<unsigned int>(awaitable->_pin));
+    awaitable->_error = __LINE__;
+
+    return true;
+}
+
+void
+PinStateAwaitable::pinStateReported (
+    void * context_,
+    size_t pin_
+) {
+    PinStateAwaitable * awaitable = reinterpret_cast<PinStateAwaitable *>(context_);
+
+    (void)pin_;
+    awaitable->_completion.disarmDeadline();
+    awaitable->_completion.resume();
+}
+
+#endif // __cpp_impl_coroutine
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,98 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "DigitalWriteEngine.h"
+
+#include "Trace.h"
+
+using namespace remote_wiring::protocol;
+
+DigitalWriteEngine::DigitalWriteEngine (
+    const DeviceContract & contract_
+) :
+    _dirty_ports(0),
+    _messages_sent(0),
+    _writable(contract_.pinsWithCapability(DIGITAL_WRITE)),
+    _writes_dropped(0)
+{
+}
+
+void
+DigitalWriteEngine::begin (
+    Stream & stream_
+) {
+    _marshaller.begin(stream_);
+}
+
+int
+DigitalWriteEngine::digitalWrite (
+    const size_t pin_,
+    const bool value_
+) {
+    const size_t port = (pin_ / 8);
+
+    if ( (pin_ >= PinSet::CAPACITY) || !_writable.contains(pin_) ) {
+        PROTOCOL_TRACE_WARN("DigitalWriteEngine::digitalWrite - Pin %u does not support digital write", static_cast<unsigned int>(pin_));
+        return __LINE__;
+    }
+    if ( value_ == _desired.contains(pin_) ) {
+        ++_writes_dropped;
+        return 0;
+    }
+
+    if ( value_ ) {
+        _desired.insert(pin_);
+    } else {
+        _desired.erase(pin_);
+    }
+
+    // A port written back to its last sent value is clean again
+    if ( portValue(_desired, port) == portValue(_sent, port) ) {
+        _dirty_ports &= ~(1U << port);
+    } else {
+        _dirty_ports |= (1U << port);
+    }
+
+    return 0;
+}
+
+size_t
+DigitalWriteEngine::flush (
+    void
+) {
+    size_t messages = 0;
+
+    for (uint32_t dirty_ports = _dirty_ports ; dirty_ports ; dirty_ports &= (dirty_ports - 1)) {
+        const size_t port = __builtin_ctz(dirty_ports);
+        _marshaller.sendDigitalPort(static_cast<uint8_t>(port), portValue(_desired, port));
+        ++messages;
+    }
+    _dirty_ports = 0;
+    _sent = _desired;
+    _messages_sent += messages;
+
+    return messages;
+}
+
+size_t
+DigitalWriteEngine::messagesSent (
+    void
+) const {
+    return _messages_sent;
+}
+
+uint8_t
+DigitalWriteEngine::portValue (
+    const PinSet & pins_,
+    const size_t port_
+) {
+    return static_cast<uint8_t>(pins_.word(port_ / 8) >> ((port_ % 8) * 8));
+}
+
+size_t
+DigitalWriteEngine::writesDropped (
+    void
+) const {
+    return _writes_dropped;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
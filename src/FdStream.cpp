@@ -0,0 +1,230 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "FdStream.h"
+
+#include <cerrno>
+
+#include "Trace.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+using namespace remote_wiring::protocol;
+
+static const size_t READ_SIZE = 256;
+
+// Arduino frame formats (i.e. SERIAL_8N1 is 0x06)
+static const size_t CONFIG_DATA_BITS_MASK = 0x06;
+static const size_t CONFIG_TWO_STOP_BITS = 0x08;
+static const size_t CONFIG_PARITY_MASK = 0x30;
+static const size_t CONFIG_PARITY_EVEN = 0x20;
+static const size_t CONFIG_PARITY_ODD = 0x30;
+
+static speed_t
+baudRate (
+    const size_t speed_
+) {
+    switch (speed_) {
+      case 1200: return B1200;
+      case 2400: return B2400;
+      case 4800: return B4800;
+      case 9600: return B9600;
+      case 19200: return B19200;
+      case 38400: return B38400;
+      case 57600: return B57600;
+      case 115200: return B115200;
+      case 230400: return B230400;
+#if defined(B460800)
+      case 460800: return B460800;
+#endif
+#if defined(B921600)
+      case 921600: return B921600;
+#endif
+      default: return B0;
+    }
+}
+
+FdStream::FdStream (
+    const int fd_
+) :
+    _fd(fd_),
+    _rx_head(0),
+    _serial_event_callback(nullptr),
+    _serial_event_context(nullptr)
+{
+    _rx.reserve(READ_SIZE);
+}
+
+FdStream::~FdStream (
+    void
+) {
+}
+
+size_t
+FdStream::available (
+    void
+) {
+    return (_rx.size() - _rx_head);
+}
+
+void
+FdStream::begin (
+    const size_t speed_,
+    const size_t config_
+) {
+    struct termios tty;
+
+    if ( 0 == ::tcgetattr(_fd, &tty) ) {
+        ::cfmakeraw(&tty);
+
+        // Baud rate
+        const speed_t baud = baudRate(speed_);
+        if ( B0 != baud ) {
+            ::cfsetispeed(&tty, baud);
+            ::cfsetospeed(&tty, baud);
+        } else if ( speed_ ) {
+            PROTOCOL_TRACE_WARN("FdStream::begin - Unsupported speed %u; keeping the current rate", static_cast<unsigned int>(speed_));
+        }
+
+        // Frame format (data bits, parity and stop bits)
+        tty.c_cflag &= ~(CSIZE | PARENB | PARODD | CSTOPB);
+        switch ((config_ & CONFIG_DATA_BITS_MASK) >> 1) {
+          case 0: tty.c_cflag |= CS5; break;
+          case 1: tty.c_cflag |= CS6; break;
+          case 2: tty.c_cflag |= CS7; break;
+          default: tty.c_cflag |= CS8; break;
+        }
+        if ( CONFIG_PARITY_EVEN == (config_ & CONFIG_PARITY_MASK) ) {
+            tty.c_cflag |= PARENB;
+        } else if ( CONFIG_PARITY_ODD == (config_ & CONFIG_PARITY_MASK) ) {
+            tty.c_cflag |= (PARENB | PARODD);
+        }
+        if ( config_ & CONFIG_TWO_STOP_BITS ) { tty.c_cflag |= CSTOPB; }
+        tty.c_cflag |= (CLOCAL | CREAD);
+
+        if ( 0 != ::tcsetattr(_fd, TCSANOW, &tty) ) {
+            PROTOCOL_TRACE_ERROR("FdStream::begin - Unable to configure the terminal (errno %d)", errno);
+        }
+    }
+    ::fcntl(_fd, F_SETFL, (::fcntl(_fd, F_GETFL) | O_NONBLOCK));
+}
+
+void
+FdStream::end (
+    void
+) {
+    _rx.clear();
+    _rx_head = 0;
+}
+
+int
+FdStream::fd (
+    void
+) const {
+    return _fd;
+}
+
+void
+FdStream::flush (
+    void
+) {
+}
+
+int
+FdStream::peek (
+    void
+) {
+    return (available() ? _rx[_rx_head] : -1);
+}
+
+int
+FdStream::read (
+    void
+) {
+    return (available() ? _rx[_rx_head++] : -1);
+}
+
+void
+FdStream::registerSerialEventCallback (
+    serialEvent upon_read_,
+    void * context_
+) {
+    _serial_event_callback = upon_read_;
+    _serial_event_context = context_;
+}
+
+int
+FdStream::service (
+    void
+) {
+    int result = 0;
+    ssize_t bytes_read;
+
+    // Reclaim consumed bytes before reading more
+    if ( _rx_head == _rx.size() ) {
+        _rx.clear();
+        _rx_head = 0;
+    }
+
+    // Drain the descriptor
+    for (;;) {
+        const size_t size = _rx.size();
+        _rx.resize(size + READ_SIZE);
+        bytes_read = ::read(_fd, (_rx.data() + size), READ_SIZE);
+        _rx.resize(size + ((bytes_read > 0) ? bytes_read : 0));
+        if ( bytes_read > 0 ) {
+            result += static_cast<int>(bytes_read);
+        } else if ( bytes_read < 0 && EINTR == errno ) {
+            continue;
+        } else if ( bytes_read < 0 && (EAGAIN == errno || EWOULDBLOCK == errno) ) {
+            break;
+        } else {
+            // End of file, or the remote end of a pty hung up (EIO)
+            if ( !result ) { result = -1; }
+            break;
+        }
+    }
+
+    // Deliver the bytes to the parser
+    if ( _serial_event_callback && available() ) { _serial_event_callback(_serial_event_context); }
+
+    return result;
+}
+
+size_t
+FdStream::write (
+    uint8_t byte_
+) {
+    for (;;) {
+        const ssize_t bytes_written = ::write(_fd, &byte_, 1);
+
+        if ( 1 == bytes_written ) { return 1; }
+        if ( (bytes_written < 0) && (EINTR == errno) ) { continue; }
+        if ( (bytes_written < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno)) ) {
+            // Wait for room, rather than drop a byte from a message
+            pollfd descriptor = { _fd, POLLOUT, 0 };
+            if ( (::poll(&descriptor, 1, -1) >= 0) || (EINTR == errno) ) { continue; }
+        }
+        return 0;
+    }
+}
+
+ssize_t
+FdStream::write (
+    const uint8_t * data_,
+    const size_t size_
+) {
+    ssize_t bytes_written;
+
+    do {
+        bytes_written = ::write(_fd, data_, size_);
+    } while ( bytes_written < 0 && EINTR == errno );
+
+    // A full descriptor is not a failure
+    if ( (bytes_written < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno)) ) { return 0; }
+    return bytes_written;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,15 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "FirmataBoards.h"
+
+using namespace remote_wiring::protocol;
+
+// Out-of-line definitions, required when a table is odr-used at runtime
+constexpr size_t ArduinoUno::PIN_COUNT;
+constexpr PinConfig ArduinoUno::PIN_CONFIG[];
+constexpr size_t ArduinoMega::PIN_COUNT;
+constexpr PinConfig ArduinoMega::PIN_CONFIG[];
+constexpr size_t ArduinoDue::PIN_COUNT;
+constexpr PinConfig ArduinoDue::PIN_CONFIG[];
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
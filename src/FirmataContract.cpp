@@ -2,21 +2,72 @@
 
 #include "FirmataContract.h"
 
-using namespace remote_wiring::protocol;
+#include <cstring>
+
+#include "ContractCache.h"
 
-const pin_config_t remote_wiring::protocol::ANALOG_READ = 0x01;
-const pin_config_t remote_wiring::protocol::ANALOG_WRITE = 0x02;
-const pin_config_t remote_wiring::protocol::DIGITAL_READ = 0x04;
-const pin_config_t remote_wiring::protocol::DIGITAL_READ_WITH_PULLUP = 0x08;
-const pin_config_t remote_wiring::protocol::DIGITAL_WRITE = 0x10;
+using namespace remote_wiring::protocol;
 
 FirmataContract::FirmataContract (
     const pin_config_t * const pin_data_,
     const size_t pin_count_
 ) :
-    _pin_data(pin_data_),
-    _pin_count(pin_count_)
+    _fingerprint(ContractCache::fingerprint(pin_data_, ((pin_count_ < PinSet::CAPACITY) ? pin_count_ : PinSet::CAPACITY))),
+    _pin_count((pin_count_ < PinSet::CAPACITY) ? pin_count_ : PinSet::CAPACITY)
 {
+    ::memset(_analog_channel, NO_ANALOG_CHANNEL, sizeof(_analog_channel));
+    ::memset(_analog_read_resolution_bits, 0, sizeof(_analog_read_resolution_bits));
+    ::memset(_analog_write_resolution_bits, 0, sizeof(_analog_write_resolution_bits));
+
+    // Transpose the packed pin configurations into capability bitmaps
+    for (size_t pin = 0 ; pin < _pin_count ; ++pin) {
+        const PinConfig config = decodePinConfigFromData(pin_data_[pin]);
+        for (size_t capability = 0 ; capability < CAPABILITY_COUNT ; ++capability) {
+            if ( config.supported_modes & (1 << capability) ) { _capability_pins[capability].insert(pin); }
+        }
+        _analog_channel[pin] = static_cast<uint8_t>(config.reserved & 0x7F);
+        _analog_read_resolution_bits[pin] = static_cast<uint8_t>(config.analog_read_resolution_bits);
+        _analog_write_resolution_bits[pin] = static_cast<uint8_t>(config.analog_write_resolution_bits);
+    }
+}
+
+void *
+FirmataContract::operator new (
+    size_t size_,
+    BufferAllocator & allocator_
+) noexcept {
+    AllocationHeader * header = reinterpret_cast<AllocationHeader *>(allocator_.allocate(sizeof(AllocationHeader) + size_));
+
+    if ( !header ) { return nullptr; }
+    header->block.allocator = &allocator_;
+    header->block.size = (sizeof(AllocationHeader) + size_);
+
+    return (header + 1);
+}
+
+void
+FirmataContract::operator delete (
+    void * contract_
+) {
+    if ( !contract_ ) { return; }
+    AllocationHeader * header = (reinterpret_cast<AllocationHeader *>(contract_) - 1);
+    header->block.allocator->deallocate(header, header->block.size);
+}
+
+void
+FirmataContract::operator delete (
+    void * contract_,
+    BufferAllocator & allocator_
+) {
+    (void)allocator_;
+    operator delete(contract_);
+}
+
+size_t
+FirmataContract::analogChannelForPin (
+    const size_t pin_
+) const {
+    return ((pin_ < _pin_count) ? _analog_channel[pin_] : NO_ANALOG_CHANNEL);
 }
 
 bool
@@ -30,7 +81,7 @@ size_t
 FirmataContract::analogReadBitsOfResolutionForPin (
     const size_t pin_
 ) const {
-    return decodePinConfigFromData(_pin_data[pin_]).analog_read_resolution_bits;
+    return ((pin_ < _pin_count) ? _analog_read_resolution_bits[pin_] : 0);
 }
 
 bool
@@ -44,7 +95,30 @@ size_t
 FirmataContract::analogWriteBitsOfResolutionForPin (
     const size_t pin_
 ) const {
-    return decodePinConfigFromData(_pin_data[pin_]).analog_write_resolution_bits;
+    return ((pin_ < _pin_count) ? _analog_write_resolution_bits[pin_] : 0);
+}
+
+bool
+FirmataContract::describes (
+    const pin_config_t * pin_data_,
+    const size_t pin_count_
+) const {
+    if ( ((pin_count_ < PinSet::CAPACITY) ? pin_count_ : PinSet::CAPACITY) != _pin_count ) { return false; }
+
+    // Compare each pin as the constructor would have recorded it
+    for (size_t pin = 0 ; pin < _pin_count ; ++pin) {
+        const PinConfig config = decodePinConfigFromData(pin_data_[pin]);
+        for (size_t capability = 0 ; capability < CAPABILITY_COUNT ; ++capability) {
+            if ( static_cast<bool>(config.supported_modes & (1 << capability)) != _capability_pins[capability].contains(pin) ) { return false; }
+        }
+        if ( (static_cast<uint8_t>(config.reserved & 0x7F) != _analog_channel[pin])
+          || (static_cast<uint8_t>(config.analog_read_resolution_bits) != _analog_read_resolution_bits[pin])
+          || (static_cast<uint8_t>(config.analog_write_resolution_bits) != _analog_write_resolution_bits[pin]) ) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 bool
@@ -68,6 +142,13 @@ FirmataContract::digitalWriteAvailableOnPin (
     return capabilityAvailableOnPin(DIGITAL_WRITE, pin_);
 }
 
+uint32_t
+FirmataContract::fingerprint (
+    void
+) const {
+    return _fingerprint;
+}
+
 size_t
 FirmataContract::pinCount (
     void
@@ -75,4 +156,42 @@ FirmataContract::pinCount (
     return _pin_count;
 }
 
+PinSet
+FirmataContract::pinsWithCapability (
+    const pin_config_t capabilities_
+) const {
+    PinSet pins = PinSet::firstPins(_pin_count);
+
+    // Intersect the bitmap of each requested capability
+    for (pin_config_t remaining = capabilities_ ; remaining ; remaining &= (remaining - 1)) {
+        const size_t capability = __builtin_ctzll(remaining);
+        if ( capability >= CAPABILITY_COUNT ) { return PinSet(); }
+        pins &= _capability_pins[capability];
+    }
+
+    return pins;
+}
+
+bool
+FirmataContract::operator== (
+    const FirmataContract & other_
+) const {
+    if ( this == &other_ ) { return true; }
+    if ( (_fingerprint != other_._fingerprint) || (_pin_count != other_._pin_count) ) { return false; }
+    for (size_t capability = 0 ; capability < CAPABILITY_COUNT ; ++capability) {
+        if ( _capability_pins[capability] != other_._capability_pins[capability] ) { return false; }
+    }
+
+    return ((0 == ::memcmp(_analog_channel, other_._analog_channel, _pin_count))
+         && (0 == ::memcmp(_analog_read_resolution_bits, other_._analog_read_resolution_bits, _pin_count))
+         && (0 == ::memcmp(_analog_write_resolution_bits, other_._analog_write_resolution_bits, _pin_count)));
+}
+
+bool
+FirmataContract::operator!= (
+    const FirmataContract & other_
+) const {
+    return !(*this == other_);
+}
+
 /* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -2,53 +2,147 @@
 
 #include "FirmataQuery.h"
 
-#include <cstdio>
-#include <iostream>
+#include <algorithm>
+#include <cstring>
 
 #include "FirmataConstants.h"
 #include "FirmataContract.h"
+#include "Trace.h"
 
 using namespace remote_wiring::protocol;
 
-
-std::promise<void> FirmataQuery::callback_signal;
-std::future<void> FirmataQuery::callback_gate = callback_signal.get_future();
-void * FirmataQuery::contract_ready_callback_context = nullptr;
-std::atomic_bool FirmataQuery::contract_ready(false);
-FirmataQuery::contractReady FirmataQuery::contractReadyCallback = nullptr;
-std::atomic_bool FirmataQuery::firmata_ready(false);
-pin_config_t * FirmataQuery::pin = nullptr;
-size_t FirmataQuery::pin_count = 0;
-
 FirmataQuery::FirmataQuery (
     void
 ) :
+    _allocator(&BufferAllocator::heap()),
+    _analog_sampler(nullptr),
+    _analog_mapping_received(false),
+    _analog_mapping_size(0),
+    _cached_pin(nullptr),
+    _cached_pin_capacity(0),
+    _cached_pin_count(0),
+    _cached_fingerprint(0),
+    _capability_decoder(FirmataQuery::storePinConfig, this),
+    _capability_received(false),
+    _contract_cache(nullptr),
+    _contract_cached(false),
+    _contract_notified(false),
+    _contract_ready(false),
+    _contract_ready_callback(nullptr),
+    _contract_ready_callback_context(nullptr),
+    _contract_revised_callback(nullptr),
+    _contract_revised_callback_context(nullptr),
+    _firmata_ready(false),
+    _firmware_major(0),
+    _firmware_minor(0),
+    _outbound_lane(nullptr),
+    _outbound_scheduler(nullptr),
     _parser_buffer(nullptr),
     _parser_buffer_size(0),
-    _stream(nullptr)
+    _parser_stopping(false),
+    _parser_waiting(false),
+    _pin(nullptr),
+    _pin_capacity(0),
+    _pin_count(0),
+    _pin_config_ready_callback(nullptr),
+    _pin_config_ready_callback_context(nullptr),
+    _pin_state_mirror(nullptr),
+    _stream(nullptr),
+    _streaming_decoder(FirmataQuery::streamPinConfig, this),
+    _streaming_state(STREAM_IDLE)
 {
+    _firmware_name[0] = '\0';
 }
 
 FirmataQuery::~FirmataQuery (
     void
 ) {
-    delete[](_parser_buffer);
+    if ( nullptr != _stream ) { _stream->registerSerialEventCallback(nullptr, nullptr); }
+    if ( _parser_thread.joinable() ) {
+        {
+            std::lock_guard<std::mutex> lock(_parser_mutex);
+            _parser_stopping = true;
+        }
+        _parser_wakeup.notify_one();
+        _parser_thread.join();
+    }
+    if ( nullptr != _outbound_scheduler ) { _outbound_scheduler->closeLane(_outbound_lane); }
+    _allocator->deallocate(_cached_pin, (sizeof(pin_config_t) * _cached_pin_capacity));
+    _allocator->deallocate(_parser_buffer, _parser_buffer_size);
+    _allocator->deallocate(_pin, (sizeof(pin_config_t) * _pin_capacity));
+}
+
+bool
+FirmataQuery::cancelContractQuery (
+    void
+) {
+    // Claim the notification, so the callback is never invoked
+    if ( _contract_notified.exchange(true) ) { return false; }
+    _contract_signal.set_value();
+
+    return true;
+}
+
+std::shared_future<void>
+FirmataQuery::contractReadyFuture (
+    void
+) const {
+    return _contract_gate;
 }
 
 DeviceContract *
 FirmataQuery::detachDeviceContract (
     void
 ) {
-    if ( !contract_ready || !pin ) { return nullptr; }
+    // Prefer the live contract, and fall back to the cached contract
+    if ( _contract_ready && _pin ) { return (new (*_allocator) FirmataContract(_pin, _pin_count)); }
+    if ( _contract_cached && _cached_pin ) { return (new (*_allocator) FirmataContract(_cached_pin, _cached_pin_count)); }
 
-    return (new FirmataContract(pin, pin_count));
+    return nullptr;
 }
 
 void
 FirmataQuery::firmataReadyCallback (
     void * context_
 ) {
-    callback_signal.set_value();
+    reinterpret_cast<FirmataQuery *>(context_)->sendContractQueries();
+}
+
+void
+FirmataQuery::firmwareReportCallback (
+    void * context_,
+    size_t major_,
+    size_t minor_,
+    const char * firmware_
+) {
+    FirmataQuery * query = reinterpret_cast<FirmataQuery *>(context_);
+    size_t cached_pin_count;
+
+    if ( !firmware_ ) { return; }
+    ::strncpy(query->_firmware_name, firmware_, (ContractCache::FIRMWARE_NAME_SIZE - 1));
+    query->_firmware_name[(ContractCache::FIRMWARE_NAME_SIZE - 1)] = '\0';
+    query->_firmware_major = major_;
+    query->_firmware_minor = minor_;
+
+    // The device answered the query sent on attach, so its version report was missed
+    query->sendContractQueries();
+
+    // Serve the contract from the cache, while the live query revalidates it
+    if ( !query->_contract_cache || query->_contract_ready || query->_contract_cached ) { return; }
+    if ( 0 == (cached_pin_count = query->_contract_cache->lookup(query->_firmware_name, major_, minor_, nullptr, 0, nullptr)) ) { return; }
+    if ( 0 != query->reservePinTable(&query->_cached_pin, &query->_cached_pin_capacity, cached_pin_count) ) { return; }
+    query->_cached_pin_count = std::min(cached_pin_count, query->_contract_cache->lookup(query->_firmware_name, major_, minor_, query->_cached_pin, cached_pin_count, &query->_cached_fingerprint));
+    if ( 0 == query->_cached_pin_count ) { return; }
+
+    query->_contract_cached = true;
+    query->notifyContractReady();
+}
+
+const QueryMetrics *
+FirmataQuery::getMetrics (
+    void
+) const {
+    return &_metrics;
 }
 
 Stream *
@@ -66,34 +160,49 @@ FirmataQuery::queryContractAsync (
 ) {
     int error;
 
-    // Allocate the parser buffer
-    if ( NULL == (_parser_buffer = new uint8_t[firmata::MAX_DATA_BYTES]) ) {
+    // Allocate the parser buffer (retained across queries)
+    if ( !_parser_buffer && (NULL == (_parser_buffer = reinterpret_cast<uint8_t *>(_allocator->allocate(firmata::MAX_DATA_BYTES)))) ) {
         error = __LINE__;
-    } else if ( 0 != _parser.setDataBufferOfSize(_parser_buffer, firmata::MAX_DATA_BYTES) ) {
+    } else if ( !_parser_buffer_size && 0 != _parser.setDataBufferOfSize(_parser_buffer, firmata::MAX_DATA_BYTES) ) {
         error = __LINE__;
     } else {
         // Store user supplied variables
         _stream = stream_;
-        contractReadyCallback = contractReadyCallback_;
-        contract_ready_callback_context = contract_ready_callback_context_;
+        _contract_ready_callback = contractReadyCallback_;
+        _contract_ready_callback_context = contract_ready_callback_context_;
 
-        // Update state
-        _parser_buffer_size = firmata::MAX_DATA_BYTES;
+        // Reset state, so the query may be reused
+        if ( !_parser_buffer_size ) { _parser_buffer_size = firmata::MAX_DATA_BYTES; }
+        _analog_mapping_received = false;
+        _capability_received = false;
+        _streaming_state = STREAM_IDLE;
+        _contract_cached = false;
+        _contract_notified = false;
+        _contract_ready = false;
+        _firmata_ready = false;
+        _firmware_name[0] = '\0';
+        _contract_signal = std::promise<void>(std::allocator_arg, BufferAllocatorAdapter<void>(*_allocator));
+        _contract_gate = _contract_signal.get_future().share();
+        _query_started_at = std::chrono::steady_clock::now();
+        _metrics.recordQueryStarted();
 
         // Register callbacks
         _stream->registerSerialEventCallback(FirmataQuery::serialEventCallback, this);
         _parser.attach(FirmataQuery::extendBuffer, this);
         _parser.attach(firmata::REPORT_VERSION, FirmataQuery::firmataReadyCallback, this);
         _parser.attach(firmata::START_SYSEX, FirmataQuery::queryResponseCallback, this);
+        _parser.attach(firmata::REPORT_FIRMWARE, FirmataQuery::firmwareReportCallback, this);
 
-        // Invoke the marshaller
-        _marshaller.begin(*_stream);
-        if ( std::future_status::ready != callback_gate.wait_for(std::chrono::milliseconds(10000)) ) {
-            error = __LINE__;
+        // Invoke the marshaller; the queries are sent upon the version report,
+        // or upon the firmware report, should the version already have been reported
+        std::lock_guard<std::recursive_mutex> marshaller_lock(_marshaller_mutex);
+        if ( _outbound_lane ) {
+            _marshaller.begin(*_outbound_lane);
         } else {
-            _marshaller.sendCapabilityQuery();
-            error = 0;
+            _marshaller.begin(*_stream);
         }
+        _marshaller.sendFirmwareVersionQuery();
+        error = 0;
     }
 
     return error;
@@ -106,122 +215,418 @@ FirmataQuery::queryResponseCallback (
     size_t argc_,
     uint8_t * argv_
 ) {
-    ConfigCodec codec;
-    bool analog_resolution = false;
-    bool mode_byte = true;
-    bool pwm_resolution = false;
     FirmataQuery * this_query = (FirmataQuery *)context_;
 
     switch (command_) {
       case firmata::CAPABILITY_RESPONSE:
-        std::cout << std::endl;
-        std::cout << std::endl;
-        pin_count = 0;
-        codec.data = 0;
+        PROTOCOL_TRACE_INFO("Capability response: %u bytes", static_cast<unsigned int>(argc_));
+        this_query->_pin_count = 0;
+
+        // Count the pins first, so the pin table is sized exactly once
+        if ( 0 != this_query->reservePinTable(&this_query->_pin, &this_query->_pin_capacity, countCapabilityPins(argc_, argv_)) ) { break; }
 
         // Parse capability response into device contract struct
-        for (size_t i = 0 ; i < argc_ ; ++i, mode_byte = !mode_byte) {
-            //TODO: Remove print functionality from library and `#include`s
-            printf("0x%02x ", argv_[i]);
-            if ( mode_byte ) {
-                switch (argv_[i]) {
-                  case firmata::PIN_MODE_ANALOG:
-                    codec.config.supported_modes |= ANALOG_READ;
-                    analog_resolution = true;
-                    break;
-                  case firmata::PIN_MODE_IGNORE:
-                    printf("\nPinConfig %u:\n\tsupported modes: 0x%02x\n\tanalog read resolution bits: %u\n\tanalog write resolution bits: %u\n\n", static_cast<unsigned int>(pin_count), static_cast<uint8_t>(codec.config.supported_modes), static_cast<uint8_t>(codec.config.analog_read_resolution_bits), static_cast<uint8_t>(codec.config.analog_write_resolution_bits));
-                    ++pin_count;
-                    pin = (pin_config_t *)realloc(pin, (sizeof(pin_config_t) * pin_count));
-                    pin[(pin_count - 1)] = codec.data;
-                    codec.data = 0;
-                    mode_byte = !mode_byte;
-                    break;
-                  case firmata::PIN_MODE_INPUT:
-                    codec.config.supported_modes |= DIGITAL_READ;
-                    break;
-                  case firmata::PIN_MODE_OUTPUT:
-                    codec.config.supported_modes |= DIGITAL_WRITE;
-                    break;
-                  case firmata::PIN_MODE_PULLUP:
-                    codec.config.supported_modes |= DIGITAL_READ_WITH_PULLUP;
-                    break;
-                  case firmata::PIN_MODE_PWM:
-                    codec.config.supported_modes |= ANALOG_WRITE;
-                    pwm_resolution = true;
-                    break;
-                }
-            } else if ( analog_resolution ) {
-                codec.config.analog_read_resolution_bits = argv_[i];
-                analog_resolution = false;
-            } else if ( pwm_resolution ) {
-                codec.config.analog_write_resolution_bits = argv_[i];
-                pwm_resolution = false;
-            }
+        this_query->_capability_decoder.begin();
+        for (size_t i = 0 ; i < argc_ ; ++i) {
+            this_query->_capability_decoder.decode(argv_[i]);
         }
 
-        // Query analog pin mapping
-        this_query->_marshaller.sendAnalogMappingQuery();
+        this_query->_capability_received = true;
+        this_query->_metrics.recordPhase(QueryMetrics::Phase::CAPABILITY_RESPONSE, (std::chrono::steady_clock::now() - this_query->_queries_sent_at));
+        this_query->completeContract();
         break;
       case firmata::ANALOG_MAPPING_RESPONSE:
-        std::cout << std::endl;
-        std::cout << std::endl;
-        codec.data = 0;
+        PROTOCOL_TRACE_INFO("Analog mapping response: %u bytes", static_cast<unsigned int>(argc_));
 
-        // Parse analog mapping response into device contract struct
-        for (size_t i = 0 ; i < argc_ ; ++i) {
-            //TODO: Remove print functionality from library and `#include`s
-            printf("0x%02x ", argv_[i]);
-            codec.data = pin[i];
-            codec.config.reserved = argv_[i];
-            pin[i] = codec.data;
+        // Hold the analog mapping until the capability response is decoded
+        this_query->_analog_mapping_size = std::min(argc_, sizeof(this_query->_analog_mapping));
+        for (size_t i = 0 ; i < this_query->_analog_mapping_size ; ++i) {
+            this_query->_analog_mapping[i] = argv_[i];
         }
-        std::cout << std::endl;
 
-        contract_ready = true;
-        if ( NULL != contractReadyCallback ) { contractReadyCallback(contract_ready_callback_context); }
+        this_query->_analog_mapping_received = true;
+        this_query->_metrics.recordPhase(QueryMetrics::Phase::ANALOG_MAPPING_RESPONSE, (std::chrono::steady_clock::now() - this_query->_queries_sent_at));
+        this_query->completeContract();
+        break;
+      case firmata::PIN_STATE_RESPONSE:
+        if ( PinStateMirror * const mirror = this_query->_pin_state_mirror.load(std::memory_order_acquire) ) { mirror->pinStateResponse(argc_, argv_); }
         break;
       default: break;
     }
 }
 
+int
+FirmataQuery::enableParserThread (
+    const size_t ring_capacity_
+) {
+    if ( _parser_thread.joinable() ) { return __LINE__; }
+    if ( _stream ) { return __LINE__; }
+    _parser_ring.reset(new SpscByteRing(ring_capacity_));
+    _parser_thread = std::thread(&FirmataQuery::runParserThread, this);
+
+    return 0;
+}
+
+void
+FirmataQuery::enqueueFirmataStream (
+    void
+) {
+    uint8_t chunk[CHUNK_BUFFER_SIZE];
+
+    // Copy everything available into the ring, without parsing
+    for (size_t bytes_available ; (bytes_available = _stream->available()) ; ) {
+        size_t chunk_size = 0;
+        for (; (chunk_size < bytes_available) && (chunk_size < CHUNK_BUFFER_SIZE) ; ++chunk_size) {
+            chunk[chunk_size] = static_cast<uint8_t>(_stream->read());
+        }
+        const size_t bytes_queued = _parser_ring->push(chunk, chunk_size);
+        if ( bytes_queued < chunk_size ) {
+            PROTOCOL_TRACE_WARN("FirmataQuery::enqueueFirmataStream - Ring overrun: %u bytes dropped", static_cast<unsigned int>(chunk_size - bytes_queued));
+            _metrics.addRingOverruns(chunk_size - bytes_queued);
+        }
+    }
+    _metrics.recordRingOccupancy(_parser_ring->highWaterMark());
+
+    // Wake the parser only when it has gone idle (pairs with `runParserThread`)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if ( _parser_waiting.load(std::memory_order_relaxed) ) {
+        std::lock_guard<std::mutex> lock(_parser_mutex);
+        _parser_wakeup.notify_one();
+    }
+}
+
 void
 FirmataQuery::extendBuffer (
     void * context_
 ) {
     FirmataQuery * query = reinterpret_cast<FirmataQuery *>(context_);
 
-    std::cout << std::endl << query->_parser_buffer_size << "-byte buffer exhausted!" << std::endl;
+    PROTOCOL_TRACE_WARN("%u-byte buffer exhausted!", static_cast<unsigned int>(query->_parser_buffer_size));
     uint8_t * temp_buffer;
     size_t temp_buffer_size = (query->_parser_buffer_size * 2);
 
-    // Double parser buffer allocation
-    temp_buffer = reinterpret_cast<uint8_t *>(realloc(query->_parser_buffer, temp_buffer_size));
+    // Double parser buffer allocation, preserving the partially parsed message
+    temp_buffer = reinterpret_cast<uint8_t *>(query->_allocator->allocate(temp_buffer_size));
     if ( NULL != temp_buffer ) {
+        ::memcpy(temp_buffer, query->_parser_buffer, query->_parser_buffer_size);
+        query->_allocator->deallocate(query->_parser_buffer, query->_parser_buffer_size);
         query->_parser_buffer = temp_buffer;
         query->_parser_buffer_size = temp_buffer_size;
         (void)query->_parser.setDataBufferOfSize(query->_parser_buffer, query->_parser_buffer_size);
-        std::cout << "Buffer increased to " << query->_parser_buffer_size << "-byte buffer." << std::endl;
+        query->_metrics.recordBufferGrowth();
+        PROTOCOL_TRACE_INFO("Buffer increased to %u-byte buffer.", static_cast<unsigned int>(query->_parser_buffer_size));
+    } else {
+        // The parser will drop the bytes that do not fit
+        PROTOCOL_TRACE_ERROR("Unable to extend the %u-byte buffer.", static_cast<unsigned int>(query->_parser_buffer_size));
+        query->_metrics.recordParseError();
     }
 }
 
+void
+FirmataQuery::completeContract (
+    void
+) {
+    ConfigCodec codec;
+
+    // The responses may complete in either order
+    if ( !_capability_received || !_analog_mapping_received || _contract_ready ) { return; }
+
+    // A mapping that disagrees with the capability response is malformed
+    if ( _analog_mapping_size != _pin_count ) { _metrics.recordParseError(); }
+
+    // Merge the analog mapping into the device contract struct
+    for (size_t i = 0 ; (i < _analog_mapping_size) && (i < _pin_count) ; ++i) {
+        codec.data = _pin[i];
+        codec.config.reserved = _analog_mapping[i];
+        _pin[i] = codec.data;
+    }
+
+    _contract_ready = true;
+    _metrics.recordContractAcquired();
+    _metrics.recordPhase(QueryMetrics::Phase::CONTRACT_ACQUISITION, (std::chrono::steady_clock::now() - _query_started_at));
+    revalidateCachedContract();
+    notifyContractReady();
+}
+
+size_t
+FirmataQuery::countCapabilityPins (
+    const size_t argc_,
+    const uint8_t * argv_
+) {
+    size_t pin_count = 0;
+
+    // Each pin is a list of mode/resolution pairs terminated by PIN_MODE_IGNORE
+    for (size_t i = 0 ; i < argc_ ; ++i) {
+        if ( firmata::PIN_MODE_IGNORE == argv_[i] ) { ++pin_count; } else { ++i; }
+    }
+
+    return pin_count;
+}
+
+void
+FirmataQuery::notifyContractReady (
+    void
+) {
+    // The contract is reported ready once, whether served from cache or live
+    if ( _contract_notified.exchange(true) ) { return; }
+    _contract_signal.set_value();
+    if ( NULL != _contract_ready_callback ) { _contract_ready_callback(_contract_ready_callback_context); }
+}
+
+void
+FirmataQuery::parseChunk (
+    const uint8_t * chunk_,
+    const size_t chunk_size_
+) {
+    size_t frame_count = 0;
+
+    // Decode analog reports straight into the sampler
+    AnalogSampler * const analog_sampler = _analog_sampler.load(std::memory_order_acquire);
+    if ( analog_sampler ) { analog_sampler->ingest(chunk_, chunk_size_, std::chrono::steady_clock::now()); }
+
+    // Stream pin configurations while the capability response is in flight
+    if ( _pin_config_ready_callback && !_capability_received ) { streamCapabilityResponse(chunk_, chunk_size_); }
+
+    // Hand each byte to the parser, counting frames by their status bytes
+    for (size_t i = 0 ; i < chunk_size_ ; ++i) {
+        if ( (chunk_[i] & 0x80) && (firmata::END_SYSEX != chunk_[i]) ) { ++frame_count; }
+        _parser.parse(chunk_[i]);
+    }
+    _metrics.addFramesReceived(frame_count);
+}
+
 void
 FirmataQuery::processFirmataStream (
     void
 ) {
     if ( nullptr == _stream ) { return; }
-    uint8_t incoming_byte = '\0';
-    for (; _stream->available() ; _parser.parse(incoming_byte)) {
-        incoming_byte = _stream->read();
-        printf("0x%02x ", incoming_byte);
+
+    // Drain everything available into the chunk buffer, then parse in bulk
+    for (size_t bytes_available ; (bytes_available = _stream->available()) ; ) {
+        size_t chunk_size = 0;
+        for (; (chunk_size < bytes_available) && (chunk_size < CHUNK_BUFFER_SIZE) ; ++chunk_size) {
+            _chunk_buffer[chunk_size] = static_cast<uint8_t>(_stream->read());
+        }
+        _metrics.addBytesReceived(chunk_size);
+        parseChunk(_chunk_buffer, chunk_size);
+    }
+}
+
+int
+FirmataQuery::reservePinTable (
+    pin_config_t ** pin_table_,
+    size_t * pin_table_capacity_,
+    const size_t pin_count_
+) {
+    pin_config_t * pin_table;
+
+    // Reuse the existing table whenever it is large enough
+    if ( pin_count_ <= *pin_table_capacity_ ) { return 0; }
+    if ( NULL == (pin_table = reinterpret_cast<pin_config_t *>(_allocator->allocate(sizeof(pin_config_t) * pin_count_))) ) { return __LINE__; }
+
+    _allocator->deallocate(*pin_table_, (sizeof(pin_config_t) * *pin_table_capacity_));
+    *pin_table_ = pin_table;
+    *pin_table_capacity_ = pin_count_;
+
+    return 0;
+}
+
+void
+FirmataQuery::revalidateCachedContract (
+    void
+) {
+    if ( !_contract_cache || ('\0' == _firmware_name[0]) ) { return; }
+    if ( _contract_cached && (_cached_fingerprint == ContractCache::fingerprint(_pin, _pin_count)) ) { return; }
+
+    // The cache missed or is stale
+    (void)_contract_cache->store(_firmware_name, _firmware_major, _firmware_minor, _pin, _pin_count);
+    if ( _contract_cached && (NULL != _contract_revised_callback) ) { _contract_revised_callback(_contract_revised_callback_context); }
+}
+
+void
+FirmataQuery::runParserThread (
+    void
+) {
+    for (;;) {
+        // Parse everything queued since the last wakeup
+        for (size_t chunk_size ; (chunk_size = _parser_ring->pop(_chunk_buffer, CHUNK_BUFFER_SIZE)) ; ) {
+            _metrics.addBytesReceived(chunk_size);
+            parseChunk(_chunk_buffer, chunk_size);
+        }
+
+        // Sleep until the producer queues more bytes (pairs with `enqueueFirmataStream`)
+        std::unique_lock<std::mutex> lock(_parser_mutex);
+        _parser_waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        _parser_wakeup.wait(lock, [this]() { return (_parser_stopping || _parser_ring->size()); });
+        _parser_waiting.store(false, std::memory_order_relaxed);
+        if ( _parser_stopping ) { return; }
+        _metrics.recordParserWakeup();
     }
 }
 
+void
+FirmataQuery::setAnalogSampler (
+    AnalogSampler * analog_sampler_
+) {
+    _analog_sampler.store(analog_sampler_, std::memory_order_release);
+}
+
+void
+FirmataQuery::setOutboundScheduler (
+    OutboundScheduler * outbound_scheduler_
+) {
+    if ( outbound_scheduler_ == _outbound_scheduler ) { return; }
+    if ( nullptr != _outbound_scheduler ) { _outbound_scheduler->closeLane(_outbound_lane); }
+    _outbound_scheduler = outbound_scheduler_;
+    _outbound_lane = (_outbound_scheduler ? _outbound_scheduler->openLane(OutboundScheduler::PRIORITY_BULK) : nullptr);
+
+    // Rebind a marshaller already in use
+    std::lock_guard<std::recursive_mutex> marshaller_lock(_marshaller_mutex);
+    if ( _outbound_lane ) {
+        _marshaller.begin(*_outbound_lane);
+    } else if ( nullptr != _stream ) {
+        _marshaller.begin(*_stream);
+    }
+}
+
+void
+FirmataQuery::setPinStateMirror (
+    PinStateMirror * pin_state_mirror_
+) {
+    _pin_state_mirror.store(pin_state_mirror_, std::memory_order_release);
+}
+
+int
+FirmataQuery::setSamplingInterval (
+    const uint16_t interval_ms_,
+    const QueryMetrics::SamplingChange reason_
+) {
+    if ( nullptr == _stream ) { return __LINE__; }
+    std::lock_guard<std::recursive_mutex> marshaller_lock(_marshaller_mutex);
+    _marshaller.setSamplingInterval(interval_ms_);
+    _metrics.recordSamplingInterval(interval_ms_, reason_);
+
+    return 0;
+}
+
+void
+FirmataQuery::setPinConfigCallback (
+    pinConfigReady pinConfigReadyCallback_,
+    void * pin_config_ready_callback_context_
+) {
+    _pin_config_ready_callback = pinConfigReadyCallback_;
+    _pin_config_ready_callback_context = pin_config_ready_callback_context_;
+}
+
+void
+FirmataQuery::sendContractQueries (
+    void
+) {
+    // The device may announce itself more than once; only the first announcement starts the queries
+    if ( _firmata_ready.exchange(true) ) { return; }
+
+    _queries_sent_at = std::chrono::steady_clock::now();
+    _metrics.recordPhase(QueryMetrics::Phase::VERSION_WAIT, (_queries_sent_at - _query_started_at));
+
+    // Pipeline every query, rather than waiting on each response in turn
+    std::lock_guard<std::recursive_mutex> marshaller_lock(_marshaller_mutex);
+    if ( '\0' == _firmware_name[0] ) { _marshaller.sendFirmwareVersionQuery(); }
+    _marshaller.sendCapabilityQuery();
+    _marshaller.sendAnalogMappingQuery();
+}
+
 void
 FirmataQuery::serialEventCallback (
     void * context_
 ) {
-    reinterpret_cast<FirmataQuery *>(context_)->processFirmataStream();
+    FirmataQuery * query = reinterpret_cast<FirmataQuery *>(context_);
+
+    if ( query->_parser_ring ) {
+        query->enqueueFirmataStream();
+    } else {
+        query->processFirmataStream();
+    }
+}
+
+int
+FirmataQuery::setAllocator (
+    BufferAllocator & allocator_
+) {
+    if ( _cached_pin || _parser_buffer || _pin ) { return __LINE__; }
+    _allocator = &allocator_;
+
+    return 0;
+}
+
+std::shared_ptr<const FirmataContract>
+FirmataQuery::shareDeviceContract (
+    ContractRegistry & registry_
+) {
+    // Prefer the live contract, and fall back to the cached contract
+    if ( _contract_ready && _pin ) { return registry_.intern(_pin, _pin_count, *_allocator); }
+    if ( _contract_cached && _cached_pin ) { return registry_.intern(_cached_pin, _cached_pin_count, *_allocator); }
+
+    return nullptr;
+}
+
+void
+FirmataQuery::storePinConfig (
+    void * context_,
+    size_t pin_,
+    pin_config_t pin_data_
+) {
+    FirmataQuery * query = reinterpret_cast<FirmataQuery *>(context_);
+    ConfigCodec codec = { pin_data_ };
+
+    PROTOCOL_TRACE_DEBUG("PinConfig %u: supported modes: 0x%02x, analog read resolution bits: %u, analog write resolution bits: %u", static_cast<unsigned int>(pin_), static_cast<unsigned int>(codec.config.supported_modes), static_cast<unsigned int>(codec.config.analog_read_resolution_bits), static_cast<unsigned int>(codec.config.analog_write_resolution_bits));
+    if ( pin_ >= query->_pin_capacity ) { return; }
+    query->_pin[pin_] = pin_data_;
+    query->_pin_count = (pin_ + 1);
+}
+
+void
+FirmataQuery::streamCapabilityResponse (
+    const uint8_t * chunk_,
+    const size_t chunk_size_
+) {
+    // Track the capability response on the wire, ahead of the parser
+    for (size_t i = 0 ; i < chunk_size_ ; ++i) {
+        const uint8_t byte = chunk_[i];
+        if ( firmata::START_SYSEX == byte ) {
+            _streaming_state = STREAM_SYSEX_COMMAND;
+        } else if ( byte & 0x80 ) {
+            _streaming_state = STREAM_IDLE;
+        } else if ( STREAM_SYSEX_COMMAND == _streaming_state ) {
+            _streaming_state = ((firmata::CAPABILITY_RESPONSE == byte) ? STREAM_CAPABILITY_RESPONSE : STREAM_IDLE);
+            if ( STREAM_CAPABILITY_RESPONSE == _streaming_state ) { _streaming_decoder.begin(); }
+        } else if ( STREAM_CAPABILITY_RESPONSE == _streaming_state ) {
+            _streaming_decoder.decode(byte);
+        }
+    }
+}
+
+void
+FirmataQuery::streamPinConfig (
+    void * context_,
+    size_t pin_,
+    pin_config_t pin_data_
+) {
+    FirmataQuery * query = reinterpret_cast<FirmataQuery *>(context_);
+    ConfigCodec codec = { pin_data_ };
+
+    if ( query->_pin_config_ready_callback ) { query->_pin_config_ready_callback(query->_pin_config_ready_callback_context, pin_, codec.config); }
+}
+
+void
+FirmataQuery::setContractCache (
+    ContractCache * contract_cache_,
+    contractReady contractRevisedCallback_,
+    void * contract_revised_callback_context_
+) {
+    _contract_cache = contract_cache_;
+    _contract_revised_callback = contractRevisedCallback_;
+    _contract_revised_callback_context = contract_revised_callback_context_;
 }
 
 /* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,69 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "FirmataSessionManager.h"
+
+using namespace remote_wiring::protocol;
+
+FirmataSessionManager::FirmataSessionManager (
+    void
+) {
+}
+
+FirmataSessionManager::~FirmataSessionManager (
+    void
+) {
+}
+
+size_t
+FirmataSessionManager::addStream (
+    Stream * stream_
+) {
+    std::unique_ptr<Session> session(new Session());
+    session->stream = stream_;
+    _sessions.push_back(std::move(session));
+
+    return (_sessions.size() - 1);
+}
+
+DeviceContract *
+FirmataSessionManager::detachDeviceContract (
+    const size_t session_
+) {
+    if ( session_ >= _sessions.size() ) { return nullptr; }
+
+    return _sessions[session_]->query.detachDeviceContract();
+}
+
+size_t
+FirmataSessionManager::queryContracts (
+    const std::chrono::milliseconds timeout_
+) {
+    const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + timeout_);
+    std::vector<int> query_results;
+    size_t failures = 0;
+
+    // Launch every query; each returns immediately
+    for (auto & session : _sessions) {
+        query_results.push_back(session->query.queryContractAsync(session->stream, nullptr, nullptr));
+    }
+
+    // Collect the results against a shared deadline
+    for (size_t i = 0 ; i < _sessions.size() ; ++i) {
+        if ( 0 != query_results[i] ) {
+            ++failures;
+        } else if ( std::future_status::ready != _sessions[i]->query.contractReadyFuture().wait_until(deadline) ) {
+            ++failures;
+        }
+    }
+
+    return failures;
+}
+
+size_t
+FirmataSessionManager::sessionCount (
+    void
+) const {
+    return _sessions.size();
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,52 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "MessageFramer.h"
+
+#include "FirmataConstants.h"
+
+using namespace remote_wiring::protocol;
+
+MessageFramer::MessageFramer (
+    void
+) :
+    _bytes_remaining(0)
+{
+}
+
+size_t
+MessageFramer::dataBytes (
+    const uint8_t status_
+) {
+    switch (status_) {
+      case firmata::START_SYSEX: return SIZE_MAX;
+      case firmata::SET_PIN_MODE: return 2;
+      case firmata::SET_DIGITAL_PIN_VALUE: return 2;
+      default: break;
+    }
+
+    // Channel messages (i.e. DIGITAL_MESSAGE, REPORT_ANALOG), by MIDI rules
+    switch (status_ & 0xF0) {
+      case 0x80: case 0x90: case 0xA0: case 0xB0: case 0xE0: return 2;
+      case 0xC0: case 0xD0: return 1;
+      default: return 0;
+    }
+}
+
+unsigned
+MessageFramer::push (
+    const uint8_t byte_
+) {
+    if ( firmata::END_SYSEX == byte_ ) {
+        _bytes_remaining = 0;
+        return MESSAGE_ENDS;
+    } else if ( byte_ & 0x80 ) {
+        _bytes_remaining = dataBytes(byte_);
+        return (_bytes_remaining ? MESSAGE_BEGINS : (MESSAGE_BEGINS | MESSAGE_ENDS));
+    } else if ( (SIZE_MAX != _bytes_remaining) && _bytes_remaining && (0 == --_bytes_remaining) ) {
+        return MESSAGE_ENDS;
+    }
+
+    return MESSAGE_CONTINUES;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
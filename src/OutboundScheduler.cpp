@@ -0,0 +1,394 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "OutboundScheduler.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <poll.h>
+
+#include "Trace.h"
+
+using namespace remote_wiring::protocol;
+
+OutboundScheduler::OutboundScheduler (
+    FdStream & stream_,
+    const size_t class_capacity_,
+    const size_t quantum_
+) :
+    OutboundScheduler(stream_, &stream_, class_capacity_, quantum_)
+{
+}
+
+OutboundScheduler::OutboundScheduler (
+    Stream & stream_,
+    const size_t class_capacity_,
+    const size_t quantum_
+) :
+    OutboundScheduler(stream_, nullptr, class_capacity_, quantum_)
+{
+}
+
+OutboundScheduler::OutboundScheduler (
+    Stream & stream_,
+    FdStream * fd_stream_,
+    const size_t class_capacity_,
+    const size_t quantum_
+) :
+    _class_capacity(class_capacity_),
+    _fd_stream(fd_stream_),
+    _quantum(std::max(quantum_, static_cast<size_t>(1))),
+    _queued_frames(0),
+    _running(true),
+    _stream(stream_),
+    _writing_lane(nullptr)
+{
+    for (size_t priority_class = 0 ; priority_class < PRIORITY_CLASS_COUNT ; ++priority_class) {
+        ClassQueue & queue = _classes[priority_class];
+
+        queue.backpressure_waits = 0;
+        queue.bytes_sent = 0;
+        queue.frames_failed = 0;
+        queue.frames_sent = 0;
+        for (size_t bucket = 0 ; bucket < HistogramSnapshot::BUCKET_COUNT ; ++bucket) { queue.latency_buckets[bucket] = 0; }
+        queue.latency_sum_us = 0;
+        queue.queued_bytes = 0;
+    }
+    _dispatcher = std::thread(&OutboundScheduler::runDispatcher, this);
+}
+
+OutboundScheduler::~OutboundScheduler (
+    void
+) {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+    _dispatch_wakeup.notify_one();
+    _progress.notify_all();
+    _dispatcher.join();
+}
+
+uint64_t
+OutboundScheduler::backpressureWaits (
+    const PriorityClass priority_class_
+) const {
+    return ((priority_class_ < PRIORITY_CLASS_COUNT) ? _classes[priority_class_].backpressure_waits.load(std::memory_order_relaxed) : 0);
+}
+
+uint64_t
+OutboundScheduler::bytesSent (
+    const PriorityClass priority_class_
+) const {
+    return ((priority_class_ < PRIORITY_CLASS_COUNT) ? _classes[priority_class_].bytes_sent.load(std::memory_order_relaxed) : 0);
+}
+
+void
+OutboundScheduler::closeLane (
+    Lane * lane_
+) {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if ( nullptr == lane_ ) { return; }
+    waitForLane(lock, *lane_);
+    for (auto lane = _lanes.begin() ; lane != _lanes.end() ; ++lane) {
+        if ( lane->get() != lane_ ) { continue; }
+        _lanes.erase(lane);
+        break;
+    }
+}
+
+OutboundScheduler::Lane *
+OutboundScheduler::dequeue (
+    Frame * frame_
+) {
+    for (size_t priority_class = 0 ; priority_class < PRIORITY_CLASS_COUNT ; ++priority_class) {
+        std::deque<Lane *> & active = _classes[priority_class].active;
+
+        // Deficit round robin; a lane short of credit yields its turn
+        while ( !active.empty() ) {
+            Lane * lane = active.front();
+            const size_t frame_size = lane->_frames.front().bytes.size();
+
+            if ( lane->_deficit < frame_size ) {
+                lane->_deficit += _quantum;
+                active.pop_front();
+                active.push_back(lane);
+                continue;
+            }
+
+            lane->_deficit -= frame_size;
+            *frame_ = std::move(lane->_frames.front());
+            lane->_frames.pop_front();
+            if ( lane->_frames.empty() ) {
+                lane->_active = false;
+                lane->_deficit = 0;
+                active.pop_front();
+            }
+            _classes[priority_class].queued_bytes -= frame_size;
+            --_queued_frames;
+
+            return lane;
+        }
+    }
+
+    return nullptr;
+}
+
+bool
+OutboundScheduler::enqueue (
+    Lane & lane_
+) {
+    const std::chrono::steady_clock::time_point completed_at = std::chrono::steady_clock::now();
+    const size_t frame_size = lane_._frame.size();
+    ClassQueue & queue = _classes[lane_._priority_class];
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    // Hold the writer to the pace of the link, unless the writer is the
+    // dispatcher itself (i.e. a reply handler of a synchronous stream)
+    if ( queue.queued_bytes && ((queue.queued_bytes + frame_size) > _class_capacity) && (std::this_thread::get_id() != _dispatcher.get_id()) ) {
+        queue.backpressure_waits.fetch_add(1, std::memory_order_relaxed);
+        _progress.wait(lock, [this, &queue, frame_size]() {
+            return (!_running || !queue.queued_bytes || ((queue.queued_bytes + frame_size) <= _class_capacity));
+        });
+    }
+    if ( !_running ) {
+        lane_._frame.clear();
+        return false;
+    }
+
+    lane_._frames.emplace_back();
+    lane_._frames.back().bytes.swap(lane_._frame);
+    lane_._frames.back().enqueued_at = completed_at;
+    queue.queued_bytes += frame_size;
+    ++_queued_frames;
+    if ( !lane_._active ) {
+        lane_._active = true;
+        queue.active.push_back(&lane_);
+    }
+    lock.unlock();
+    _dispatch_wakeup.notify_one();
+
+    return true;
+}
+
+void
+OutboundScheduler::flush (
+    void
+) {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        // The dispatcher cannot wait upon itself
+        if ( std::this_thread::get_id() == _dispatcher.get_id() ) { return; }
+        _progress.wait(lock, [this]() { return ((!_queued_frames && (nullptr == _writing_lane)) || !_running); });
+    }
+    _stream.flush();
+}
+
+uint64_t
+OutboundScheduler::framesFailed (
+    const PriorityClass priority_class_
+) const {
+    return ((priority_class_ < PRIORITY_CLASS_COUNT) ? _classes[priority_class_].frames_failed.load(std::memory_order_relaxed) : 0);
+}
+
+uint64_t
+OutboundScheduler::framesSent (
+    const PriorityClass priority_class_
+) const {
+    return ((priority_class_ < PRIORITY_CLASS_COUNT) ? _classes[priority_class_].frames_sent.load(std::memory_order_relaxed) : 0);
+}
+
+OutboundScheduler::Lane *
+OutboundScheduler::openLane (
+    const PriorityClass priority_class_
+) {
+    if ( priority_class_ >= PRIORITY_CLASS_COUNT ) { return nullptr; }
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _lanes.emplace_back(new Lane(*this, priority_class_));
+    return _lanes.back().get();
+}
+
+HistogramSnapshot
+OutboundScheduler::queueLatency (
+    const PriorityClass priority_class_
+) const {
+    HistogramSnapshot snapshot = HistogramSnapshot();
+
+    if ( priority_class_ >= PRIORITY_CLASS_COUNT ) { return snapshot; }
+    const ClassQueue & queue = _classes[priority_class_];
+    for (size_t bucket = 0 ; bucket < HistogramSnapshot::BUCKET_COUNT ; ++bucket) {
+        snapshot.buckets[bucket] = queue.latency_buckets[bucket].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[bucket];
+    }
+    snapshot.sum_us = queue.latency_sum_us.load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+void
+OutboundScheduler::runDispatcher (
+    void
+) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    Frame frame;
+
+    while ( _running || _queued_frames ) {
+        if ( !_queued_frames ) {
+            _dispatch_wakeup.wait(lock);
+            continue;
+        }
+
+        Lane * lane = dequeue(&frame);
+        ClassQueue & queue = _classes[lane->_priority_class];
+        _writing_lane = lane;
+        lock.unlock();
+
+        // Record the wait, then write the whole frame
+        const uint64_t waited_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - frame.enqueued_at).count());
+        size_t bucket = 0;
+        while ( (bucket < (HistogramSnapshot::BUCKET_COUNT - 1)) && (waited_us > (1ULL << bucket)) ) { ++bucket; }
+        queue.latency_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        queue.latency_sum_us.fetch_add(waited_us, std::memory_order_relaxed);
+
+        if ( writeFrame(frame) ) {
+            queue.bytes_sent.fetch_add(frame.bytes.size(), std::memory_order_relaxed);
+            queue.frames_sent.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            queue.frames_failed.fetch_add(1, std::memory_order_relaxed);
+            PROTOCOL_TRACE_ERROR("OutboundScheduler::runDispatcher - Link failed mid-frame: %u byte frame", static_cast<unsigned int>(frame.bytes.size()));
+        }
+
+        lock.lock();
+        _writing_lane = nullptr;
+        _progress.notify_all();
+    }
+}
+
+bool
+OutboundScheduler::writeFrame (
+    const Frame & frame_
+) {
+    const uint8_t * const data = frame_.bytes.data();
+    const size_t size = frame_.bytes.size();
+    size_t offset = 0;
+
+    if ( nullptr == _fd_stream ) {
+        for (; (offset < size) && _stream.write(data[offset]) ; ++offset);
+        return (offset == size);
+    }
+
+    // Write the rest of the frame as the descriptor drains
+    for (ssize_t bytes_written ; (bytes_written = _fd_stream->write((data + offset), (size - offset))) >= 0 ; ) {
+        pollfd descriptor = { _fd_stream->fd(), POLLOUT, 0 };
+
+        if ( (offset += static_cast<size_t>(bytes_written)) == size ) { return true; }
+        if ( (::poll(&descriptor, 1, -1) < 0) && (EINTR != errno) ) { return false; }
+        if ( descriptor.revents & (POLLERR | POLLHUP | POLLNVAL) ) { return false; }
+    }
+
+    return false;
+}
+
+void
+OutboundScheduler::waitForLane (
+    std::unique_lock<std::mutex> & lock_,
+    const Lane & lane_
+) {
+    // The dispatcher cannot wait upon itself
+    if ( std::this_thread::get_id() == _dispatcher.get_id() ) { return; }
+    _progress.wait(lock_, [this, &lane_]() { return ((lane_._frames.empty() && (&lane_ != _writing_lane)) || !_running); });
+}
+
+OutboundScheduler::Lane::Lane (
+    OutboundScheduler & scheduler_,
+    const PriorityClass priority_class_
+) :
+    _active(false),
+    _deficit(0),
+    _priority_class(priority_class_),
+    _scheduler(scheduler_)
+{
+}
+
+size_t
+OutboundScheduler::Lane::available (
+    void
+) {
+    return _scheduler._stream.available();
+}
+
+void
+OutboundScheduler::Lane::begin (
+    const size_t speed_,
+    const size_t config_
+) {
+    (void)speed_;
+    (void)config_;
+}
+
+void
+OutboundScheduler::Lane::end (
+    void
+) {
+    flush();
+}
+
+void
+OutboundScheduler::Lane::flush (
+    void
+) {
+    {
+        std::unique_lock<std::mutex> lock(_scheduler._mutex);
+        _scheduler.waitForLane(lock, *this);
+    }
+    _scheduler._stream.flush();
+}
+
+int
+OutboundScheduler::Lane::peek (
+    void
+) {
+    return _scheduler._stream.peek();
+}
+
+OutboundScheduler::PriorityClass
+OutboundScheduler::Lane::priorityClass (
+    void
+) const {
+    return _priority_class;
+}
+
+int
+OutboundScheduler::Lane::read (
+    void
+) {
+    return _scheduler._stream.read();
+}
+
+void
+OutboundScheduler::Lane::registerSerialEventCallback (
+    serialEvent upon_read_,
+    void * context_
+) {
+    _scheduler._stream.registerSerialEventCallback(upon_read_, context_);
+}
+
+size_t
+OutboundScheduler::Lane::write (
+    uint8_t byte_
+) {
+    const unsigned boundary = _framer.push(byte_);
+
+    // A status byte ends whatever came before it, complete or not
+    if ( (boundary & MessageFramer::MESSAGE_BEGINS) && !_frame.empty() && !_scheduler.enqueue(*this) ) { return 0; }
+    _frame.push_back(byte_);
+    if ( (boundary & MessageFramer::MESSAGE_ENDS) && !_scheduler.enqueue(*this) ) { return 0; }
+
+    return 1;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
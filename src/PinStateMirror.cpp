@@ -0,0 +1,293 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "PinStateMirror.h"
+
+#include "FirmataConstants.h"
+#include "Trace.h"
+
+using namespace remote_wiring::protocol;
+
+// The mirror whose callback the current thread is invoking, if any
+static thread_local const PinStateMirror * reporting_mirror = nullptr;
+
+PinStateMirror::PinStateMirror (
+    const DeviceContract & contract_
+) :
+    _commands_sent(0),
+    _commands_suppressed(0),
+    _pin_state_reported_callback(nullptr),
+    _pin_state_reported_callback_context(nullptr),
+    _reports_in_flight(0)
+{
+    for (size_t capability = 0 ; capability < CAPABILITY_COUNT ; ++capability) {
+        _capability_pins[capability] = contract_.pinsWithCapability(static_cast<pin_config_t>(1) << capability);
+    }
+    for (size_t pin = 0 ; pin < PinSet::CAPACITY ; ++pin) {
+        _pin_state[pin].mode = UNKNOWN_MODE;
+        _pin_state[pin].state_known = false;
+        _pin_state[pin].state = 0;
+        _pin_state[pin].awaiting_callback = nullptr;
+        _pin_state[pin].awaiting_context = nullptr;
+    }
+}
+
+int
+PinStateMirror::analogWrite (
+    const size_t pin_,
+    const uint16_t value_
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if ( (pin_ >= PinSet::CAPACITY) || !_capability_pins[__builtin_ctzll(ANALOG_WRITE)].contains(pin_) ) { return __LINE__; }
+    if ( _pin_state[pin_].state_known && (value_ == _pin_state[pin_].state) ) {
+        ++_commands_suppressed;
+        return 0;
+    }
+    _marshaller.sendAnalog(static_cast<uint8_t>(pin_), value_);
+    ++_commands_sent;
+    recordState(pin_, value_);
+
+    return 0;
+}
+
+void
+PinStateMirror::begin (
+    Stream & stream_
+) {
+    _marshaller.begin(stream_);
+}
+
+uint8_t
+PinStateMirror::cachedPinMode (
+    const size_t pin_
+) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return ((pin_ < PinSet::CAPACITY) ? _pin_state[pin_].mode : UNKNOWN_MODE);
+}
+
+bool
+PinStateMirror::cancelPinStateQuery (
+    const size_t pin_,
+    void * context_
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // The report has taken the callback, and is invoking it
+    if ( (pin_ >= PinSet::CAPACITY) || !_pin_state[pin_].awaiting_callback || (context_ != _pin_state[pin_].awaiting_context) ) { return false; }
+    _pin_state[pin_].awaiting_callback = nullptr;
+    _pin_state[pin_].awaiting_context = nullptr;
+
+    return true;
+}
+
+bool
+PinStateMirror::cachedPinState (
+    const size_t pin_,
+    const duration max_age_,
+    uint32_t * state_
+) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if ( (pin_ >= PinSet::CAPACITY) || !_pin_state[pin_].state_known ) { return false; }
+    if ( (std::chrono::steady_clock::now() - _pin_state[pin_].updated_at) > max_age_ ) { return false; }
+    *state_ = _pin_state[pin_].state;
+
+    return true;
+}
+
+size_t
+PinStateMirror::commandsSent (
+    void
+) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _commands_sent;
+}
+
+size_t
+PinStateMirror::commandsSuppressed (
+    void
+) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _commands_suppressed;
+}
+
+int
+PinStateMirror::digitalWrite (
+    const size_t pin_,
+    const bool value_
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if ( (pin_ >= PinSet::CAPACITY) || !_capability_pins[__builtin_ctzll(DIGITAL_WRITE)].contains(pin_) ) { return __LINE__; }
+    if ( _pin_state[pin_].state_known && (static_cast<uint32_t>(value_) == _pin_state[pin_].state) ) {
+        ++_commands_suppressed;
+        return 0;
+    }
+    _marshaller.sendDigital(static_cast<uint8_t>(pin_), value_);
+    ++_commands_sent;
+    recordState(pin_, value_);
+
+    return 0;
+}
+
+void
+PinStateMirror::exchangePinStateCallback (
+    pinStateReported upon_report_,
+    void * context_,
+    pinStateReported * previous_callback_,
+    void ** previous_context_
+) {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if ( previous_callback_ ) { *previous_callback_ = _pin_state_reported_callback; }
+    if ( previous_context_ ) { *previous_context_ = _pin_state_reported_callback_context; }
+    _pin_state_reported_callback = upon_report_;
+    _pin_state_reported_callback_context = context_;
+
+    // Let the reports already invoking the previous callback finish, unless
+    // the caller is that callback, which would then wait upon itself
+    if ( this != reporting_mirror ) { _reports_done.wait(lock, [this]() { return !_reports_in_flight; }); }
+}
+
+bool
+PinStateMirror::modeAvailableOnPin (
+    const size_t pin_,
+    const uint8_t mode_
+) const {
+    pin_config_t capability;
+
+    switch (mode_) {
+      case firmata::PIN_MODE_ANALOG: capability = ANALOG_READ; break;
+      case firmata::PIN_MODE_INPUT: capability = DIGITAL_READ; break;
+      case firmata::PIN_MODE_OUTPUT: capability = DIGITAL_WRITE; break;
+      case firmata::PIN_MODE_PULLUP: capability = DIGITAL_READ_WITH_PULLUP; break;
+      case firmata::PIN_MODE_PWM: capability = ANALOG_WRITE; break;
+      default:
+        // The contract does not describe the remaining modes
+        return true;
+    }
+
+    return _capability_pins[__builtin_ctzll(capability)].contains(pin_);
+}
+
+void
+PinStateMirror::pinStateResponse (
+    const size_t argc_,
+    const uint8_t * argv_
+) {
+    pinStateReported awaiting_callback;
+    void * awaiting_context;
+    pinStateReported reported_callback;
+    void * reported_context;
+    uint32_t state = 0;
+
+    if ( (argc_ < 3) || (argv_[0] >= PinSet::CAPACITY) ) { return; }
+    for (size_t i = 2 ; (i < argc_) && (i < 6) ; ++i) {
+        state |= (static_cast<uint32_t>(argv_[i] & 0x7F) << (7 * (i - 2)));
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        PinState & pin_state = _pin_state[argv_[0]];
+
+        pin_state.mode = argv_[1];
+        recordState(argv_[0], state);
+
+        // The awaiting query is answered once
+        awaiting_callback = pin_state.awaiting_callback;
+        awaiting_context = pin_state.awaiting_context;
+        pin_state.awaiting_callback = nullptr;
+        pin_state.awaiting_context = nullptr;
+
+        // Held in flight, so the callback is not detached while it runs
+        reported_callback = _pin_state_reported_callback;
+        reported_context = _pin_state_reported_callback_context;
+        if ( reported_callback ) { ++_reports_in_flight; }
+    }
+
+    // The callbacks may call back into the mirror (i.e. to query another pin)
+    if ( reported_callback ) {
+        const PinStateMirror * const enclosing_mirror = reporting_mirror;
+
+        reporting_mirror = this;
+        reported_callback(reported_context, argv_[0]);
+        reporting_mirror = enclosing_mirror;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_reports_in_flight;
+        }
+        _reports_done.notify_all();
+    }
+    if ( awaiting_callback ) { awaiting_callback(awaiting_context, argv_[0]); }
+}
+
+int
+PinStateMirror::queryPinState (
+    const size_t pin_
+) {
+    return queryPinState(pin_, nullptr, nullptr);
+}
+
+int
+PinStateMirror::queryPinState (
+    const size_t pin_,
+    pinStateReported upon_report_,
+    void * context_
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if ( pin_ >= PinSet::CAPACITY ) { return __LINE__; }
+    if ( upon_report_ ) {
+        if ( _pin_state[pin_].awaiting_callback ) { return __LINE__; }
+        _pin_state[pin_].awaiting_callback = upon_report_;
+        _pin_state[pin_].awaiting_context = context_;
+    }
+    _marshaller.sendPinStateQuery(static_cast<uint8_t>(pin_));
+
+    return 0;
+}
+
+void
+PinStateMirror::recordState (
+    const size_t pin_,
+    const uint32_t state_
+) {
+    _pin_state[pin_].state_known = true;
+    _pin_state[pin_].state = state_;
+    _pin_state[pin_].updated_at = std::chrono::steady_clock::now();
+}
+
+void
+PinStateMirror::setPinStateCallback (
+    pinStateReported upon_report_,
+    void * context_
+) {
+    exchangePinStateCallback(upon_report_, context_, nullptr, nullptr);
+}
+
+int
+PinStateMirror::setPinMode (
+    const size_t pin_,
+    const uint8_t mode_
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if ( (pin_ >= PinSet::CAPACITY) || !modeAvailableOnPin(pin_, mode_) ) {
+        PROTOCOL_TRACE_WARN("PinStateMirror::setPinMode - Pin %u does not support mode 0x%02x", static_cast<unsigned int>(pin_), static_cast<unsigned int>(mode_));
+        return __LINE__;
+    }
+    if ( mode_ == _pin_state[pin_].mode ) {
+        ++_commands_suppressed;
+        return 0;
+    }
+    _marshaller.sendPinMode(static_cast<uint8_t>(pin_), mode_);
+    ++_commands_sent;
+
+    // The state of a pin is not carried across a change of mode
+    _pin_state[pin_].mode = mode_;
+    _pin_state[pin_].state_known = false;
+
+    return 0;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,118 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "PinStateSweep.h"
+
+#include <algorithm>
+
+#include "Trace.h"
+
+using namespace remote_wiring::protocol;
+
+PinStateSweep::PinStateSweep (
+    PinStateMirror & mirror_,
+    const size_t pin_count_,
+    const size_t window_
+) :
+    _answered(0),
+    _in_flight(0),
+    _mirror(mirror_),
+    _next_pin(0),
+    _pin_count((pin_count_ < PinSet::CAPACITY) ? pin_count_ : PinSet::CAPACITY),
+    _previous_callback(nullptr),
+    _previous_context(nullptr),
+    _queries_sent(0),
+    _window(std::max(window_, static_cast<size_t>(1)))
+{
+}
+
+void
+PinStateSweep::begin (
+    Stream & stream_
+) {
+    _marshaller.begin(stream_);
+}
+
+void
+PinStateSweep::pinStateReported (
+    void * context_,
+    size_t pin_
+) {
+    PinStateSweep * sweep = reinterpret_cast<PinStateSweep *>(context_);
+
+    // Keep the observer the sweep replaced informed
+    if ( sweep->_previous_callback ) { sweep->_previous_callback(sweep->_previous_context, pin_); }
+
+    std::lock_guard<std::mutex> lock(sweep->_mutex);
+
+    // Ignore responses to queries made outside of the sweep
+    if ( !sweep->_outstanding.contains(pin_) ) { return; }
+    sweep->_outstanding.erase(pin_);
+    --sweep->_in_flight;
+    ++sweep->_answered;
+    sweep->_condition.notify_one();
+}
+
+size_t
+PinStateSweep::queriesSent (
+    void
+) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _queries_sent;
+}
+
+int
+PinStateSweep::sweep (
+    const duration timeout_,
+    std::vector<PinStateReport> * snapshot_
+) {
+    const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + timeout_);
+    PinSet answered;
+    int error;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _answered = 0;
+        _in_flight = 0;
+        _next_pin = 0;
+        _outstanding = PinSet();
+    }
+    _mirror.exchangePinStateCallback(PinStateSweep::pinStateReported, this, &_previous_callback, &_previous_context);
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while ( _answered < _pin_count ) {
+            // Refill the window (responses may be delivered on this thread,
+            // from within the write, so the lock is released to send)
+            while ( (_in_flight < _window) && (_next_pin < _pin_count) ) {
+                const size_t pin = _next_pin++;
+                _outstanding.insert(pin);
+                ++_in_flight;
+                ++_queries_sent;
+                lock.unlock();
+                _marshaller.sendPinStateQuery(static_cast<uint8_t>(pin));
+                lock.lock();
+            }
+            if ( !_condition.wait_until(lock, deadline, [this]() { return ((_answered == _pin_count) || ((_in_flight < _window) && (_next_pin < _pin_count))); }) ) { break; }
+        }
+        answered = (PinSet::firstPins(_next_pin) & ~_outstanding);
+        error = ((_answered == _pin_count) ? 0 : __LINE__);
+        if ( error ) {
+            PROTOCOL_TRACE_WARN("PinStateSweep::sweep - %u of %u pins answered before the timeout", static_cast<unsigned int>(_answered), static_cast<unsigned int>(_pin_count));
+        }
+    }
+    _mirror.setPinStateCallback(_previous_callback, _previous_context);
+
+    if ( snapshot_ ) {
+        snapshot_->resize(_pin_count);
+        for (size_t pin = 0 ; pin < _pin_count ; ++pin) {
+            PinStateReport & report = (*snapshot_)[pin];
+            report.mode = (answered.contains(pin) ? _mirror.cachedPinMode(pin) : PinStateMirror::UNKNOWN_MODE);
+            report.state = 0;
+            if ( answered.contains(pin) ) { _mirror.cachedPinState(pin, duration::max(), &report.state); }
+        }
+    }
+
+    return error;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
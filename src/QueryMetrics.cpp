@@ -0,0 +1,217 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "QueryMetrics.h"
+
+#include <sstream>
+
+using namespace remote_wiring::protocol;
+
+static const char * const PHASE_NAMES[QueryMetricsSnapshot::PHASE_COUNT] = {
+    "version_wait",
+    "capability_response",
+    "analog_mapping_response",
+    "contract_acquisition",
+};
+
+static const char * const SAMPLING_CHANGE_NAMES[QueryMetricsSnapshot::SAMPLING_CHANGE_COUNT] = {
+    "requested",
+    "backlog",
+    "overrun",
+    "recovered",
+};
+
+QueryMetrics::QueryMetrics (
+    void
+) :
+    _buffer_growths(0),
+    _bytes_received(0),
+    _contracts_acquired(0),
+    _frames_received(0),
+    _parse_errors(0),
+    _parser_wakeups(0),
+    _queries_started(0),
+    _ring_high_water_mark(0),
+    _ring_overruns(0),
+    _sampling_interval_ms(0)
+{
+    for (size_t reason = 0 ; reason < QueryMetricsSnapshot::SAMPLING_CHANGE_COUNT ; ++reason) { _sampling_interval_changes[reason] = 0; }
+    for (size_t phase = 0 ; phase < QueryMetricsSnapshot::PHASE_COUNT ; ++phase) {
+        for (size_t bucket = 0 ; bucket < HistogramSnapshot::BUCKET_COUNT ; ++bucket) { _phases[phase].buckets[bucket] = 0; }
+        _phases[phase].count = 0;
+        _phases[phase].sum_us = 0;
+    }
+}
+
+void
+QueryMetrics::addBytesReceived (
+    const size_t bytes_
+) {
+    _bytes_received.fetch_add(bytes_, std::memory_order_relaxed);
+}
+
+void
+QueryMetrics::addFramesReceived (
+    const size_t frames_
+) {
+    _frames_received.fetch_add(frames_, std::memory_order_relaxed);
+}
+
+void
+QueryMetrics::addRingOverruns (
+    const size_t bytes_
+) {
+    _ring_overruns.fetch_add(bytes_, std::memory_order_relaxed);
+}
+
+std::string
+QueryMetrics::exposition (
+    const QueryMetricsSnapshot & snapshot_,
+    const char * device_
+) {
+    std::ostringstream text;
+    const std::string label = (std::string("device=\"") + (device_ ? device_ : "") + "\"");
+
+    text << "# TYPE firmata_bytes_received_total counter\n"
+         << "firmata_bytes_received_total{" << label << "} " << snapshot_.bytes_received << "\n"
+         << "# TYPE firmata_frames_received_total counter\n"
+         << "firmata_frames_received_total{" << label << "} " << snapshot_.frames_received << "\n"
+         << "# TYPE firmata_parse_errors_total counter\n"
+         << "firmata_parse_errors_total{" << label << "} " << snapshot_.parse_errors << "\n"
+         << "# TYPE firmata_parser_buffer_growths_total counter\n"
+         << "firmata_parser_buffer_growths_total{" << label << "} " << snapshot_.buffer_growths << "\n"
+         << "# TYPE firmata_queries_started_total counter\n"
+         << "firmata_queries_started_total{" << label << "} " << snapshot_.queries_started << "\n"
+         << "# TYPE firmata_parser_wakeups_total counter\n"
+         << "firmata_parser_wakeups_total{" << label << "} " << snapshot_.parser_wakeups << "\n"
+         << "# TYPE firmata_ring_high_water_mark_bytes gauge\n"
+         << "firmata_ring_high_water_mark_bytes{" << label << "} " << snapshot_.ring_high_water_mark << "\n"
+         << "# TYPE firmata_ring_overruns_bytes_total counter\n"
+         << "firmata_ring_overruns_bytes_total{" << label << "} " << snapshot_.ring_overruns << "\n"
+         << "# TYPE firmata_sampling_interval_milliseconds gauge\n"
+         << "firmata_sampling_interval_milliseconds{" << label << "} " << snapshot_.sampling_interval_ms << "\n"
+         << "# TYPE firmata_sampling_interval_changes_total counter\n";
+    for (size_t reason = 0 ; reason < QueryMetricsSnapshot::SAMPLING_CHANGE_COUNT ; ++reason) {
+        text << "firmata_sampling_interval_changes_total{" << label << ",reason=\"" << SAMPLING_CHANGE_NAMES[reason] << "\"} " << snapshot_.sampling_interval_changes[reason] << "\n";
+    }
+    text << "# TYPE firmata_contracts_acquired_total counter\n"
+         << "firmata_contracts_acquired_total{" << label << "} " << snapshot_.contracts_acquired << "\n"
+         << "# TYPE firmata_phase_duration_microseconds histogram\n";
+
+    for (size_t phase = 0 ; phase < QueryMetricsSnapshot::PHASE_COUNT ; ++phase) {
+        const HistogramSnapshot & histogram = snapshot_.phases[phase];
+        const std::string phase_label = (label + ",phase=\"" + PHASE_NAMES[phase] + "\"");
+        uint64_t cumulative = 0;
+
+        for (size_t bucket = 0 ; bucket < (HistogramSnapshot::BUCKET_COUNT - 1) ; ++bucket) {
+            cumulative += histogram.buckets[bucket];
+            text << "firmata_phase_duration_microseconds_bucket{" << phase_label << ",le=\"" << (1ULL << bucket) << "\"} " << cumulative << "\n";
+        }
+        text << "firmata_phase_duration_microseconds_bucket{" << phase_label << ",le=\"+Inf\"} " << histogram.count << "\n"
+             << "firmata_phase_duration_microseconds_sum{" << phase_label << "} " << histogram.sum_us << "\n"
+             << "firmata_phase_duration_microseconds_count{" << phase_label << "} " << histogram.count << "\n";
+    }
+
+    return text.str();
+}
+
+void
+QueryMetrics::recordBufferGrowth (
+    void
+) {
+    _buffer_growths.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+QueryMetrics::recordContractAcquired (
+    void
+) {
+    _contracts_acquired.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+QueryMetrics::recordParseError (
+    void
+) {
+    _parse_errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+QueryMetrics::recordParserWakeup (
+    void
+) {
+    _parser_wakeups.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+QueryMetrics::recordPhase (
+    const Phase phase_,
+    const std::chrono::steady_clock::duration elapsed_
+) {
+    const uint64_t elapsed_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed_).count());
+    size_t bucket = 0;
+
+    if ( phase_ >= QueryMetricsSnapshot::PHASE_COUNT ) { return; }
+    while ( (bucket < (HistogramSnapshot::BUCKET_COUNT - 1)) && (elapsed_us > (1ULL << bucket)) ) { ++bucket; }
+
+    _phases[phase_].buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    _phases[phase_].sum_us.fetch_add(elapsed_us, std::memory_order_relaxed);
+    _phases[phase_].count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+QueryMetrics::recordQueryStarted (
+    void
+) {
+    _queries_started.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+QueryMetrics::recordRingOccupancy (
+    const size_t bytes_
+) {
+    uint64_t high_water_mark = _ring_high_water_mark.load(std::memory_order_relaxed);
+
+    while ( (bytes_ > high_water_mark) && !_ring_high_water_mark.compare_exchange_weak(high_water_mark, bytes_, std::memory_order_relaxed) ) {}
+}
+
+void
+QueryMetrics::recordSamplingInterval (
+    const uint16_t interval_ms_,
+    const SamplingChange reason_
+) {
+    if ( reason_ >= QueryMetricsSnapshot::SAMPLING_CHANGE_COUNT ) { return; }
+    _sampling_interval_ms.store(interval_ms_, std::memory_order_relaxed);
+    _sampling_interval_changes[reason_].fetch_add(1, std::memory_order_relaxed);
+}
+
+QueryMetricsSnapshot
+QueryMetrics::snapshot (
+    void
+) const {
+    QueryMetricsSnapshot snapshot;
+
+    snapshot.buffer_growths = _buffer_growths.load(std::memory_order_relaxed);
+    snapshot.bytes_received = _bytes_received.load(std::memory_order_relaxed);
+    snapshot.contracts_acquired = _contracts_acquired.load(std::memory_order_relaxed);
+    snapshot.frames_received = _frames_received.load(std::memory_order_relaxed);
+    snapshot.parse_errors = _parse_errors.load(std::memory_order_relaxed);
+    snapshot.parser_wakeups = _parser_wakeups.load(std::memory_order_relaxed);
+    snapshot.queries_started = _queries_started.load(std::memory_order_relaxed);
+    snapshot.ring_high_water_mark = _ring_high_water_mark.load(std::memory_order_relaxed);
+    snapshot.ring_overruns = _ring_overruns.load(std::memory_order_relaxed);
+    for (size_t reason = 0 ; reason < QueryMetricsSnapshot::SAMPLING_CHANGE_COUNT ; ++reason) {
+        snapshot.sampling_interval_changes[reason] = _sampling_interval_changes[reason].load(std::memory_order_relaxed);
+    }
+    snapshot.sampling_interval_ms = _sampling_interval_ms.load(std::memory_order_relaxed);
+    for (size_t phase = 0 ; phase < QueryMetricsSnapshot::PHASE_COUNT ; ++phase) {
+        for (size_t bucket = 0 ; bucket < HistogramSnapshot::BUCKET_COUNT ; ++bucket) {
+            snapshot.phases[phase].buckets[bucket] = _phases[phase].buckets[bucket].load(std::memory_order_relaxed);
+        }
+        snapshot.phases[phase].count = _phases[phase].count.load(std::memory_order_relaxed);
+        snapshot.phases[phase].sum_us = _phases[phase].sum_us.load(std::memory_order_relaxed);
+    }
+
+    return snapshot;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,90 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "SamplingController.h"
+
+#include <algorithm>
+
+#include "Trace.h"
+
+using namespace remote_wiring::protocol;
+
+SamplingController::SamplingController (
+    FirmataQuery & query_,
+    const AnalogSampler & sampler_,
+    const uint16_t min_interval_ms_,
+    const uint16_t max_interval_ms_
+) :
+    _calm_updates(0),
+    _interval_ms(DEFAULT_INTERVAL_MS),
+    _max_interval_ms(std::max(min_interval_ms_, max_interval_ms_)),
+    _min_interval_ms(min_interval_ms_),
+    _query(query_),
+    _sampler(sampler_),
+    _samples_dropped(sampler_.samplesDropped())
+{
+}
+
+int
+SamplingController::begin (
+    const uint16_t interval_ms_
+) {
+    int error;
+
+    _calm_updates = 0;
+    _samples_dropped = _sampler.samplesDropped();
+    if ( 0 == (error = _query.setSamplingInterval(interval_ms_, QueryMetricsSnapshot::SAMPLING_REQUESTED)) ) {
+        _interval_ms = interval_ms_;
+    }
+
+    return error;
+}
+
+bool
+SamplingController::changeInterval (
+    const uint32_t interval_ms_,
+    const QueryMetrics::SamplingChange reason_
+) {
+    const uint16_t interval_ms = static_cast<uint16_t>(std::min(std::max(interval_ms_, static_cast<uint32_t>(_min_interval_ms)), static_cast<uint32_t>(_max_interval_ms)));
+
+    _calm_updates = 0;
+    if ( interval_ms == _interval_ms ) { return false; }
+    if ( 0 != _query.setSamplingInterval(interval_ms, reason_) ) { return false; }
+    PROTOCOL_TRACE_INFO("SamplingController::changeInterval - %u ms -> %u ms (reason %d)", static_cast<unsigned int>(_interval_ms), static_cast<unsigned int>(interval_ms), static_cast<int>(reason_));
+    _interval_ms = interval_ms;
+
+    return true;
+}
+
+uint16_t
+SamplingController::interval (
+    void
+) const {
+    return _interval_ms;
+}
+
+bool
+SamplingController::update (
+    void
+) {
+    const size_t samples_dropped = _sampler.samplesDropped();
+    const size_t backlog = _sampler.backlog();
+    const size_t capacity = _sampler.samplesPerPin();
+    const bool overrun = (samples_dropped != _samples_dropped);
+
+    _samples_dropped = samples_dropped;
+
+    // Back off quickly when the consumers fall behind
+    if ( overrun ) { return changeInterval((_interval_ms * 2U), QueryMetricsSnapshot::SAMPLING_OVERRUN); }
+    if ( backlog > (capacity / 2) ) { return changeInterval((_interval_ms * 2U), QueryMetricsSnapshot::SAMPLING_BACKLOG); }
+
+    // Speed up again, only once the consumers have kept up for a while
+    if ( backlog > (capacity / 8) ) {
+        _calm_updates = 0;
+    } else if ( ++_calm_updates >= RECOVERY_UPDATES ) {
+        return changeInterval((_interval_ms / 2U), QueryMetricsSnapshot::SAMPLING_RECOVERED);
+    }
+
+    return false;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
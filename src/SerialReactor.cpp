@@ -0,0 +1,174 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "SerialReactor.h"
+
+#include <cstdint>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "Trace.h"
+
+using namespace remote_wiring::protocol;
+
+static const int MAX_EVENTS = 64;
+
+SerialReactor::SerialReactor (
+    void
+) :
+    _dispatches(0),
+    _epoll_fd(::epoll_create1(EPOLL_CLOEXEC)),
+    _hangups(0),
+    _stop_fd(::eventfd(0, (EFD_CLOEXEC | EFD_NONBLOCK))),
+    _wakeups(0)
+{
+    struct epoll_event event = {};
+
+    // The stop event is level-triggered, so it wakes every worker
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if ( _epoll_fd >= 0 && _stop_fd >= 0 ) { ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _stop_fd, &event); }
+}
+
+SerialReactor::~SerialReactor (
+    void
+) {
+    stop();
+    if ( _stop_fd >= 0 ) { ::close(_stop_fd); }
+    if ( _epoll_fd >= 0 ) { ::close(_epoll_fd); }
+}
+
+int
+SerialReactor::attach (
+    FdStream & stream_
+) {
+    int error;
+    struct epoll_event event = {};
+
+    event.events = (EPOLLIN | EPOLLONESHOT);
+    event.data.ptr = &stream_;
+
+    if ( _epoll_fd < 0 ) {
+        error = __LINE__;
+    } else if ( 0 != ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, stream_.fd(), &event) ) {
+        PROTOCOL_TRACE_ERROR("SerialReactor::attach - Unable to register fd %d", stream_.fd());
+        error = __LINE__;
+    } else {
+        error = 0;
+    }
+
+    return error;
+}
+
+int
+SerialReactor::detach (
+    FdStream & stream_
+) {
+    int error;
+
+    if ( _epoll_fd < 0 ) {
+        error = __LINE__;
+    } else if ( 0 != ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, stream_.fd(), nullptr) ) {
+        error = __LINE__;
+    } else {
+        error = 0;
+    }
+
+    return error;
+}
+
+size_t
+SerialReactor::dispatches (
+    void
+) const {
+    return _dispatches.load(std::memory_order_relaxed);
+}
+
+size_t
+SerialReactor::hangups (
+    void
+) const {
+    return _hangups.load(std::memory_order_relaxed);
+}
+
+void
+SerialReactor::run (
+    void
+) {
+    struct epoll_event events[MAX_EVENTS];
+
+    for (;;) {
+        const int ready = ::epoll_wait(_epoll_fd, events, MAX_EVENTS, -1);
+        if ( ready < 0 ) { continue; }  // EINTR
+        _wakeups.fetch_add(1, std::memory_order_relaxed);
+
+        for (int i = 0 ; i < ready ; ++i) {
+            FdStream * stream = static_cast<FdStream *>(events[i].data.ptr);
+
+            // Exit upon the stop event
+            if ( !stream ) { return; }
+
+            _dispatches.fetch_add(1, std::memory_order_relaxed);
+            if ( stream->service() < 0 ) {
+                PROTOCOL_TRACE_WARN("SerialReactor::run - fd %d hung up", stream->fd());
+                _hangups.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            // Re-arm the descriptor for the next worker
+            struct epoll_event event = {};
+            event.events = (EPOLLIN | EPOLLONESHOT);
+            event.data.ptr = stream;
+            ::epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, stream->fd(), &event);
+        }
+    }
+}
+
+int
+SerialReactor::start (
+    const size_t worker_count_
+) {
+    int error;
+
+    if ( _epoll_fd < 0 || _stop_fd < 0 ) {
+        error = __LINE__;
+    } else if ( !_workers.empty() ) {
+        error = __LINE__;
+    } else if ( !worker_count_ ) {
+        error = __LINE__;
+    } else {
+        for (size_t i = 0 ; i < worker_count_ ; ++i) {
+            _workers.emplace_back(&SerialReactor::run, this);
+        }
+        error = 0;
+    }
+
+    return error;
+}
+
+void
+SerialReactor::stop (
+    void
+) {
+    uint64_t value = 1;
+    ssize_t result;
+
+    if ( _workers.empty() ) { return; }
+    result = ::write(_stop_fd, &value, sizeof(value));
+    (void)result;
+    for (auto & worker : _workers) { worker.join(); }
+    _workers.clear();
+
+    // Drain the stop event, so the reactor may be restarted
+    result = ::read(_stop_fd, &value, sizeof(value));
+}
+
+size_t
+SerialReactor::wakeups (
+    void
+) const {
+    return _wakeups.load(std::memory_order_relaxed);
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,304 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "SevenBitCodec.h"
+
+#include <atomic>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define SEVEN_BIT_CODEC_X86
+  #include <immintrin.h>
+#elif defined(__ARM_NEON)
+  #define SEVEN_BIT_CODEC_NEON
+  #include <arm_neon.h>
+#endif
+
+using namespace remote_wiring::protocol;
+
+typedef size_t(*codecKernel)(const uint8_t * source_, const size_t size_, uint8_t * destination_);
+
+static
+size_t
+decodeScalar (
+    const uint8_t * encoded_,
+    const size_t size_,
+    uint8_t * data_
+) {
+    for (size_t i = 0 ; i < size_ ; ++i) {
+        data_[i] = static_cast<uint8_t>((encoded_[(2 * i)] & 0x7F) | (encoded_[((2 * i) + 1)] << 7));
+    }
+    return size_;
+}
+
+static
+size_t
+encodeScalar (
+    const uint8_t * data_,
+    const size_t size_,
+    uint8_t * encoded_
+) {
+    for (size_t i = 0 ; i < size_ ; ++i) {
+        encoded_[(2 * i)] = (data_[i] & 0x7F);
+        encoded_[((2 * i) + 1)] = (data_[i] >> 7);
+    }
+    return (2 * size_);
+}
+
+#ifdef SEVEN_BIT_CODEC_X86
+
+// Each pair, loaded as a 16-bit lane (low byte first), is joined in place;
+// the high bit moves from bit 8 to bit 7, and the lanes are packed to bytes
+__attribute__((target("sse2")))
+static
+size_t
+decodeSse2 (
+    const uint8_t * encoded_,
+    const size_t size_,
+    uint8_t * data_
+) {
+    const __m128i low_bits = _mm_set1_epi16(0x007F);
+    const __m128i high_bit = _mm_set1_epi16(0x0080);
+    size_t i = 0;
+
+    for (; (i + 16) <= size_ ; i += 16) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(encoded_ + (2 * i)));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(encoded_ + (2 * i) + 16));
+        first = _mm_or_si128(_mm_and_si128(first, low_bits), _mm_and_si128(_mm_srli_epi16(first, 1), high_bit));
+        second = _mm_or_si128(_mm_and_si128(second, low_bits), _mm_and_si128(_mm_srli_epi16(second, 1), high_bit));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data_ + i), _mm_packus_epi16(first, second));
+    }
+    decodeScalar((encoded_ + (2 * i)), (size_ - i), (data_ + i));
+
+    return size_;
+}
+
+__attribute__((target("sse2")))
+static
+size_t
+encodeSse2 (
+    const uint8_t * data_,
+    const size_t size_,
+    uint8_t * encoded_
+) {
+    const __m128i low_bits = _mm_set1_epi8(0x7F);
+    const __m128i high_bit = _mm_set1_epi8(0x01);
+    size_t i = 0;
+
+    for (; (i + 16) <= size_ ; i += 16) {
+        const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data_ + i));
+        const __m128i low = _mm_and_si128(data, low_bits);
+        const __m128i high = _mm_and_si128(_mm_srli_epi16(data, 7), high_bit);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(encoded_ + (2 * i)), _mm_unpacklo_epi8(low, high));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(encoded_ + (2 * i) + 16), _mm_unpackhi_epi8(low, high));
+    }
+    encodeScalar((data_ + i), (size_ - i), (encoded_ + (2 * i)));
+
+    return (2 * size_);
+}
+
+// As SSE2, but AVX2 packs and unpacks within 128-bit lanes, so the halves
+// are reordered to keep the bytes in sequence
+__attribute__((target("avx2")))
+static
+size_t
+decodeAvx2 (
+    const uint8_t * encoded_,
+    const size_t size_,
+    uint8_t * data_
+) {
+    const __m256i low_bits = _mm256_set1_epi16(0x007F);
+    const __m256i high_bit = _mm256_set1_epi16(0x0080);
+    size_t i = 0;
+
+    for (; (i + 32) <= size_ ; i += 32) {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(encoded_ + (2 * i)));
+        __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(encoded_ + (2 * i) + 32));
+        first = _mm256_or_si256(_mm256_and_si256(first, low_bits), _mm256_and_si256(_mm256_srli_epi16(first, 1), high_bit));
+        second = _mm256_or_si256(_mm256_and_si256(second, low_bits), _mm256_and_si256(_mm256_srli_epi16(second, 1), high_bit));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(data_ + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xD8));
+    }
+    decodeSse2((encoded_ + (2 * i)), (size_ - i), (data_ + i));
+
+    return size_;
+}
+
+__attribute__((target("avx2")))
+static
+size_t
+encodeAvx2 (
+    const uint8_t * data_,
+    const size_t size_,
+    uint8_t * encoded_
+) {
+    const __m256i low_bits = _mm256_set1_epi8(0x7F);
+    const __m256i high_bit = _mm256_set1_epi8(0x01);
+    size_t i = 0;
+
+    for (; (i + 32) <= size_ ; i += 32) {
+        const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data_ + i));
+        const __m256i low = _mm256_and_si256(data, low_bits);
+        const __m256i high = _mm256_and_si256(_mm256_srli_epi16(data, 7), high_bit);
+        const __m256i pairs_low = _mm256_unpacklo_epi8(low, high);
+        const __m256i pairs_high = _mm256_unpackhi_epi8(low, high);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(encoded_ + (2 * i)), _mm256_permute2x128_si256(pairs_low, pairs_high, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(encoded_ + (2 * i) + 32), _mm256_permute2x128_si256(pairs_low, pairs_high, 0x31));
+    }
+    encodeSse2((data_ + i), (size_ - i), (encoded_ + (2 * i)));
+
+    return (2 * size_);
+}
+
+#endif // SEVEN_BIT_CODEC_X86
+
+#ifdef SEVEN_BIT_CODEC_NEON
+
+// NEON loads and stores interleaved pairs directly
+static
+size_t
+decodeNeon (
+    const uint8_t * encoded_,
+    const size_t size_,
+    uint8_t * data_
+) {
+    const uint8x16_t low_bits = vdupq_n_u8(0x7F);
+    size_t i = 0;
+
+    for (; (i + 16) <= size_ ; i += 16) {
+        const uint8x16x2_t pairs = vld2q_u8(encoded_ + (2 * i));
+        vst1q_u8((data_ + i), vorrq_u8(vandq_u8(pairs.val[0], low_bits), vshlq_n_u8(pairs.val[1], 7)));
+    }
+    decodeScalar((encoded_ + (2 * i)), (size_ - i), (data_ + i));
+
+    return size_;
+}
+
+static
+size_t
+encodeNeon (
+    const uint8_t * data_,
+    const size_t size_,
+    uint8_t * encoded_
+) {
+    const uint8x16_t low_bits = vdupq_n_u8(0x7F);
+    size_t i = 0;
+
+    for (; (i + 16) <= size_ ; i += 16) {
+        const uint8x16_t data = vld1q_u8(data_ + i);
+        uint8x16x2_t pairs;
+        pairs.val[0] = vandq_u8(data, low_bits);
+        pairs.val[1] = vshrq_n_u8(data, 7);
+        vst2q_u8((encoded_ + (2 * i)), pairs);
+    }
+    encodeScalar((data_ + i), (size_ - i), (encoded_ + (2 * i)));
+
+    return (2 * size_);
+}
+
+#endif // SEVEN_BIT_CODEC_NEON
+
+struct KernelTable {
+    codecKernel decode;
+    codecKernel encode;
+};
+
+// Kernels not built for this processor fall back to scalar (and are never
+// reported available)
+static const KernelTable KERNELS[SevenBitCodec::KERNEL_COUNT] = {
+    { decodeScalar, encodeScalar },
+#ifdef SEVEN_BIT_CODEC_X86
+    { decodeSse2, encodeSse2 },
+    { decodeAvx2, encodeAvx2 },
+#else
+    { decodeScalar, encodeScalar },
+    { decodeScalar, encodeScalar },
+#endif
+#ifdef SEVEN_BIT_CODEC_NEON
+    { decodeNeon, encodeNeon },
+#else
+    { decodeScalar, encodeScalar },
+#endif
+};
+
+static const char * const KERNEL_NAMES[SevenBitCodec::KERNEL_COUNT] = { "scalar", "sse2", "avx2", "neon" };
+
+static std::atomic<const KernelTable *> active_kernel(nullptr);
+
+static
+const KernelTable *
+activeKernel (
+    void
+) {
+    const KernelTable * kernel = active_kernel.load(std::memory_order_acquire);
+
+    // Select the fastest supported kernel on first use
+    if ( !kernel ) {
+        SevenBitCodec::Kernel fastest = SevenBitCodec::KERNEL_SCALAR;
+        for (int candidate = SevenBitCodec::KERNEL_SCALAR ; candidate < SevenBitCodec::KERNEL_COUNT ; ++candidate) {
+            if ( SevenBitCodec::kernelAvailable(static_cast<SevenBitCodec::Kernel>(candidate)) ) { fastest = static_cast<SevenBitCodec::Kernel>(candidate); }
+        }
+        kernel = &KERNELS[fastest];
+        active_kernel.store(kernel, std::memory_order_release);
+    }
+
+    return kernel;
+}
+
+size_t
+SevenBitCodec::decode (
+    const uint8_t * encoded_,
+    const size_t encoded_size_,
+    uint8_t * data_
+) {
+    return activeKernel()->decode(encoded_, (encoded_size_ / 2), data_);
+}
+
+size_t
+SevenBitCodec::encode (
+    const uint8_t * data_,
+    const size_t size_,
+    uint8_t * encoded_
+) {
+    return activeKernel()->encode(data_, size_, encoded_);
+}
+
+SevenBitCodec::Kernel
+SevenBitCodec::kernel (
+    void
+) {
+    return static_cast<Kernel>(activeKernel() - KERNELS);
+}
+
+bool
+SevenBitCodec::kernelAvailable (
+    const Kernel kernel_
+) {
+    switch (kernel_) {
+      case KERNEL_SCALAR: return true;
+#ifdef SEVEN_BIT_CODEC_X86
+      case KERNEL_SSE2: __builtin_cpu_init(); return __builtin_cpu_supports("sse2");
+      case KERNEL_AVX2: __builtin_cpu_init(); return __builtin_cpu_supports("avx2");
+#endif
+#ifdef SEVEN_BIT_CODEC_NEON
+      case KERNEL_NEON: return true;
+#endif
+      default: return false;
+    }
+}
+
+const char *
+SevenBitCodec::kernelName (
+    const Kernel kernel_
+) {
+    return ((kernel_ < KERNEL_COUNT) ? KERNEL_NAMES[kernel_] : "unknown");
+}
+
+int
+SevenBitCodec::useKernel (
+    const Kernel kernel_
+) {
+    if ( (kernel_ >= KERNEL_COUNT) || !kernelAvailable(kernel_) ) { return __LINE__; }
+    active_kernel.store(&KERNELS[kernel_], std::memory_order_release);
+
+    return 0;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
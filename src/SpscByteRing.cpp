@@ -0,0 +1,106 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "SpscByteRing.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace remote_wiring::protocol;
+
+SpscByteRing::SpscByteRing (
+    const size_t capacity_
+) :
+    _buffer(nullptr),
+    _mask(0),
+    _head(0),
+    _tail(0),
+    _high_water_mark(0),
+    _overruns(0)
+{
+    size_t capacity = 1;
+
+    while ( capacity < capacity_ ) { capacity <<= 1; }
+    _buffer = new uint8_t[capacity];
+    _mask = (capacity - 1);
+}
+
+SpscByteRing::~SpscByteRing (
+    void
+) {
+    delete[] _buffer;
+}
+
+size_t
+SpscByteRing::capacity (
+    void
+) const {
+    return (_mask + 1);
+}
+
+size_t
+SpscByteRing::highWaterMark (
+    void
+) const {
+    return _high_water_mark.load(std::memory_order_relaxed);
+}
+
+size_t
+SpscByteRing::overruns (
+    void
+) const {
+    return _overruns.load(std::memory_order_relaxed);
+}
+
+size_t
+SpscByteRing::pop (
+    uint8_t * data_,
+    const size_t max_size_
+) {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    const size_t tail = _tail.load(std::memory_order_acquire);
+    const size_t size = std::min((tail - head), max_size_);
+    const size_t offset = (head & _mask);
+    const size_t first = std::min(size, (capacity() - offset));
+
+    // Copy out in at most two spans, around the end of the buffer
+    ::memcpy(data_, (_buffer + offset), first);
+    ::memcpy((data_ + first), _buffer, (size - first));
+    _head.store((head + size), std::memory_order_release);
+
+    return size;
+}
+
+size_t
+SpscByteRing::push (
+    const uint8_t * data_,
+    const size_t size_
+) {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    const size_t head = _head.load(std::memory_order_acquire);
+    const size_t size = std::min(size_, (capacity() - (tail - head)));
+    const size_t offset = (tail & _mask);
+    const size_t first = std::min(size, (capacity() - offset));
+    const size_t occupancy = ((tail - head) + size);
+
+    // Copy in at most two spans, around the end of the buffer
+    ::memcpy((_buffer + offset), data_, first);
+    ::memcpy(_buffer, (data_ + first), (size - first));
+    _tail.store((tail + size), std::memory_order_release);
+
+    // Only the producer writes the statistics
+    if ( occupancy > _high_water_mark.load(std::memory_order_relaxed) ) { _high_water_mark.store(occupancy, std::memory_order_relaxed); }
+    if ( size < size_ ) { _overruns.fetch_add((size_ - size), std::memory_order_relaxed); }
+
+    return size;
+}
+
+size_t
+SpscByteRing::size (
+    void
+) const {
+    const size_t head = _head.load(std::memory_order_acquire);
+
+    return (_tail.load(std::memory_order_acquire) - head);
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
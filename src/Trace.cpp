@@ -0,0 +1,96 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "Trace.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+using namespace remote_wiring::protocol;
+
+static std::atomic<TraceSink *> trace_sink(&defaultTraceSink());
+
+TraceRingBuffer::TraceRingBuffer (
+    const size_t capacity_
+) :
+    _dropped(0),
+    _head(0),
+    _records(capacity_ ? capacity_ : 1),
+    _size(0)
+{
+}
+
+size_t
+TraceRingBuffer::dropped (
+    void
+) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _dropped;
+}
+
+size_t
+TraceRingBuffer::read (
+    Record * records_,
+    const size_t max_records_
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t count = 0;
+
+    for (; (count < max_records_) && _size ; ++count, --_size) {
+        records_[count] = _records[((_head + _records.size() - _size) % _records.size())];
+    }
+
+    return count;
+}
+
+void
+TraceRingBuffer::write (
+    const int level_,
+    const char * message_
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Record & record = _records[_head];
+
+    record.level = level_;
+    ::strncpy(record.message, message_, (MESSAGE_SIZE - 1));
+    record.message[(MESSAGE_SIZE - 1)] = '\0';
+
+    _head = ((_head + 1) % _records.size());
+    if ( _size < _records.size() ) { ++_size; } else { ++_dropped; }
+}
+
+TraceRingBuffer &
+remote_wiring::protocol::defaultTraceSink (
+    void
+) {
+    static TraceRingBuffer ring_buffer(256);
+    return ring_buffer;
+}
+
+void
+remote_wiring::protocol::setTraceSink (
+    TraceSink * sink_
+) {
+    trace_sink = sink_;
+}
+
+void
+remote_wiring::protocol::trace (
+    const int level_,
+    const char * format_,
+    ...
+) {
+    TraceSink * sink = trace_sink;
+    char message[TraceRingBuffer::MESSAGE_SIZE];
+    va_list args;
+
+    if ( !sink ) { return; }
+    va_start(args, format_);
+    ::vsnprintf(message, sizeof(message), format_, args);
+    va_end(args);
+
+    sink->write(level_, message);
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
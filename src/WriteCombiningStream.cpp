@@ -0,0 +1,292 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "WriteCombiningStream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <poll.h>
+
+#include "Trace.h"
+
+using namespace remote_wiring::protocol;
+
+// How long the flusher waits for a saturated descriptor before retrying
+static const int SATURATED_POLL_MS = 10;
+
+WriteCombiningStream::WriteCombiningStream (
+    FdStream & stream_,
+    const size_t flush_threshold_,
+    const duration flush_delay_,
+    const size_t capacity_
+) :
+    _backpressure_waits(0),
+    _buffer(new uint8_t[std::max(capacity_, static_cast<size_t>(1))]),
+    _buffer_capacity(std::max(capacity_, static_cast<size_t>(1))),
+    _buffer_head(0),
+    _buffer_tail(0),
+    _bytes_dropped(0),
+    _bytes_written(0),
+    _complete_tail(0),
+    _flush_delay(flush_delay_),
+    _flush_threshold(std::min(flush_threshold_, _buffer_capacity)),
+    _flusher_idle(false),
+    _messages_staged(0),
+    _running(true),
+    _saturated(false),
+    _stream(stream_),
+    _write_calls(0)
+{
+    for (size_t reason = 0 ; reason < FLUSH_REASON_COUNT ; ++reason) { _flushes[reason] = 0; }
+    _flusher = std::thread(&WriteCombiningStream::runFlusher, this);
+}
+
+WriteCombiningStream::~WriteCombiningStream (
+    void
+) {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+    _condition.notify_all();
+    _flusher.join();
+    delete[] _buffer;
+}
+
+size_t
+WriteCombiningStream::available (
+    void
+) {
+    return _stream.available();
+}
+
+uint64_t
+WriteCombiningStream::backpressureWaits (
+    void
+) const {
+    return _backpressure_waits.load(std::memory_order_relaxed);
+}
+
+void
+WriteCombiningStream::begin (
+    const size_t speed_,
+    const size_t config_
+) {
+    _stream.begin(speed_, config_);
+}
+
+uint64_t
+WriteCombiningStream::bytesDropped (
+    void
+) const {
+    return _bytes_dropped.load(std::memory_order_relaxed);
+}
+
+uint64_t
+WriteCombiningStream::bytesWritten (
+    void
+) const {
+    return _bytes_written.load(std::memory_order_relaxed);
+}
+
+void
+WriteCombiningStream::discard (
+    void
+) {
+    const size_t bytes_dropped = (_buffer_tail - _buffer_head);
+
+    _bytes_dropped.fetch_add(bytes_dropped, std::memory_order_relaxed);
+    _buffer_head = _buffer_tail = _complete_tail = 0;
+    _saturated = false;
+    _condition.notify_all();
+    PROTOCOL_TRACE_ERROR("WriteCombiningStream::discard - Link failed: %u staged bytes dropped", static_cast<unsigned int>(bytes_dropped));
+}
+
+bool
+WriteCombiningStream::drain (
+    const size_t until_
+) {
+    while ( _buffer_head < until_ ) {
+        const size_t requested = (until_ - _buffer_head);
+        const ssize_t bytes_written = _stream.write((_buffer + _buffer_head), requested);
+
+        _write_calls.fetch_add(1, std::memory_order_relaxed);
+        if ( bytes_written < 0 ) {
+            discard();
+            return false;
+        }
+        _bytes_written.fetch_add(bytes_written, std::memory_order_relaxed);
+        _buffer_head += bytes_written;
+
+        // The link is saturated; leave the rest to the flusher
+        if ( static_cast<size_t>(bytes_written) < requested ) {
+            _saturated = true;
+            _complete_tail = std::max(_complete_tail, _buffer_head);
+            _condition.notify_all();
+            return false;
+        }
+    }
+
+    _saturated = false;
+    _complete_tail = std::max(_complete_tail, _buffer_head);
+    if ( _buffer_head == _buffer_tail ) {
+        _buffer_head = _buffer_tail = _complete_tail = 0;
+    } else {
+        _deadline = (std::chrono::steady_clock::now() + _flush_delay);
+    }
+    _condition.notify_all();
+
+    return true;
+}
+
+void
+WriteCombiningStream::end (
+    void
+) {
+    flush();
+    _stream.end();
+}
+
+void
+WriteCombiningStream::flush (
+    void
+) {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if ( _buffer_head != _buffer_tail ) {
+            _flushes[FLUSH_EXPLICIT].fetch_add(1, std::memory_order_relaxed);
+            (void)drain(_buffer_tail);
+        }
+
+        // A saturated link is drained by the flusher
+        _condition.wait(lock, [this]() { return ((_buffer_head == _buffer_tail) || !_running); });
+    }
+    _stream.flush();
+}
+
+uint64_t
+WriteCombiningStream::flushes (
+    const FlushReason reason_
+) const {
+    return ((reason_ < FLUSH_REASON_COUNT) ? _flushes[reason_].load(std::memory_order_relaxed) : 0);
+}
+
+uint64_t
+WriteCombiningStream::messagesStaged (
+    void
+) const {
+    return _messages_staged.load(std::memory_order_relaxed);
+}
+
+int
+WriteCombiningStream::peek (
+    void
+) {
+    return _stream.peek();
+}
+
+int
+WriteCombiningStream::read (
+    void
+) {
+    return _stream.read();
+}
+
+void
+WriteCombiningStream::registerSerialEventCallback (
+    serialEvent upon_read_,
+    void * context_
+) {
+    _stream.registerSerialEventCallback(upon_read_, context_);
+}
+
+void
+WriteCombiningStream::runFlusher (
+    void
+) {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while ( _running ) {
+        if ( _buffer_head == _buffer_tail ) {
+            _flusher_idle = true;
+            _condition.wait(lock);
+            _flusher_idle = false;
+        } else if ( _saturated ) {
+            pollfd descriptor = { _stream.fd(), POLLOUT, 0 };
+            lock.unlock();
+            const int ready = ::poll(&descriptor, 1, SATURATED_POLL_MS);
+            lock.lock();
+            if ( !_saturated ) { continue; }
+            if ( (ready > 0) && (descriptor.revents & (POLLERR | POLLHUP | POLLNVAL)) ) {
+                discard();
+            } else {
+                (void)drain(_buffer_tail);
+            }
+        } else if ( std::chrono::steady_clock::now() >= _deadline ) {
+            _flushes[FLUSH_DEADLINE].fetch_add(1, std::memory_order_relaxed);
+            (void)drain(_buffer_tail);
+        } else {
+            _condition.wait_until(lock, _deadline);
+        }
+    }
+}
+
+size_t
+WriteCombiningStream::write (
+    uint8_t byte_
+) {
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    // Make room, reclaiming written bytes first, then waiting on the link
+    while ( _buffer_tail == _buffer_capacity ) {
+        if ( _buffer_head ) {
+            std::memmove(_buffer, (_buffer + _buffer_head), (_buffer_tail - _buffer_head));
+            _buffer_tail -= _buffer_head;
+            _complete_tail -= _buffer_head;
+            _buffer_head = 0;
+        } else if ( !_running ) {
+            return 0;
+        } else {
+            _backpressure_waits.fetch_add(1, std::memory_order_relaxed);
+            if ( !_saturated ) {
+                _flushes[FLUSH_THRESHOLD].fetch_add(1, std::memory_order_relaxed);
+                (void)drain(_buffer_tail);
+            }
+            if ( _buffer_tail == _buffer_capacity && !_buffer_head ) { _condition.wait(lock); }
+        }
+    }
+
+    // Start the clock on the oldest staged byte
+    if ( _buffer_head == _buffer_tail ) {
+        _deadline = (std::chrono::steady_clock::now() + _flush_delay);
+        if ( _flusher_idle ) { _condition.notify_all(); }
+    }
+    _buffer[_buffer_tail++] = byte_;
+
+    // Track the end of the last complete message
+    const unsigned boundary = _framer.push(byte_);
+    if ( boundary & MessageFramer::MESSAGE_BEGINS ) { _complete_tail = (_buffer_tail - 1); }
+    if ( boundary & MessageFramer::MESSAGE_ENDS ) {
+        _complete_tail = _buffer_tail;
+        _messages_staged.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Write whole messages once enough have gathered
+    if ( !_saturated && ((_complete_tail - _buffer_head) >= _flush_threshold) ) {
+        _flushes[FLUSH_THRESHOLD].fetch_add(1, std::memory_order_relaxed);
+        (void)drain(_complete_tail);
+    }
+
+    return 1;
+}
+
+uint64_t
+WriteCombiningStream::writeCalls (
+    void
+) const {
+    return _write_calls.load(std::memory_order_relaxed);
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,146 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <new>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "BufferPool.h"
+#include "DeviceContract.h"
+#include "FirmataBoards.h"
+#include "FirmataConstants.h"
+#include "FirmataQuery.h"
+#include "FirmataResponder.h"
+#include "LoopbackStream.h"
+
+using namespace remote_wiring::protocol;
+
+// Count every global allocation made while counting is enabled (the
+// replacements pair `malloc` with `free`, which GCC cannot see through)
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 11)
+  #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic_bool counting(false);
+static std::atomic<size_t> allocations(0);
+
+void *
+operator new (
+    size_t size_
+) {
+    if ( counting.load(std::memory_order_relaxed) ) { allocations.fetch_add(1, std::memory_order_relaxed); }
+    if ( void * const buffer = std::malloc(size_ ? size_ : 1) ) { return buffer; }
+    throw std::bad_alloc();
+}
+
+void
+operator delete (
+    void * buffer_
+) noexcept {
+    std::free(buffer_);
+}
+
+void
+operator delete (
+    void * buffer_,
+    size_t size_
+) noexcept {
+    (void)size_;
+    ::operator delete(buffer_);
+}
+
+/*!
+ * \brief Plays a fixed script of device traffic, without allocating
+ */
+class ScriptedStream : public Stream {
+  public:
+    ScriptedStream (
+        const std::vector<uint8_t> & script_
+    ) :
+        _context(nullptr),
+        _position(0),
+        _script(script_),
+        _upon_read(nullptr)
+    {
+    }
+
+    size_t available (void) override { return (_script.size() - _position); }
+    void begin (const size_t, const size_t) override {}
+    void end (void) override {}
+    void flush (void) override {}
+    int peek (void) override { return (available() ? _script[_position] : -1); }
+    int read (void) override { return (available() ? _script[_position++] : -1); }
+    void registerSerialEventCallback (serialEvent upon_read_, void * context_) override { _upon_read = upon_read_; _context = context_; }
+    size_t write (uint8_t) override { return 1; }
+
+    /*!
+     * \brief Rewind the script, and raise a serial event for all of it
+     */
+    void
+    deliver (
+        void
+    ) {
+        _position = 0;
+        if ( _upon_read ) { _upon_read(_context); }
+    }
+
+  private:
+    void * _context;
+    size_t _position;
+    const std::vector<uint8_t> & _script;
+    serialEvent _upon_read;
+};
+
+// The traffic of a Mega answering the contract queries, from boot
+static std::vector<uint8_t>
+megaScript (
+    void
+) {
+    const uint8_t queries[] = {
+        firmata::START_SYSEX, firmata::CAPABILITY_QUERY, firmata::END_SYSEX,
+        firmata::START_SYSEX, firmata::ANALOG_MAPPING_QUERY, firmata::END_SYSEX,
+    };
+    LoopbackStream stream;
+    FirmataResponder responder(stream, ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT);
+    std::vector<uint8_t> script;
+
+    responder.begin();
+    for (size_t i = 0 ; i < sizeof(queries) ; ++i) { stream.write(queries[i]); }
+    for (int byte ; (byte = stream.read()) >= 0 ; ) { script.push_back(static_cast<uint8_t>(byte)); }
+
+    return script;
+}
+
+TEST(AllocationTest, RepeatedQueriesDoNotAllocateAfterWarmUp) {
+    static const size_t WARM_UP_QUERIES = 4;
+    static const size_t QUERIES = 100;
+    const std::vector<uint8_t> script(megaScript());
+    BufferPool pool;
+    ScriptedStream stream(script);  // Outlives the query, which detaches from it on destruction
+    FirmataQuery query;
+    size_t contracts = 0;
+
+    ASSERT_EQ(0, query.setAllocator(pool));
+    for (size_t i = 0 ; i < (WARM_UP_QUERIES + QUERIES) ; ++i) {
+        const size_t heap_allocations = pool.heapAllocations();
+
+        if ( WARM_UP_QUERIES == i ) { counting = true; }
+        ASSERT_EQ(0, query.queryContractAsync(&stream, nullptr, nullptr));
+        stream.deliver();
+        ASSERT_EQ(std::future_status::ready, query.contractReadyFuture().wait_for(std::chrono::seconds(0)));
+        DeviceContract * contract = query.detachDeviceContract();
+        ASSERT_NE(nullptr, contract);
+        contracts += (ArduinoMega::PIN_COUNT == contract->pinCount());
+        delete contract;
+        if ( i >= WARM_UP_QUERIES ) { ASSERT_EQ(heap_allocations, pool.heapAllocations()) << "query " << i; }
+    }
+    counting = false;
+
+    EXPECT_EQ((WARM_UP_QUERIES + QUERIES), contracts);
+    EXPECT_EQ(0u, allocations.load()) << "global allocations after warm-up";
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,149 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <chrono>
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "AnalogSampler.h"
+#include "FirmataBoards.h"
+#include "FirmataConstants.h"
+#include "StaticFirmataContract.h"
+
+using namespace remote_wiring::protocol;
+
+/*!
+ * \brief A board whose analog inputs report on channels 0 and 3, and one
+ *        analog input without a channel
+ */
+struct SparseAnalogBoard {
+    static constexpr size_t PIN_COUNT = 4;
+    static constexpr PinConfig PIN_CONFIG[PIN_COUNT] = {
+        boards::digitalPin(), boards::analogPin(0), boards::analogPin(NO_ANALOG_CHANNEL), boards::analogPin(3)
+    };
+};
+constexpr size_t SparseAnalogBoard::PIN_COUNT;
+constexpr PinConfig SparseAnalogBoard::PIN_CONFIG[];
+
+static const size_t CHANNEL_0_PIN = 1;
+static const size_t UNMAPPED_PIN = 2;
+static const size_t CHANNEL_3_PIN = 3;
+
+class AnalogSamplerTest : public ::testing::Test {
+  protected:
+    StaticFirmataContractAdapter<SparseAnalogBoard> _contract;
+    std::chrono::steady_clock::time_point _now;
+
+    AnalogSamplerTest (void) :
+        _now(std::chrono::steady_clock::now())
+    {}
+
+    // Ingest one ANALOG_MESSAGE
+    void report (AnalogSampler & sampler_, const uint8_t channel_, const uint16_t value_) {
+        const uint8_t frame[] = { static_cast<uint8_t>(firmata::ANALOG_MESSAGE | channel_), static_cast<uint8_t>(value_ & 0x7F), static_cast<uint8_t>((value_ >> 7) & 0x7F) };
+        sampler_.ingest(frame, sizeof(frame), _now);
+    }
+};
+
+TEST_F(AnalogSamplerTest, SamplesOnlyPinsWithAKnownChannel) {
+    AnalogSampler sampler(_contract, 4);
+    const AnalogSample * samples = nullptr;
+
+    EXPECT_EQ(2u, sampler.pins().count());
+    EXPECT_TRUE(sampler.pins().contains(CHANNEL_0_PIN));
+    EXPECT_FALSE(sampler.pins().contains(UNMAPPED_PIN));
+    EXPECT_TRUE(sampler.pins().contains(CHANNEL_3_PIN));
+
+    // Channels without a sampled pin are ignored, rather than dropped
+    report(sampler, 2, 100);
+    report(sampler, 15, 100);
+    EXPECT_EQ(0u, sampler.backlog());
+    EXPECT_EQ(0u, sampler.samplesDropped());
+    EXPECT_EQ(0u, sampler.peek(UNMAPPED_PIN, &samples));
+}
+
+TEST_F(AnalogSamplerTest, DecodesAFrameSpanningChunks) {
+    AnalogSampler sampler(_contract, 4);
+    const std::chrono::steady_clock::time_point later = (_now + std::chrono::milliseconds(5));
+    const uint8_t status = (firmata::ANALOG_MESSAGE | 0x03);
+    const uint8_t lsb = 0x05;
+    const uint8_t msb = 0x07;
+    const AnalogSample * samples = nullptr;
+
+    sampler.ingest(&status, 1, _now);
+    sampler.ingest(&lsb, 1, _now);
+    EXPECT_EQ(0u, sampler.peek(CHANNEL_3_PIN, &samples));
+    sampler.ingest(&msb, 1, later);
+
+    ASSERT_EQ(1u, sampler.peek(CHANNEL_3_PIN, &samples));
+    EXPECT_EQ((0x05 | (0x07 << 7)), samples[0].value);
+    EXPECT_TRUE(later == samples[0].received_at);
+    EXPECT_EQ(0u, sampler.peek(CHANNEL_0_PIN, &samples));
+}
+
+TEST_F(AnalogSamplerTest, AStatusByteAbandonsTheFrameInProgress) {
+    AnalogSampler sampler(_contract, 4);
+    const uint8_t bytes[] = {
+        static_cast<uint8_t>(firmata::ANALOG_MESSAGE | 0x00), 0x11,  // Cut short by...
+        firmata::REPORT_VERSION, 0x02, 0x05,                          // ...a frame of another kind
+        static_cast<uint8_t>(firmata::ANALOG_MESSAGE | 0x00), 0x22,  // Cut short by...
+        static_cast<uint8_t>(firmata::ANALOG_MESSAGE | 0x03), 0x33, 0x01,
+    };
+    const AnalogSample * samples = nullptr;
+
+    sampler.ingest(bytes, sizeof(bytes), _now);
+
+    EXPECT_EQ(0u, sampler.peek(CHANNEL_0_PIN, &samples));
+    ASSERT_EQ(1u, sampler.peek(CHANNEL_3_PIN, &samples));
+    EXPECT_EQ((0x33 | (0x01 << 7)), samples[0].value);
+}
+
+TEST_F(AnalogSamplerTest, PeekStopsAtTheEndOfTheRing) {
+    AnalogSampler sampler(_contract, 3);
+    const AnalogSample * samples = nullptr;
+
+    ASSERT_EQ(4u, sampler.samplesPerPin());
+    for (uint16_t value = 0 ; value < 3 ; ++value) { report(sampler, 0, value); }
+    ASSERT_EQ(3u, sampler.peek(CHANNEL_0_PIN, &samples));
+    sampler.release(CHANNEL_0_PIN, 3);
+
+    // The next three samples occupy the last slot, then wrap to the first two
+    for (uint16_t value = 3 ; value < 6 ; ++value) { report(sampler, 0, value); }
+    EXPECT_EQ(3u, sampler.backlog());
+    ASSERT_EQ(1u, sampler.peek(CHANNEL_0_PIN, &samples));
+    EXPECT_EQ(3u, samples[0].value);
+    sampler.release(CHANNEL_0_PIN, 1);
+    ASSERT_EQ(2u, sampler.peek(CHANNEL_0_PIN, &samples));
+    EXPECT_EQ(4u, samples[0].value);
+    EXPECT_EQ(5u, samples[1].value);
+    sampler.release(CHANNEL_0_PIN, 2);
+    EXPECT_EQ(0u, sampler.peek(CHANNEL_0_PIN, &samples));
+    EXPECT_EQ(0u, sampler.backlog());
+}
+
+TEST_F(AnalogSamplerTest, CountsTheSamplesDroppedByAFullRing) {
+    AnalogSampler sampler(_contract, 4);
+    const AnalogSample * samples = nullptr;
+
+    for (uint16_t value = 0 ; value < 7 ; ++value) { report(sampler, 3, value); }
+    report(sampler, 0, 42);
+
+    // The oldest samples are kept, and the rest counted against the pin
+    EXPECT_EQ(3u, sampler.samplesDropped(CHANNEL_3_PIN));
+    EXPECT_EQ(0u, sampler.samplesDropped(CHANNEL_0_PIN));
+    EXPECT_EQ(3u, sampler.samplesDropped());
+    EXPECT_EQ(4u, sampler.backlog());
+    ASSERT_EQ(4u, sampler.peek(CHANNEL_3_PIN, &samples));
+    for (uint16_t i = 0 ; i < 4 ; ++i) { EXPECT_EQ(i, samples[i].value); }
+
+    // Room made by the consumer is filled again
+    sampler.release(CHANNEL_3_PIN, 1);
+    report(sampler, 3, 99);
+    EXPECT_EQ(3u, sampler.samplesDropped(CHANNEL_3_PIN));
+    ASSERT_EQ(3u, sampler.peek(CHANNEL_3_PIN, &samples));
+    sampler.release(CHANNEL_3_PIN, 3);
+    ASSERT_EQ(1u, sampler.peek(CHANNEL_3_PIN, &samples));
+    EXPECT_EQ(99u, samples[0].value);
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
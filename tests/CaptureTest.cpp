@@ -0,0 +1,230 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "CaptureRecorder.h"
+#include "CaptureReplayer.h"
+#include "CaptureStream.h"
+#include "LoopbackStream.h"
+
+using namespace remote_wiring::protocol;
+
+class CaptureTest : public ::testing::Test {
+  protected:
+    std::string _path;
+
+    void SetUp (void) override {
+        _path = ("/tmp/CaptureTest." + std::to_string(::getpid()) + ".cap");
+        ::remove(_path.c_str());
+    }
+
+    void TearDown (void) override {
+        ::remove(_path.c_str());
+    }
+
+    // Overwrite the capture file with raw bytes
+    void writeFile (const std::vector<uint8_t> & bytes_) {
+        FILE * file = ::fopen(_path.c_str(), "wb");
+        ASSERT_NE(nullptr, file);
+        ASSERT_EQ(bytes_.size(), ::fwrite(bytes_.data(), 1, bytes_.size(), file));
+        ASSERT_EQ(0, ::fclose(file));
+    }
+
+    std::vector<uint8_t> readFile (void) {
+        std::vector<uint8_t> bytes;
+        FILE * file = ::fopen(_path.c_str(), "rb");
+        if ( !file ) { return bytes; }
+        for (int byte ; EOF != (byte = ::fgetc(file)) ; ) { bytes.push_back(static_cast<uint8_t>(byte)); }
+        ::fclose(file);
+        return bytes;
+    }
+};
+
+static void
+gather (
+    void * context_,
+    const uint8_t * data_,
+    size_t size_
+) {
+    std::vector<uint8_t> * received = reinterpret_cast<std::vector<uint8_t> *>(context_);
+    received->insert(received->end(), data_, (data_ + size_));
+}
+
+static void
+drain (
+    void * context_
+) {
+    Stream * stream = reinterpret_cast<Stream *>(context_);
+    while ( stream->available() ) { (void)stream->read(); }
+}
+
+TEST_F(CaptureTest, ReplaysTheBytesEachStreamReceived) {
+    const uint8_t board_a[] = { 0xF9, 0x02, 0x05 };
+    const uint8_t board_b[] = { 0xE0, 0x7F, 0x01, 0xE1, 0x00, 0x02 };
+    const uint8_t sent[] = { 0xF0, 0x6B, 0xF7 };
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    CaptureRecorder recorder;
+    CaptureReplayer replayer;
+    std::vector<uint8_t> received;
+
+    ASSERT_EQ(0, recorder.open(_path.c_str()));
+    ASSERT_EQ(0, recorder.record(0, CAPTURE_TX, sent, sizeof(sent), now));
+    ASSERT_EQ(0, recorder.record(0, CAPTURE_RX, board_a, sizeof(board_a), now));
+    ASSERT_EQ(0, recorder.record(1, CAPTURE_RX, board_b, sizeof(board_b), now));
+    ASSERT_EQ(0, recorder.record(0, CAPTURE_RX, board_a, 1, now));
+    ASSERT_EQ(0, recorder.close());
+    EXPECT_EQ((sizeof(sent) + sizeof(board_a) + sizeof(board_b) + 1), recorder.bytesRecorded());
+    EXPECT_EQ(0u, recorder.recordsDropped());
+
+    ASSERT_EQ(0, replayer.open(_path.c_str()));
+    ASSERT_NE(nullptr, replayer.header());
+    EXPECT_EQ(CAPTURE_VERSION, replayer.header()->version);
+
+    // Only the bytes stream 0 received, in the order they arrived
+    ASSERT_EQ(0, replayer.replay(0, gather, &received));
+    const std::vector<uint8_t> expected = { 0xF9, 0x02, 0x05, 0xF9 };
+    EXPECT_TRUE(expected == received);
+
+    received.clear();
+    ASSERT_EQ(0, replayer.replay(1, gather, &received));
+    EXPECT_TRUE(std::vector<uint8_t>(board_b, (board_b + sizeof(board_b))) == received);
+}
+
+TEST_F(CaptureTest, RecordsTheTrafficThroughACaptureStream) {
+    const uint8_t reply[] = { 0xF9, 0x02, 0x05 };
+    LoopbackStream loopback;
+    CaptureRecorder recorder;
+    CaptureReplayer replayer;
+    std::vector<uint8_t> received;
+    size_t records = 0;
+
+    ASSERT_EQ(0, recorder.open(_path.c_str()));
+    {
+        CaptureStream stream(loopback, recorder, 7);
+        stream.registerSerialEventCallback(drain, &stream);
+        stream.write(0xF9);
+        loopback.inject(reply, sizeof(reply));
+        loopback.pump();
+        stream.end();
+    }
+    ASSERT_EQ(0, recorder.close());
+
+    ASSERT_EQ(0, replayer.open(_path.c_str()));
+    for (const CaptureRecord * record = replayer.first() ; record ; record = replayer.next(record)) {
+        EXPECT_EQ(7u, record->stream_id);
+        EXPECT_EQ((records ? CAPTURE_RX : CAPTURE_TX), record->direction);
+        ++records;
+    }
+    EXPECT_EQ(2u, records);
+    ASSERT_EQ(0, replayer.replay(7, gather, &received));
+    EXPECT_TRUE(std::vector<uint8_t>(reply, (reply + sizeof(reply))) == received);
+}
+
+TEST_F(CaptureTest, SplitsARecordLargerThanTheBuffer) {
+    static const size_t BUFFER_SIZE = 64;
+    std::vector<uint8_t> payload(200);
+    CaptureRecorder recorder(BUFFER_SIZE);
+    CaptureReplayer replayer;
+    std::vector<uint8_t> received;
+    size_t records = 0;
+
+    for (size_t i = 0 ; i < payload.size() ; ++i) { payload[i] = static_cast<uint8_t>(i); }
+    ASSERT_EQ(0, recorder.open(_path.c_str()));
+    ASSERT_EQ(0, recorder.record(3, CAPTURE_RX, payload.data(), payload.size(), std::chrono::steady_clock::now()));
+    ASSERT_EQ(0, recorder.close());
+
+    ASSERT_EQ(0, replayer.open(_path.c_str()));
+    for (const CaptureRecord * record = replayer.first() ; record ; record = replayer.next(record)) {
+        EXPECT_GE((BUFFER_SIZE - sizeof(CaptureRecord)), record->size);
+        EXPECT_LT(0u, record->size);
+        EXPECT_EQ(0u, (reinterpret_cast<uintptr_t>(record) % 8));
+        ++records;
+    }
+    EXPECT_LT(1u, records);
+    ASSERT_EQ(0, replayer.replay(3, gather, &received));
+    EXPECT_TRUE(payload == received);
+}
+
+TEST_F(CaptureTest, ACaptureCutShortEndsAtItsLastCompleteRecord) {
+    const uint8_t first[] = { 0x90, 0x01, 0x00 };
+    const uint8_t second[] = { 0xF0, 0x6C, 0x7F, 0x7F, 0xF7 };
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    CaptureRecorder recorder;
+    CaptureReplayer replayer;
+    std::vector<uint8_t> received;
+
+    ASSERT_EQ(0, recorder.open(_path.c_str()));
+    ASSERT_EQ(0, recorder.record(0, CAPTURE_RX, first, sizeof(first), now));
+    ASSERT_EQ(0, recorder.record(0, CAPTURE_RX, second, sizeof(second), now));
+    ASSERT_EQ(0, recorder.close());
+
+    // Cut the second record short, mid-payload
+    std::vector<uint8_t> bytes = readFile();
+    ASSERT_EQ((sizeof(CaptureFileHeader) + captureRecordSpan(sizeof(first)) + captureRecordSpan(sizeof(second))), bytes.size());
+    bytes.resize(sizeof(CaptureFileHeader) + captureRecordSpan(sizeof(first)) + sizeof(CaptureRecord) + 2);
+    writeFile(bytes);
+
+    ASSERT_EQ(0, replayer.open(_path.c_str()));
+    ASSERT_EQ(0, replayer.replay(0, gather, &received));
+    EXPECT_TRUE(std::vector<uint8_t>(first, (first + sizeof(first))) == received);
+
+    // A record header cut short ends the capture as well
+    replayer.close();
+    bytes.resize(sizeof(CaptureFileHeader) + captureRecordSpan(sizeof(first)) + 4);
+    writeFile(bytes);
+    received.clear();
+    ASSERT_EQ(0, replayer.open(_path.c_str()));
+    ASSERT_EQ(0, replayer.replay(0, gather, &received));
+    EXPECT_TRUE(std::vector<uint8_t>(first, (first + sizeof(first))) == received);
+}
+
+TEST_F(CaptureTest, RejectsAnInvalidHeader) {
+    CaptureRecorder recorder;
+    CaptureReplayer replayer;
+
+    ASSERT_EQ(0, recorder.open(_path.c_str()));
+    ASSERT_EQ(0, recorder.close());
+    const std::vector<uint8_t> valid = readFile();
+    ASSERT_EQ(sizeof(CaptureFileHeader), valid.size());
+    ASSERT_EQ(0, replayer.open(_path.c_str()));
+    EXPECT_EQ(nullptr, replayer.first());
+    replayer.close();
+
+    // Wrong magic
+    std::vector<uint8_t> bytes = valid;
+    bytes[0] = 'X';
+    writeFile(bytes);
+    EXPECT_NE(0, replayer.open(_path.c_str()));
+    EXPECT_EQ(nullptr, replayer.header());
+
+    // A header size that would misalign the records
+    CaptureFileHeader header;
+    std::memcpy(&header, valid.data(), sizeof(header));
+    header.header_size = (sizeof(CaptureFileHeader) + 4);
+    bytes.assign(reinterpret_cast<const uint8_t *>(&header), (reinterpret_cast<const uint8_t *>(&header) + sizeof(header)));
+    bytes.resize(bytes.size() + 8);
+    writeFile(bytes);
+    EXPECT_NE(0, replayer.open(_path.c_str()));
+
+    // A header size beyond the end of the file
+    header.header_size = (sizeof(CaptureFileHeader) + 64);
+    bytes.assign(reinterpret_cast<const uint8_t *>(&header), (reinterpret_cast<const uint8_t *>(&header) + sizeof(header)));
+    writeFile(bytes);
+    EXPECT_NE(0, replayer.open(_path.c_str()));
+
+    // Too short to hold a header
+    bytes.resize(sizeof(CaptureFileHeader) - 1);
+    writeFile(bytes);
+    EXPECT_NE(0, replayer.open(_path.c_str()));
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
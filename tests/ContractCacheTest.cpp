@@ -0,0 +1,93 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "ContractCache.h"
+
+using namespace remote_wiring::protocol;
+
+class ContractCacheTest : public ::testing::Test {
+  protected:
+    std::string _path;
+
+    void SetUp (void) override {
+        _path = ("/tmp/ContractCacheTest." + std::to_string(::getpid()) + ".bin");
+        ::remove(_path.c_str());
+        ::remove((_path + ".lock").c_str());
+    }
+
+    void TearDown (void) override {
+        ::remove(_path.c_str());
+        ::remove((_path + ".lock").c_str());
+    }
+};
+
+TEST_F(ContractCacheTest, StoresAndReloadsEntries) {
+    pin_config_t uno[3] = { 1, 2, 3 };
+    pin_config_t mega[2] = { 9, 8 };
+    pin_config_t pin_data[4];
+    uint32_t fingerprint = 0;
+    ContractCache cache(_path.c_str());
+
+    ASSERT_EQ(0, cache.load());
+    EXPECT_EQ(0u, cache.lookup("StandardFirmata.ino", 2, 5, nullptr, 0, nullptr));
+    ASSERT_EQ(0, cache.store("StandardFirmata.ino", 2, 5, uno, 3));
+    ASSERT_EQ(0, cache.store("ConfigurableFirmata.ino", 2, 10, mega, 2));
+    ASSERT_EQ(0, cache.store("StandardFirmata.ino", 2, 5, mega, 2));
+
+    ContractCache reloaded(_path.c_str());
+    ASSERT_EQ(0, reloaded.load());
+    ASSERT_EQ(2u, reloaded.lookup("StandardFirmata.ino", 2, 5, pin_data, 4, &fingerprint));
+    EXPECT_EQ(mega[0], pin_data[0]);
+    EXPECT_EQ(mega[1], pin_data[1]);
+    EXPECT_EQ(ContractCache::fingerprint(mega, 2), fingerprint);
+    EXPECT_EQ(2u, reloaded.lookup("ConfigurableFirmata.ino", 2, 10, nullptr, 0, nullptr));
+}
+
+TEST_F(ContractCacheTest, RejectsVersionsItCannotStore) {
+    pin_config_t uno[3] = { 1, 2, 3 };
+    ContractCache cache(_path.c_str());
+
+    ASSERT_EQ(0, cache.load());
+    EXPECT_NE(0, cache.store("StandardFirmata.ino", 256, 5, uno, 3));
+    EXPECT_NE(0, cache.store("StandardFirmata.ino", 2, 261, uno, 3));
+    EXPECT_EQ(0u, cache.lookup("StandardFirmata.ino", 0, 5, nullptr, 0, nullptr));
+    EXPECT_EQ(0u, cache.lookup("StandardFirmata.ino", 2, 5, nullptr, 0, nullptr));
+    EXPECT_EQ(0, cache.store("StandardFirmata.ino", 255, 255, uno, 3));
+    EXPECT_EQ(3u, cache.lookup("StandardFirmata.ino", 255, 255, nullptr, 0, nullptr));
+}
+
+TEST_F(ContractCacheTest, ConcurrentWritersKeepEveryEntry) {
+    std::vector<std::thread> writers;
+
+    // Each process (here, each cache) writes its own temporary file
+    for (size_t writer = 0 ; writer < 4 ; ++writer) {
+        writers.emplace_back([this, writer]() {
+            ContractCache cache(_path.c_str());
+            std::vector<pin_config_t> pin_data((writer + 1), static_cast<pin_config_t>(writer));
+
+            for (size_t i = 0 ; i < 50 ; ++i) {
+                EXPECT_EQ(0, cache.store("StandardFirmata.ino", writer, (i % 4), pin_data.data(), pin_data.size()));
+            }
+        });
+    }
+    for (size_t writer = 0 ; writer < writers.size() ; ++writer) { writers[writer].join(); }
+
+    // Every entry stored by every writer survives
+    ContractCache cache(_path.c_str());
+    ASSERT_EQ(0, cache.load());
+    for (size_t writer = 0 ; writer < writers.size() ; ++writer) {
+        for (size_t minor = 0 ; minor < 4 ; ++minor) {
+            EXPECT_EQ((writer + 1), cache.lookup("StandardFirmata.ino", writer, minor, nullptr, 0, nullptr)) << "writer " << writer << ", minor " << minor;
+        }
+    }
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
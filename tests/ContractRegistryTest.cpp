@@ -0,0 +1,110 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "BufferAllocator.h"
+#include "ContractRegistry.h"
+#include "FirmataBoards.h"
+
+using namespace remote_wiring::protocol;
+
+/*!
+ * \brief Counts the allocations made through it
+ */
+class CountingAllocator : public BufferAllocator {
+  public:
+    size_t allocations = 0;
+
+    void * allocate (const size_t size_) override { ++allocations; return std::malloc(size_); }
+    void deallocate (void * buffer_, const size_t) override { std::free(buffer_); }
+};
+
+static std::vector<pin_config_t>
+encode (
+    const PinConfig * pin_config_,
+    const size_t pin_count_
+) {
+    std::vector<pin_config_t> pin_data(pin_count_);
+
+    for (size_t pin = 0 ; pin < pin_count_ ; ++pin) {
+        ConfigCodec codec;
+        codec.config = pin_config_[pin];
+        pin_data[pin] = codec.data;
+    }
+
+    return pin_data;
+}
+
+TEST(ContractRegistryTest, IdenticalTablesShareOneContract) {
+    ContractRegistry registry;
+    CountingAllocator allocator;
+    const std::vector<pin_config_t> uno = encode(ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT);
+    const std::vector<pin_config_t> mega = encode(ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT);
+
+    std::shared_ptr<const FirmataContract> first = registry.intern(uno.data(), uno.size(), allocator);
+    std::shared_ptr<const FirmataContract> second = registry.intern(uno.data(), uno.size(), allocator);
+    std::shared_ptr<const FirmataContract> other = registry.intern(mega.data(), mega.size(), allocator);
+
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, other);
+    EXPECT_EQ(first, second);
+    EXPECT_NE(first, other);
+    EXPECT_EQ(2u, registry.size());
+    EXPECT_EQ(2u, allocator.allocations) << "a table already interned must not be decoded again";
+}
+
+TEST(ContractRegistryTest, DifferingTablesAreNotShared) {
+    ContractRegistry registry;
+    std::vector<pin_config_t> uno = encode(ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT);
+    std::shared_ptr<const FirmataContract> stock = registry.intern(uno.data(), uno.size());
+    ConfigCodec codec;
+
+    // Drop PWM from pin 3
+    codec.data = uno[3];
+    ASSERT_TRUE(codec.config.supported_modes & ANALOG_WRITE);
+    codec.config.supported_modes &= ~ANALOG_WRITE;
+    uno[3] = codec.data;
+    std::shared_ptr<const FirmataContract> modified = registry.intern(uno.data(), uno.size());
+
+    ASSERT_NE(nullptr, modified);
+    EXPECT_NE(stock, modified);
+    EXPECT_TRUE(modified->describes(uno.data(), uno.size()));
+    EXPECT_FALSE(stock->describes(uno.data(), uno.size()));
+    EXPECT_FALSE(stock->describes(uno.data(), (uno.size() - 1)));
+}
+
+TEST(ContractRegistryTest, ContractsAreSharedOnlyWithinAnAllocator) {
+    ContractRegistry registry;
+    CountingAllocator first_allocator;
+    CountingAllocator second_allocator;
+    const std::vector<pin_config_t> uno = encode(ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT);
+
+    std::shared_ptr<const FirmataContract> first = registry.intern(uno.data(), uno.size(), first_allocator);
+    std::shared_ptr<const FirmataContract> second = registry.intern(uno.data(), uno.size(), second_allocator);
+    std::shared_ptr<const FirmataContract> again = registry.intern(uno.data(), uno.size(), second_allocator);
+
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(second, again);
+    EXPECT_EQ(1u, first_allocator.allocations);
+    EXPECT_EQ(1u, second_allocator.allocations);
+    EXPECT_EQ(2u, registry.size());
+}
+
+TEST(ContractRegistryTest, ReleasedContractsAreDecodedAgain) {
+    ContractRegistry registry;
+    CountingAllocator allocator;
+    const std::vector<pin_config_t> uno = encode(ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT);
+
+    registry.intern(uno.data(), uno.size(), allocator).reset();
+    EXPECT_EQ(0u, registry.size());
+    EXPECT_NE(nullptr, registry.intern(uno.data(), uno.size(), allocator));
+    EXPECT_EQ(2u, allocator.allocations);
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
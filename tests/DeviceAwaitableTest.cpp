@@ -0,0 +1,153 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+// Build with -std=c++20
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "DeviceContract.h"
+#include "FirmataBoards.h"
+#include "FirmataConstants.h"
+#include "FirmataQuery.h"
+#include "FirmataResponder.h"
+#include "LoopbackStream.h"
+#include "PinStateMirror.h"
+#include "StaticFirmataContract.h"
+
+#if defined(__cpp_impl_coroutine)
+
+using namespace remote_wiring::protocol;
+
+// A fire-and-forget coroutine, started eagerly
+struct Detached {
+    struct promise_type {
+        Detached get_return_object (void) { return Detached(); }
+        std::suspend_never initial_suspend (void) noexcept { return {}; }
+        std::suspend_never final_suspend (void) noexcept { return {}; }
+        void return_void (void) {}
+        void unhandled_exception (void) { std::terminate(); }
+    };
+};
+
+static Detached
+awaitContract (
+    FirmataQuery & query_,
+    LoopbackStream & stream_,
+    const std::chrono::steady_clock::duration timeout_,
+    std::promise<DeviceContract *> & result_
+) {
+    std::unique_ptr<DeviceContract> contract = co_await query_.contract(&stream_, timeout_);
+    result_.set_value(contract.release());
+}
+
+static Detached
+awaitPinState (
+    PinStateMirror & mirror_,
+    const size_t pin_,
+    const std::chrono::steady_clock::duration timeout_,
+    std::promise<PinStateReport> & result_
+) {
+    result_.set_value(co_await mirror_.pinState(pin_, timeout_));
+}
+
+static void
+ignoreReport (
+    void * context_,
+    size_t pin_
+) {
+    (void)context_;
+    (void)pin_;
+}
+
+TEST(DeviceAwaitableTest, ContractResumesWhenTheDeviceAnswers) {
+    LoopbackStream stream;
+    FirmataQuery query;
+    FirmataResponder responder(stream, ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT);
+    std::promise<DeviceContract *> result;
+    std::future<DeviceContract *> contract = result.get_future();
+
+    awaitContract(query, stream, std::chrono::seconds(10), result);
+    responder.begin();
+
+    ASSERT_EQ(std::future_status::ready, contract.wait_for(std::chrono::seconds(1)));
+    std::unique_ptr<DeviceContract> owned(contract.get());
+    ASSERT_NE(nullptr, owned);
+    EXPECT_EQ(ArduinoUno::PIN_COUNT, owned->pinCount());
+}
+
+TEST(DeviceAwaitableTest, ContractResumesWithAnErrorAtTheDeadline) {
+    LoopbackStream stream;
+    FirmataQuery query;
+    std::promise<DeviceContract *> result;
+    std::future<DeviceContract *> contract = result.get_future();
+
+    // Nothing answers on the stream
+    awaitContract(query, stream, std::chrono::milliseconds(20), result);
+
+    ASSERT_EQ(std::future_status::ready, contract.wait_for(std::chrono::seconds(1)));
+    EXPECT_EQ(nullptr, contract.get());
+    EXPECT_EQ(std::future_status::ready, query.contractReadyFuture().wait_for(std::chrono::seconds(0)));
+}
+
+TEST(DeviceAwaitableTest, ContractAnsweredAfterTheDeadlineIsIgnored) {
+    LoopbackStream stream;
+    FirmataQuery query;
+    std::promise<DeviceContract *> result;
+    std::future<DeviceContract *> contract = result.get_future();
+
+    awaitContract(query, stream, std::chrono::milliseconds(20), result);
+    ASSERT_EQ(std::future_status::ready, contract.wait_for(std::chrono::seconds(1)));
+    EXPECT_EQ(nullptr, contract.get());
+
+    // The withdrawn callback must not resume the finished coroutine
+    FirmataResponder responder(stream, ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT);
+    responder.begin();
+}
+
+TEST(DeviceAwaitableTest, PinStateResumesWithTheReport) {
+    StaticFirmataContractAdapter<ArduinoUno> contract;
+    PinStateMirror mirror(contract);
+    LoopbackStream stream;
+    std::promise<PinStateReport> result;
+    std::future<PinStateReport> report = result.get_future();
+    const uint8_t response[] = { 13, firmata::PIN_MODE_OUTPUT, 0x01 };
+
+    mirror.begin(stream);
+    awaitPinState(mirror, 13, std::chrono::seconds(10), result);
+    EXPECT_NE(0, mirror.queryPinState(13, ignoreReport, nullptr)) << "a second query of the pin awaits";
+    mirror.pinStateResponse(sizeof(response), response);
+
+    ASSERT_EQ(std::future_status::ready, report.wait_for(std::chrono::seconds(1)));
+    const PinStateReport pin_state = report.get();
+    EXPECT_EQ(firmata::PIN_MODE_OUTPUT, pin_state.mode);
+    EXPECT_EQ(1u, pin_state.state);
+}
+
+TEST(DeviceAwaitableTest, PinStateResumesWithUnknownModeAtTheDeadline) {
+    StaticFirmataContractAdapter<ArduinoUno> contract;
+    PinStateMirror mirror(contract);
+    LoopbackStream stream;
+    std::promise<PinStateReport> result;
+    std::future<PinStateReport> report = result.get_future();
+    const uint8_t response[] = { 13, firmata::PIN_MODE_OUTPUT, 0x01 };
+
+    mirror.begin(stream);
+    awaitPinState(mirror, 13, std::chrono::milliseconds(20), result);
+
+    ASSERT_EQ(std::future_status::ready, report.wait_for(std::chrono::seconds(1)));
+    EXPECT_EQ(static_cast<uint8_t>(PinStateMirror::UNKNOWN_MODE), report.get().mode);
+
+    // A late report is recorded, and the pin may be queried again
+    mirror.pinStateResponse(sizeof(response), response);
+    EXPECT_EQ(firmata::PIN_MODE_OUTPUT, mirror.cachedPinMode(13));
+    EXPECT_FALSE(mirror.cancelPinStateQuery(13, nullptr));
+}
+
+#endif // __cpp_impl_coroutine
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
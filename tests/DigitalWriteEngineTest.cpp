@@ -0,0 +1,124 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "DigitalWriteEngine.h"
+#include "FirmataBoards.h"
+#include "FirmataConstants.h"
+#include "LoopbackStream.h"
+#include "StaticFirmataContract.h"
+
+using namespace remote_wiring::protocol;
+
+static void
+record (
+    void * context_,
+    uint8_t byte_
+) {
+    reinterpret_cast<std::vector<uint8_t> *>(context_)->push_back(byte_);
+}
+
+class DigitalWriteEngineTest : public ::testing::Test {
+  protected:
+    StaticFirmataContractAdapter<ArduinoMega> _contract;
+    DigitalWriteEngine _engine;
+    LoopbackStream _stream;
+    std::vector<uint8_t> _written;
+
+    DigitalWriteEngineTest (void) :
+        _engine(_contract)
+    {
+        _stream.setWriteHandler(record, &_written);
+        _engine.begin(_stream);
+    }
+
+    // The DIGITAL_MESSAGE for a port
+    static std::vector<uint8_t> portMessage (const uint8_t port_, const uint8_t value_) {
+        return std::vector<uint8_t>{ static_cast<uint8_t>(firmata::DIGITAL_MESSAGE | port_), static_cast<uint8_t>(value_ & 0x7F), static_cast<uint8_t>(value_ >> 7) };
+    }
+};
+
+TEST_F(DigitalWriteEngineTest, FortyToggledOutputsCostFiveMessages) {
+    std::vector<uint8_t> expected;
+
+    for (size_t pin = 8 ; pin < 48 ; ++pin) { ASSERT_EQ(0, _engine.digitalWrite(pin, true)); }
+    EXPECT_EQ(5u, _engine.flush());
+    EXPECT_EQ(5u, _engine.messagesSent());
+
+    for (uint8_t port = 1 ; port <= 5 ; ++port) {
+        const std::vector<uint8_t> message = portMessage(port, 0xFF);
+        expected.insert(expected.end(), message.begin(), message.end());
+    }
+    EXPECT_TRUE(expected == _written);
+
+    // Toggling them back costs five more
+    _written.clear();
+    for (size_t pin = 8 ; pin < 48 ; ++pin) { ASSERT_EQ(0, _engine.digitalWrite(pin, false)); }
+    EXPECT_EQ(5u, _engine.flush());
+    EXPECT_EQ(15u, _written.size());
+    EXPECT_TRUE(portMessage(1, 0x00) == std::vector<uint8_t>(_written.begin(), (_written.begin() + 3)));
+}
+
+TEST_F(DigitalWriteEngineTest, SendsOnlyThePinsOfEachPort) {
+    ASSERT_EQ(0, _engine.digitalWrite(2, true));
+    ASSERT_EQ(0, _engine.digitalWrite(7, true));
+    ASSERT_EQ(0, _engine.digitalWrite(13, true));
+    EXPECT_EQ(2u, _engine.flush());
+
+    std::vector<uint8_t> expected = portMessage(0, 0x84);
+    const std::vector<uint8_t> port_1 = portMessage(1, 0x20);
+    expected.insert(expected.end(), port_1.begin(), port_1.end());
+    EXPECT_TRUE(expected == _written);
+}
+
+TEST_F(DigitalWriteEngineTest, DropsWritesThatChangeNothing) {
+    // Outputs start low
+    ASSERT_EQ(0, _engine.digitalWrite(13, false));
+    EXPECT_EQ(1u, _engine.writesDropped());
+    EXPECT_EQ(0u, _engine.flush());
+
+    ASSERT_EQ(0, _engine.digitalWrite(13, true));
+    ASSERT_EQ(0, _engine.digitalWrite(13, true));
+    EXPECT_EQ(2u, _engine.writesDropped());
+    EXPECT_EQ(1u, _engine.flush());
+    EXPECT_EQ(3u, _written.size());
+
+    // A level already sent is not sent again
+    _written.clear();
+    ASSERT_EQ(0, _engine.digitalWrite(13, true));
+    EXPECT_EQ(3u, _engine.writesDropped());
+    EXPECT_EQ(0u, _engine.flush());
+    EXPECT_TRUE(_written.empty());
+}
+
+TEST_F(DigitalWriteEngineTest, APortToggledBackIsClean) {
+    ASSERT_EQ(0, _engine.digitalWrite(20, true));
+    ASSERT_EQ(0, _engine.digitalWrite(20, false));
+    EXPECT_EQ(0u, _engine.flush());
+    EXPECT_TRUE(_written.empty());
+
+    // Likewise, once the port has been sent
+    ASSERT_EQ(0, _engine.digitalWrite(20, true));
+    EXPECT_EQ(1u, _engine.flush());
+    _written.clear();
+    ASSERT_EQ(0, _engine.digitalWrite(20, false));
+    ASSERT_EQ(0, _engine.digitalWrite(21, true));
+    ASSERT_EQ(0, _engine.digitalWrite(21, false));
+    ASSERT_EQ(0, _engine.digitalWrite(20, true));
+    EXPECT_EQ(0u, _engine.flush());
+    EXPECT_TRUE(_written.empty());
+    EXPECT_EQ(0u, _engine.writesDropped());
+}
+
+TEST_F(DigitalWriteEngineTest, RejectsPinsWithoutDigitalWrite) {
+    EXPECT_NE(0, _engine.digitalWrite(0, true));  // Serial RX
+    EXPECT_NE(0, _engine.digitalWrite(ArduinoMega::PIN_COUNT, true));
+    EXPECT_NE(0, _engine.digitalWrite(PinSet::CAPACITY, true));
+    EXPECT_EQ(0u, _engine.flush());
+    EXPECT_TRUE(_written.empty());
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
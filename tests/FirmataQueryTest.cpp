@@ -0,0 +1,115 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <chrono>
+#include <future>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "DeviceContract.h"
+#include "FirmataBoards.h"
+#include "FirmataQuery.h"
+#include "FirmataResponder.h"
+#include "LoopbackStream.h"
+
+using namespace remote_wiring::protocol;
+
+static DeviceContract *
+acquireContract (
+    FirmataQuery & query_,
+    LoopbackStream & stream_,
+    const PinConfig * pin_config_,
+    const size_t pin_count_
+) {
+    FirmataResponder responder(stream_, pin_config_, pin_count_);
+
+    if ( 0 != query_.queryContractAsync(&stream_, nullptr, nullptr) ) { return nullptr; }
+    responder.begin();
+    if ( std::future_status::ready != query_.contractReadyFuture().wait_for(std::chrono::seconds(1)) ) { return nullptr; }
+
+    return query_.detachDeviceContract();
+}
+
+static void
+expectContractMatches (
+    const DeviceContract & contract_,
+    const PinConfig * pin_config_,
+    const size_t pin_count_
+) {
+    ASSERT_EQ(pin_count_, contract_.pinCount());
+    for (size_t pin = 0 ; pin < pin_count_ ; ++pin) {
+        const PinConfig & config = pin_config_[pin];
+
+        EXPECT_EQ(static_cast<bool>(config.supported_modes & ANALOG_READ), contract_.analogReadAvailableOnPin(pin)) << "pin " << pin;
+        EXPECT_EQ(static_cast<bool>(config.supported_modes & ANALOG_WRITE), contract_.analogWriteAvailableOnPin(pin)) << "pin " << pin;
+        EXPECT_EQ(static_cast<bool>(config.supported_modes & DIGITAL_READ), contract_.digitalReadAvailableOnPin(pin)) << "pin " << pin;
+        EXPECT_EQ(static_cast<bool>(config.supported_modes & DIGITAL_READ_WITH_PULLUP), contract_.digitalReadPullupAvailableOnPin(pin)) << "pin " << pin;
+        EXPECT_EQ(static_cast<bool>(config.supported_modes & DIGITAL_WRITE), contract_.digitalWriteAvailableOnPin(pin)) << "pin " << pin;
+        if ( config.supported_modes & ANALOG_READ ) {
+            EXPECT_EQ(static_cast<size_t>(config.analog_read_resolution_bits), contract_.analogReadBitsOfResolutionForPin(pin)) << "pin " << pin;
+            EXPECT_EQ(static_cast<size_t>(config.reserved), contract_.analogChannelForPin(pin)) << "pin " << pin;
+        }
+        if ( config.supported_modes & ANALOG_WRITE ) {
+            EXPECT_EQ(static_cast<size_t>(config.analog_write_resolution_bits), contract_.analogWriteBitsOfResolutionForPin(pin)) << "pin " << pin;
+        }
+    }
+}
+
+TEST(FirmataQueryTest, ContractRoundTripsForUno) {
+    LoopbackStream stream;
+    FirmataQuery query;
+    std::unique_ptr<DeviceContract> contract(acquireContract(query, stream, ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT));
+
+    ASSERT_NE(nullptr, contract);
+    expectContractMatches(*contract, ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT);
+}
+
+TEST(FirmataQueryTest, ContractRoundTripsForMega) {
+    LoopbackStream stream;
+    FirmataQuery query;
+    std::unique_ptr<DeviceContract> contract(acquireContract(query, stream, ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT));
+
+    ASSERT_NE(nullptr, contract);
+    expectContractMatches(*contract, ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT);
+}
+
+TEST(FirmataQueryTest, ContractRoundTripsForDue) {
+    LoopbackStream stream;
+    FirmataQuery query;
+    std::unique_ptr<DeviceContract> contract(acquireContract(query, stream, ArduinoDue::PIN_CONFIG, ArduinoDue::PIN_COUNT));
+
+    ASSERT_NE(nullptr, contract);
+    expectContractMatches(*contract, ArduinoDue::PIN_CONFIG, ArduinoDue::PIN_COUNT);
+}
+
+TEST(FirmataQueryTest, QueryIsReusableAcrossBoards) {
+    LoopbackStream uno_stream;
+    LoopbackStream mega_stream;
+    FirmataQuery query;
+    std::unique_ptr<DeviceContract> uno(acquireContract(query, uno_stream, ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT));
+    std::unique_ptr<DeviceContract> mega(acquireContract(query, mega_stream, ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT));
+
+    ASSERT_NE(nullptr, uno);
+    ASSERT_NE(nullptr, mega);
+    expectContractMatches(*uno, ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT);
+    expectContractMatches(*mega, ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT);
+}
+
+TEST(FirmataQueryTest, CompletesWhenTheVersionWasReportedBeforeAttach) {
+    LoopbackStream stream;
+    FirmataQuery query;
+    FirmataResponder responder(stream, ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT);
+
+    // The device boots and announces itself before anyone is listening
+    responder.begin();
+    while ( 0 <= stream.read() ) {}
+
+    ASSERT_EQ(0, query.queryContractAsync(&stream, nullptr, nullptr));
+    ASSERT_EQ(std::future_status::ready, query.contractReadyFuture().wait_for(std::chrono::seconds(1)));
+    std::unique_ptr<DeviceContract> contract(query.detachDeviceContract());
+
+    ASSERT_NE(nullptr, contract);
+    expectContractMatches(*contract, ArduinoUno::PIN_CONFIG, ArduinoUno::PIN_COUNT);
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,157 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "FirmataResponder.h"
+
+#include "FirmataConstants.h"
+#include "SevenBitCodec.h"
+
+using namespace remote_wiring::protocol;
+
+FirmataResponder::FirmataResponder (
+    LoopbackStream & stream_,
+    const PinConfig * pin_config_,
+    const size_t pin_count_,
+    const char * firmware_name_
+) :
+    _parsing_sysex(false),
+    _pin_config(pin_config_),
+    _pin_count(pin_count_),
+    _queries_answered(0),
+    _stream(stream_),
+    _firmware_name(firmware_name_)
+{
+    buildResponses();
+    _stream.setWriteHandler(FirmataResponder::hostWriteHandler, this);
+}
+
+FirmataResponder::~FirmataResponder (
+    void
+) {
+    _stream.setWriteHandler(nullptr, nullptr);
+}
+
+void
+FirmataResponder::answerQuery (
+    void
+) {
+    if ( _request.empty() ) { return; }
+    if ( (firmata::PIN_STATE_QUERY == _request[0]) && (_request.size() > 1) ) {
+        answerPinStateQuery(_request[1]);
+        return;
+    }
+
+    std::map<uint8_t, std::vector<uint8_t>>::const_iterator response = _responses.find(_request[0]);
+    if ( response == _responses.end() ) { return; }
+
+    ++_queries_answered;
+    _stream.inject(response->second.data(), response->second.size());
+    _stream.pump();
+}
+
+void
+FirmataResponder::answerPinStateQuery (
+    const uint8_t pin_
+) {
+    // StandardFirmata ignores queries for pins it does not have
+    if ( pin_ >= _pin_count ) { return; }
+
+    // Pins report the mode StandardFirmata assigns at reset, with a low state
+    const PinConfig & config = _pin_config[pin_];
+    const uint8_t mode = (((config.supported_modes & ANALOG_READ) && (0x7F != (config.reserved & 0x7F))) ? firmata::PIN_MODE_ANALOG
+                       : (config.supported_modes & DIGITAL_WRITE) ? firmata::PIN_MODE_OUTPUT
+                       : firmata::PIN_MODE_IGNORE);
+    const uint8_t response[] = { firmata::START_SYSEX, firmata::PIN_STATE_RESPONSE, pin_, mode, 0x00, firmata::END_SYSEX };
+
+    ++_queries_answered;
+    _stream.inject(response, sizeof(response));
+    _stream.pump();
+}
+
+void
+FirmataResponder::begin (
+    void
+) {
+    const uint8_t version[] = { firmata::REPORT_VERSION, firmata::PROTOCOL_MAJOR_VERSION, firmata::PROTOCOL_MINOR_VERSION };
+    const std::vector<uint8_t> & firmware = _responses[firmata::REPORT_FIRMWARE];
+
+    _stream.inject(version, sizeof(version));
+    _stream.inject(firmware.data(), firmware.size());
+    _stream.pump();
+}
+
+void
+FirmataResponder::buildResponses (
+    void
+) {
+    std::vector<uint8_t> & capability = _responses[firmata::CAPABILITY_QUERY];
+    std::vector<uint8_t> & analog_mapping = _responses[firmata::ANALOG_MAPPING_QUERY];
+    std::vector<uint8_t> & firmware = _responses[firmata::REPORT_FIRMWARE];
+
+    // Capability response, as a list of mode/resolution pairs per pin
+    capability.push_back(firmata::START_SYSEX);
+    capability.push_back(firmata::CAPABILITY_RESPONSE);
+    for (size_t pin = 0 ; pin < _pin_count ; ++pin) {
+        const PinConfig & config = _pin_config[pin];
+        if ( config.supported_modes & DIGITAL_READ ) { capability.push_back(firmata::PIN_MODE_INPUT); capability.push_back(1); }
+        if ( config.supported_modes & DIGITAL_WRITE ) { capability.push_back(firmata::PIN_MODE_OUTPUT); capability.push_back(1); }
+        if ( config.supported_modes & ANALOG_READ ) { capability.push_back(firmata::PIN_MODE_ANALOG); capability.push_back(config.analog_read_resolution_bits); }
+        if ( config.supported_modes & ANALOG_WRITE ) { capability.push_back(firmata::PIN_MODE_PWM); capability.push_back(config.analog_write_resolution_bits); }
+        if ( config.supported_modes & DIGITAL_READ_WITH_PULLUP ) { capability.push_back(firmata::PIN_MODE_PULLUP); capability.push_back(1); }
+        capability.push_back(firmata::PIN_MODE_IGNORE);
+    }
+    capability.push_back(firmata::END_SYSEX);
+
+    // Analog mapping response, as one channel (or 0x7F) per pin
+    analog_mapping.push_back(firmata::START_SYSEX);
+    analog_mapping.push_back(firmata::ANALOG_MAPPING_RESPONSE);
+    for (size_t pin = 0 ; pin < _pin_count ; ++pin) {
+        analog_mapping.push_back(static_cast<uint8_t>(_pin_config[pin].reserved & 0x7F));
+    }
+    analog_mapping.push_back(firmata::END_SYSEX);
+
+    // Firmware report, with the name encoded as 7-bit pairs
+    firmware.push_back(firmata::START_SYSEX);
+    firmware.push_back(firmata::REPORT_FIRMWARE);
+    firmware.push_back(firmata::FIRMWARE_MAJOR_VERSION);
+    firmware.push_back(firmata::FIRMWARE_MINOR_VERSION);
+    const size_t name_offset = firmware.size();
+    firmware.resize(name_offset + (2 * _firmware_name.size()));
+    SevenBitCodec::encode(reinterpret_cast<const uint8_t *>(_firmware_name.data()), _firmware_name.size(), (firmware.data() + name_offset));
+    firmware.push_back(firmata::END_SYSEX);
+}
+
+void
+FirmataResponder::hostWriteHandler (
+    void * context_,
+    uint8_t byte_
+) {
+    FirmataResponder * responder = reinterpret_cast<FirmataResponder *>(context_);
+
+    if ( firmata::START_SYSEX == byte_ ) {
+        responder->_parsing_sysex = true;
+        responder->_request.clear();
+    } else if ( firmata::END_SYSEX == byte_ ) {
+        responder->_parsing_sysex = false;
+        responder->answerQuery();
+    } else if ( responder->_parsing_sysex ) {
+        responder->_request.push_back(byte_);
+    }
+}
+
+size_t
+FirmataResponder::queriesAnswered (
+    void
+) const {
+    return _queries_answered;
+}
+
+void
+FirmataResponder::setResponse (
+    const uint8_t query_,
+    const uint8_t * response_,
+    const size_t size_
+) {
+    _responses[query_].assign(response_, (response_ + size_));
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
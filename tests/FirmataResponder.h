@@ -0,0 +1,108 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef FIRMATA_RESPONDER_H
+#define FIRMATA_RESPONDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DeviceContract.h"
+#include "LoopbackStream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief A scripted stand-in for a remote device running StandardFirmata
+ *
+ * The responder listens to the bytes the host writes to a `LoopbackStream`,
+ * and answers each sysex query with a scripted response. By default the
+ * responses are generated from a `PinConfig` table (i.e. `ArduinoUno`), and
+ * any response may be replaced with captured traffic via `setResponse`.
+ * PIN_STATE_QUERY is answered per pin, with the mode each pin takes at reset.
+ */
+class FirmataResponder {
+  public:
+    FirmataResponder (
+        LoopbackStream & stream_,
+        const PinConfig * pin_config_,
+        const size_t pin_count_,
+        const char * firmware_name_ = "StandardFirmata.ino"
+    );
+
+    ~FirmataResponder (
+        void
+    );
+
+    /*!
+     * \brief Emit the boot sequence (REPORT_VERSION and REPORT_FIRMWARE)
+     */
+    void
+    begin (
+        void
+    );
+
+    /*!
+     * \brief The number of queries answered by the responder
+     */
+    size_t
+    queriesAnswered (
+        void
+    ) const;
+
+    /*!
+     * \brief Replace the response to a sysex query
+     *
+     * \param [in] query_ The sysex command of the query (i.e. `CAPABILITY_QUERY`)
+     * \param [in] response_ The complete response, from START_SYSEX to END_SYSEX
+     * \param [in] size_ The number of bytes in the response
+     */
+    void
+    setResponse (
+        const uint8_t query_,
+        const uint8_t * response_,
+        const size_t size_
+    );
+
+  private:
+    std::vector<uint8_t> _request;
+    bool _parsing_sysex;
+    const PinConfig * const _pin_config;
+    const size_t _pin_count;
+    size_t _queries_answered;
+    std::map<uint8_t, std::vector<uint8_t>> _responses;
+    LoopbackStream & _stream;
+    const std::string _firmware_name;
+
+    void
+    answerPinStateQuery (
+        const uint8_t pin_
+    );
+
+    void
+    answerQuery (
+        void
+    );
+
+    void
+    buildResponses (
+        void
+    );
+
+    static
+    void
+    hostWriteHandler (
+        void * context_,
+        uint8_t byte_
+    );
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // FIRMATA_RESPONDER_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,137 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "LoopbackStream.h"
+
+using namespace remote_wiring::protocol;
+
+LoopbackStream::LoopbackStream (
+    void
+) :
+    _dispatching(false),
+    _serial_event_callback(nullptr),
+    _serial_event_context(nullptr),
+    _write_handler(nullptr),
+    _write_handler_context(nullptr),
+    _write_count(0)
+{
+}
+
+LoopbackStream::~LoopbackStream (
+    void
+) {
+}
+
+size_t
+LoopbackStream::available (
+    void
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _rx.size();
+}
+
+void
+LoopbackStream::begin (
+    const size_t speed_,
+    const size_t config_
+) {
+    (void)speed_;
+    (void)config_;
+}
+
+void
+LoopbackStream::end (
+    void
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _rx.clear();
+}
+
+void
+LoopbackStream::flush (
+    void
+) {
+}
+
+void
+LoopbackStream::inject (
+    const uint8_t * data_,
+    const size_t size_
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _rx.insert(_rx.end(), data_, (data_ + size_));
+}
+
+int
+LoopbackStream::peek (
+    void
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return (_rx.empty() ? -1 : _rx.front());
+}
+
+size_t
+LoopbackStream::pump (
+    void
+) {
+    size_t events = 0;
+
+    // Refuse to re-enter the host from within its own serial event
+    if ( _dispatching.exchange(true) ) { return 0; }
+    while ( _serial_event_callback && available() ) {
+        _serial_event_callback(_serial_event_context);
+        ++events;
+    }
+    _dispatching = false;
+
+    return events;
+}
+
+int
+LoopbackStream::read (
+    void
+) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    int byte;
+
+    if ( _rx.empty() ) { return -1; }
+    byte = _rx.front();
+    _rx.pop_front();
+
+    return byte;
+}
+
+void
+LoopbackStream::registerSerialEventCallback (
+    serialEvent upon_read_,
+    void * context_
+) {
+    _serial_event_callback = upon_read_;
+    _serial_event_context = context_;
+}
+
+void
+LoopbackStream::setWriteHandler (
+    writeHandler handler_,
+    void * context_
+) {
+    _write_handler = handler_;
+    _write_handler_context = context_;
+}
+
+size_t
+LoopbackStream::write (
+    uint8_t byte_
+) {
+    ++_write_count;
+    if ( _write_handler ) { _write_handler(_write_handler_context, byte_); }
+    return 1;
+}
+
+size_t
+LoopbackStream::writeCount (
+    void
+) const {
+    return _write_count;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,141 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef LOOPBACK_STREAM_H
+#define LOOPBACK_STREAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "Stream.h"
+
+namespace remote_wiring {
+namespace protocol {
+
+/*!
+ * \brief An in-memory stream for exercising the protocol without hardware
+ *
+ * Bytes injected into the stream are read back by the host, as though they
+ * arrived from a remote device. Bytes written by the host are handed to a
+ * write handler (i.e. a `FirmataResponder`) instead of a serial port.
+ *
+ * \note Serial events are raised by `pump`, on the calling thread. Calls to
+ *       `pump` made while a serial event is already being dispatched return
+ *       immediately, so a responder may inject replies from within a host
+ *       callback without re-entering the parser.
+ */
+class LoopbackStream : public Stream {
+  public:
+    typedef void(*writeHandler)(void * context_, uint8_t byte_);
+
+    LoopbackStream (
+        void
+    );
+
+    ~LoopbackStream (
+        void
+    );
+
+    size_t
+    available (
+        void
+    ) override;
+
+    void
+    begin (
+        const size_t speed_,
+        const size_t config_
+    ) override;
+
+    void
+    end (
+        void
+    ) override;
+
+    void
+    flush (
+        void
+    ) override;
+
+    /*!
+     * \brief Queue bytes for the host to read
+     *
+     * \param [in] data_ The bytes to queue
+     * \param [in] size_ The number of bytes to queue
+     */
+    void
+    inject (
+        const uint8_t * data_,
+        const size_t size_
+    );
+
+    int
+    peek (
+        void
+    ) override;
+
+    /*!
+     * \brief Raise serial events until all injected bytes are consumed
+     *
+     * \return The number of serial events raised
+     */
+    size_t
+    pump (
+        void
+    );
+
+    int
+    read (
+        void
+    ) override;
+
+    void
+    registerSerialEventCallback (
+        serialEvent upon_read_,
+        void * context_
+    ) override;
+
+    /*!
+     * \brief Observe the bytes written by the host
+     *
+     * \param [in] handler_ Invoked for each byte written
+     * \param [in] context_ A context supplied to the handler when called
+     */
+    void
+    setWriteHandler (
+        writeHandler handler_,
+        void * context_
+    );
+
+    size_t
+    write (
+        uint8_t byte_
+    ) override;
+
+    /*!
+     * \brief The total number of bytes written by the host
+     */
+    size_t
+    writeCount (
+        void
+    ) const;
+
+  private:
+    std::atomic_bool _dispatching;
+    std::mutex _mutex;
+    std::deque<uint8_t> _rx;
+    serialEvent _serial_event_callback;
+    void * _serial_event_context;
+    writeHandler _write_handler;
+    void * _write_handler_context;
+    std::atomic<size_t> _write_count;
+};
+
+} // protocol
+} // remote_wiring
+
+#endif // LOOPBACK_STREAM_H
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
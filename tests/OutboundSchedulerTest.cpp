@@ -0,0 +1,142 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "FdStream.h"
+#include "FirmataConstants.h"
+#include "OutboundScheduler.h"
+
+using namespace remote_wiring::protocol;
+
+static const size_t MESSAGES_PER_LANE = 2000;
+
+/*!
+ * \brief Records every byte written
+ */
+class RecordingStream : public Stream {
+  public:
+    std::vector<uint8_t> bytes;
+
+    size_t available (void) override { return 0; }
+    void begin (const size_t, const size_t) override {}
+    void end (void) override {}
+    void flush (void) override {}
+    int peek (void) override { return -1; }
+    int read (void) override { return -1; }
+    void registerSerialEventCallback (serialEvent, void *) override {}
+    size_t write (uint8_t byte_) override { bytes.push_back(byte_); return 1; }
+};
+
+// One control lane writes numbered DIGITAL_MESSAGEs, and each bulk lane
+// writes STRING_DATA messages filled with its own lane number
+static void
+writeLanes (
+    OutboundScheduler & scheduler_,
+    const size_t bulk_lanes_
+) {
+    std::vector<std::thread> writers;
+
+    writers.emplace_back([&scheduler_]() {
+        OutboundScheduler::Lane * lane = scheduler_.openLane(OutboundScheduler::PRIORITY_CONTROL);
+        for (size_t i = 0 ; i < MESSAGES_PER_LANE ; ++i) {
+            lane->write(firmata::DIGITAL_MESSAGE);
+            lane->write(i & 0x7F);
+            lane->write(0x00);
+        }
+        scheduler_.closeLane(lane);
+    });
+    for (size_t id = 1 ; id <= bulk_lanes_ ; ++id) {
+        writers.emplace_back([&scheduler_, id]() {
+            OutboundScheduler::Lane * lane = scheduler_.openLane(OutboundScheduler::PRIORITY_BULK);
+            for (size_t i = 0 ; i < MESSAGES_PER_LANE ; ++i) {
+                lane->write(firmata::START_SYSEX);
+                lane->write(firmata::STRING_DATA);
+                for (size_t k = 0 ; k < (8 + (i % 56)) ; ++k) { lane->write(static_cast<uint8_t>(id)); }
+                lane->write(firmata::END_SYSEX);
+            }
+            scheduler_.closeLane(lane);
+        });
+    }
+    for (size_t i = 0 ; i < writers.size() ; ++i) { writers[i].join(); }
+    scheduler_.flush();
+}
+
+// Every message must arrive whole, and each lane's messages in order
+static void
+expectWholeMessages (
+    const std::vector<uint8_t> & bytes_,
+    const size_t bulk_lanes_
+) {
+    std::vector<size_t> messages(bulk_lanes_ + 1, 0);
+
+    for (size_t i = 0 ; i < bytes_.size() ; ) {
+        if ( firmata::DIGITAL_MESSAGE == bytes_[i] ) {
+            ASSERT_LE((i + 3), bytes_.size());
+            ASSERT_EQ((messages[0] & 0x7F), bytes_[i + 1]) << "offset " << i;
+            ASSERT_EQ(0x00, bytes_[i + 2]) << "offset " << i;
+            ++messages[0];
+            i += 3;
+        } else {
+            ASSERT_EQ(firmata::START_SYSEX, bytes_[i]) << "offset " << i;
+            ASSERT_EQ(firmata::STRING_DATA, bytes_[i + 1]) << "offset " << i;
+            const uint8_t id = bytes_[i + 2];
+            ASSERT_TRUE((id >= 1) && (id <= bulk_lanes_)) << "offset " << i;
+            const size_t begin = i;
+            for (i += 2 ; (i < bytes_.size()) && (firmata::END_SYSEX != bytes_[i]) ; ++i) { ASSERT_EQ(id, bytes_[i]) << "offset " << i; }
+            ASSERT_LT(i, bytes_.size());
+            ASSERT_EQ((8 + (messages[id] % 56)), (i - begin - 2)) << "offset " << begin;
+            ++messages[id];
+            ++i;
+        }
+    }
+    for (size_t lane = 0 ; lane <= bulk_lanes_ ; ++lane) { EXPECT_EQ(MESSAGES_PER_LANE, messages[lane]) << "lane " << lane; }
+}
+
+TEST(OutboundSchedulerTest, NeverInterleavesMessages) {
+    RecordingStream stream;
+    {
+        OutboundScheduler scheduler(stream, 256, 32);
+        writeLanes(scheduler, 3);
+        EXPECT_EQ(MESSAGES_PER_LANE, scheduler.framesSent(OutboundScheduler::PRIORITY_CONTROL));
+        EXPECT_EQ((3 * MESSAGES_PER_LANE), scheduler.framesSent(OutboundScheduler::PRIORITY_BULK));
+    }
+    expectWholeMessages(stream.bytes, 3);
+}
+
+TEST(OutboundSchedulerTest, WritesWholeMessagesToASaturatedDescriptor) {
+    int link[2];
+    std::vector<uint8_t> received;
+
+    ASSERT_EQ(0, ::pipe(link));
+    (void)::fcntl(link[1], F_SETPIPE_SZ, 4096);
+
+    // A slow reader keeps the descriptor full
+    std::thread reader([&link, &received]() {
+        uint8_t buffer[512];
+        for (ssize_t bytes_read ; (bytes_read = ::read(link[0], buffer, sizeof(buffer))) > 0 ; ::usleep(200)) {
+            received.insert(received.end(), buffer, (buffer + bytes_read));
+        }
+    });
+    {
+        FdStream descriptor(link[1]);
+        descriptor.begin(0, 0x06);
+        OutboundScheduler scheduler(descriptor, 256, 32);
+        writeLanes(scheduler, 3);
+        EXPECT_EQ(0u, scheduler.framesFailed(OutboundScheduler::PRIORITY_CONTROL));
+        EXPECT_EQ(0u, scheduler.framesFailed(OutboundScheduler::PRIORITY_BULK));
+    }
+    ::close(link[1]);
+    reader.join();
+    ::close(link[0]);
+
+    expectWholeMessages(received, 3);
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
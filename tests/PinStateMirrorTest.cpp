@@ -0,0 +1,96 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "FirmataBoards.h"
+#include "FirmataConstants.h"
+#include "LoopbackStream.h"
+#include "PinStateMirror.h"
+#include "StaticFirmataContract.h"
+
+using namespace remote_wiring::protocol;
+
+static const uint8_t PIN_13_OUTPUT_HIGH[] = { 13, firmata::PIN_MODE_OUTPUT, 0x01 };
+
+class PinStateMirrorTest : public ::testing::Test {
+  protected:
+    StaticFirmataContractAdapter<ArduinoUno> _contract;
+    PinStateMirror _mirror;
+    LoopbackStream _stream;
+
+    PinStateMirrorTest (
+        void
+    ) :
+        _mirror(_contract)
+    {
+        _mirror.begin(_stream);
+    }
+};
+
+struct Reentry {
+    PinStateMirror * mirror;
+    uint8_t mode;
+};
+
+// Reads the mirror, queries another pin, then detaches itself
+static void
+reenterMirror (
+    void * context_,
+    size_t pin_
+) {
+    Reentry * reentry = reinterpret_cast<Reentry *>(context_);
+
+    reentry->mode = reentry->mirror->cachedPinMode(pin_);
+    (void)reentry->mirror->queryPinState(pin_ + 1);
+    reentry->mirror->setPinStateCallback(nullptr, nullptr);
+}
+
+TEST_F(PinStateMirrorTest, CallbackMayCallBackIntoTheMirror) {
+    Reentry reentry = { &_mirror, PinStateMirror::UNKNOWN_MODE };
+    std::future<void> reported;
+
+    _mirror.setPinStateCallback(reenterMirror, &reentry);
+    reported = std::async(std::launch::async, [this]() { _mirror.pinStateResponse(sizeof(PIN_13_OUTPUT_HIGH), PIN_13_OUTPUT_HIGH); });
+
+    ASSERT_EQ(std::future_status::ready, reported.wait_for(std::chrono::seconds(1))) << "the callback deadlocked on the mirror";
+    EXPECT_EQ(firmata::PIN_MODE_OUTPUT, reentry.mode);
+}
+
+struct SlowReport {
+    std::atomic_bool entered;
+    std::atomic_bool returned;
+};
+
+static void
+reportSlowly (
+    void * context_,
+    size_t
+) {
+    SlowReport * report = reinterpret_cast<SlowReport *>(context_);
+
+    report->entered = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    report->returned = true;
+}
+
+TEST_F(PinStateMirrorTest, DetachWaitsForTheCallbackInProgress) {
+    SlowReport report;
+    report.entered = false;
+    report.returned = false;
+
+    _mirror.setPinStateCallback(reportSlowly, &report);
+    std::thread parser([this]() { _mirror.pinStateResponse(sizeof(PIN_13_OUTPUT_HIGH), PIN_13_OUTPUT_HIGH); });
+    while ( !report.entered ) { std::this_thread::yield(); }
+
+    // Once detached, the callback's context may be released
+    _mirror.setPinStateCallback(nullptr, nullptr);
+    EXPECT_TRUE(report.returned);
+    parser.join();
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,127 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "FirmataBoards.h"
+#include "FirmataConstants.h"
+#include "FirmataQuery.h"
+#include "FirmataResponder.h"
+#include "LoopbackStream.h"
+#include "PinStateMirror.h"
+#include "PinStateSweep.h"
+
+using namespace remote_wiring::protocol;
+
+// The mode `FirmataResponder` reports for a pin, as StandardFirmata at reset
+static uint8_t
+resetMode (
+    const PinConfig & config_
+) {
+    if ( (config_.supported_modes & ANALOG_READ) && (0x7F != (config_.reserved & 0x7F)) ) { return firmata::PIN_MODE_ANALOG; }
+    if ( config_.supported_modes & DIGITAL_WRITE ) { return firmata::PIN_MODE_OUTPUT; }
+    return firmata::PIN_MODE_IGNORE;
+}
+
+class PinStateSweepTest : public ::testing::TestWithParam<size_t> {
+  protected:
+    std::unique_ptr<DeviceContract> _contract;
+    LoopbackStream _stream;
+    FirmataQuery _query;
+    FirmataResponder _responder;
+
+    PinStateSweepTest (
+        void
+    ) :
+        _responder(_stream, ArduinoMega::PIN_CONFIG, ArduinoMega::PIN_COUNT)
+    {
+    }
+
+    void
+    SetUp (
+        void
+    ) override {
+        ASSERT_EQ(0, _query.queryContractAsync(&_stream, nullptr, nullptr));
+        _responder.begin();
+        ASSERT_EQ(std::future_status::ready, _query.contractReadyFuture().wait_for(std::chrono::seconds(1)));
+        _contract.reset(_query.detachDeviceContract());
+        ASSERT_NE(nullptr, _contract);
+    }
+
+    void
+    TearDown (
+        void
+    ) override {
+        _query.setPinStateMirror(nullptr);
+    }
+};
+
+TEST_P(PinStateSweepTest, ReportsEveryPin) {
+    PinStateMirror mirror(*_contract);
+    PinStateSweep sweep(mirror, _contract->pinCount(), GetParam());
+    std::vector<PinStateReport> snapshot;
+
+    _query.setPinStateMirror(&mirror);
+    sweep.begin(_stream);
+    ASSERT_EQ(0, sweep.sweep(std::chrono::seconds(5), &snapshot));
+    ASSERT_EQ(ArduinoMega::PIN_COUNT, snapshot.size());
+    EXPECT_EQ(ArduinoMega::PIN_COUNT, sweep.queriesSent());
+    for (size_t pin = 0 ; pin < snapshot.size() ; ++pin) {
+        uint32_t state = 0xFFFFFFFF;
+
+        EXPECT_EQ(resetMode(ArduinoMega::PIN_CONFIG[pin]), snapshot[pin].mode) << "pin " << pin;
+        EXPECT_EQ(0u, snapshot[pin].state) << "pin " << pin;
+        EXPECT_EQ(snapshot[pin].mode, mirror.cachedPinMode(pin)) << "pin " << pin;
+        EXPECT_TRUE(mirror.cachedPinState(pin, std::chrono::seconds(5), &state)) << "pin " << pin;
+        EXPECT_EQ(0u, state) << "pin " << pin;
+    }
+}
+
+TEST_P(PinStateSweepTest, TimesOutOnMissingPins) {
+    PinStateMirror mirror(*_contract);
+    PinStateSweep sweep(mirror, (ArduinoMega::PIN_COUNT + 2), GetParam());
+    std::vector<PinStateReport> snapshot;
+
+    // The responder ignores queries for pins the board does not have
+    _query.setPinStateMirror(&mirror);
+    sweep.begin(_stream);
+    EXPECT_NE(0, sweep.sweep(std::chrono::milliseconds(100), &snapshot));
+    ASSERT_EQ((ArduinoMega::PIN_COUNT + 2), snapshot.size());
+    EXPECT_EQ(resetMode(ArduinoMega::PIN_CONFIG[0]), snapshot[0].mode);
+    EXPECT_EQ(static_cast<uint8_t>(PinStateMirror::UNKNOWN_MODE), snapshot[ArduinoMega::PIN_COUNT].mode);
+    EXPECT_EQ(static_cast<uint8_t>(PinStateMirror::UNKNOWN_MODE), snapshot[ArduinoMega::PIN_COUNT + 1].mode);
+}
+
+static void
+countReport (
+    void * context_,
+    size_t pin_
+) {
+    (void)pin_;
+    ++*reinterpret_cast<size_t *>(context_);
+}
+
+TEST_P(PinStateSweepTest, KeepsTheMirrorsObserver) {
+    PinStateMirror mirror(*_contract);
+    PinStateSweep sweep(mirror, _contract->pinCount(), GetParam());
+    size_t reports = 0;
+
+    _query.setPinStateMirror(&mirror);
+    mirror.setPinStateCallback(countReport, &reports);
+    sweep.begin(_stream);
+    ASSERT_EQ(0, sweep.sweep(std::chrono::seconds(5)));
+
+    // Reports made during the sweep are forwarded, and later ones still observed
+    EXPECT_EQ(ArduinoMega::PIN_COUNT, reports);
+    const uint8_t response[] = { 13, firmata::PIN_MODE_OUTPUT, 0x01 };
+    mirror.pinStateResponse(sizeof(response), response);
+    EXPECT_EQ((ArduinoMega::PIN_COUNT + 1), reports);
+}
+
+INSTANTIATE_TEST_SUITE_P(Windows, PinStateSweepTest, ::testing::Values(1, 8, 128));
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,41 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <chrono>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "QueryMetrics.h"
+
+using namespace remote_wiring::protocol;
+
+TEST(QueryMetricsTest, BucketsSamplesAtOrBelowEachBound) {
+    QueryMetrics metrics;
+
+    metrics.recordPhase(QueryMetricsSnapshot::VERSION_WAIT, std::chrono::microseconds(0));
+    metrics.recordPhase(QueryMetricsSnapshot::VERSION_WAIT, std::chrono::microseconds(1));
+    metrics.recordPhase(QueryMetricsSnapshot::VERSION_WAIT, std::chrono::microseconds(2));
+    metrics.recordPhase(QueryMetricsSnapshot::VERSION_WAIT, std::chrono::microseconds(3));
+    metrics.recordPhase(QueryMetricsSnapshot::VERSION_WAIT, std::chrono::microseconds(4));
+
+    const HistogramSnapshot & histogram = metrics.snapshot().phases[QueryMetricsSnapshot::VERSION_WAIT];
+    EXPECT_EQ(2u, histogram.buckets[0]);  // 0us, 1us <= 1us
+    EXPECT_EQ(1u, histogram.buckets[1]);  // 2us <= 2us
+    EXPECT_EQ(2u, histogram.buckets[2]);  // 3us, 4us <= 4us
+    EXPECT_EQ(5u, histogram.count);
+}
+
+TEST(QueryMetricsTest, ExposesCumulativeCountsUnderInclusiveBounds) {
+    QueryMetrics metrics;
+
+    metrics.recordPhase(QueryMetricsSnapshot::CONTRACT_ACQUISITION, std::chrono::microseconds(8));
+    metrics.recordPhase(QueryMetricsSnapshot::CONTRACT_ACQUISITION, std::chrono::microseconds(9));
+
+    const std::string text = QueryMetrics::exposition(metrics.snapshot(), "uno");
+    const std::string bucket = "firmata_phase_duration_microseconds_bucket{device=\"uno\",phase=\"contract_acquisition\",le=";
+    EXPECT_NE(std::string::npos, text.find(bucket + "\"4\"} 0\n"));
+    EXPECT_NE(std::string::npos, text.find(bucket + "\"8\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find(bucket + "\"16\"} 2\n"));
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,145 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "AnalogSampler.h"
+#include "FirmataBoards.h"
+#include "FirmataConstants.h"
+#include "FirmataQuery.h"
+#include "LoopbackStream.h"
+#include "SamplingController.h"
+#include "StaticFirmataContract.h"
+
+using namespace remote_wiring::protocol;
+
+static void
+record (
+    void * context_,
+    uint8_t byte_
+) {
+    reinterpret_cast<std::vector<uint8_t> *>(context_)->push_back(byte_);
+}
+
+class SamplingControllerTest : public ::testing::Test {
+  protected:
+    static const size_t SAMPLES_PER_PIN = 16;
+    static const size_t PIN = 14;  // Channel 0 of an Uno
+
+    StaticFirmataContractAdapter<ArduinoUno> _contract;
+    AnalogSampler _sampler;
+    LoopbackStream _stream;  // Outlives the query
+    FirmataQuery _query;
+    std::vector<uint8_t> _written;
+
+    SamplingControllerTest (void) :
+        _sampler(_contract, SAMPLES_PER_PIN)
+    {
+        _stream.setWriteHandler(record, &_written);
+    }
+
+    void SetUp (void) override {
+        ASSERT_EQ(0, _query.queryContractAsync(&_stream, nullptr, nullptr));
+        _written.clear();
+    }
+
+    // Leave a number of unread samples on the pin
+    void fill (const size_t samples_) {
+        const uint8_t frame[] = { firmata::ANALOG_MESSAGE, 0x01, 0x00 };
+        drain();
+        for (size_t i = 0 ; i < samples_ ; ++i) { _sampler.ingest(frame, sizeof(frame), std::chrono::steady_clock::now()); }
+    }
+
+    void drain (void) {
+        const AnalogSample * samples;
+        for (size_t count ; (count = _sampler.peek(PIN, &samples)) ; ) { _sampler.release(PIN, count); }
+    }
+
+    // The interval of the last SAMPLING_INTERVAL message written
+    uint16_t lastIntervalSent (void) const {
+        if ( _written.size() < 5 ) { return 0; }
+        const uint8_t * message = (_written.data() + _written.size() - 5);
+        if ( (firmata::START_SYSEX != message[0]) || (firmata::SAMPLING_INTERVAL != message[1]) || (firmata::END_SYSEX != message[4]) ) { return 0; }
+        return static_cast<uint16_t>(message[2] | (message[3] << 7));
+    }
+
+    uint64_t changes (const QueryMetricsSnapshot::SamplingChange reason_) const {
+        return _query.getMetrics()->snapshot().sampling_interval_changes[reason_];
+    }
+};
+
+TEST_F(SamplingControllerTest, BacksOffWhenTheConsumerFallsBehind) {
+    SamplingController controller(_query, _sampler, 10, 80);
+
+    ASSERT_EQ(0, controller.begin(20));
+    EXPECT_EQ(20u, lastIntervalSent());
+    EXPECT_EQ(1u, changes(QueryMetricsSnapshot::SAMPLING_REQUESTED));
+
+    // More than half full
+    fill((SAMPLES_PER_PIN / 2) + 1);
+    EXPECT_TRUE(controller.update());
+    EXPECT_EQ(40u, controller.interval());
+    EXPECT_EQ(40u, lastIntervalSent());
+    EXPECT_EQ(1u, changes(QueryMetricsSnapshot::SAMPLING_BACKLOG));
+
+    // Samples dropped by a full ring
+    fill(SAMPLES_PER_PIN + 3);
+    ASSERT_LT(0u, _sampler.samplesDropped());
+    EXPECT_TRUE(controller.update());
+    EXPECT_EQ(80u, controller.interval());
+    EXPECT_EQ(1u, changes(QueryMetricsSnapshot::SAMPLING_OVERRUN));
+
+    // Held at the maximum
+    _written.clear();
+    fill(SAMPLES_PER_PIN + 3);
+    EXPECT_FALSE(controller.update());
+    EXPECT_EQ(80u, controller.interval());
+    EXPECT_TRUE(_written.empty());
+    EXPECT_EQ(1u, changes(QueryMetricsSnapshot::SAMPLING_OVERRUN));
+    EXPECT_EQ(80u, _query.getMetrics()->snapshot().sampling_interval_ms);
+}
+
+TEST_F(SamplingControllerTest, RecoversOnlyAfterSeveralCalmUpdates) {
+    SamplingController controller(_query, _sampler, 10, 80);
+
+    ASSERT_EQ(0, controller.begin(40));
+    drain();
+
+    // Halve the interval once per run of calm updates, down to the minimum
+    const uint16_t expected[] = { 20, 10 };
+    for (size_t step = 0 ; step < (sizeof(expected) / sizeof(expected[0])) ; ++step) {
+        for (size_t update = 1 ; update < SamplingController::RECOVERY_UPDATES ; ++update) { EXPECT_FALSE(controller.update()); }
+        EXPECT_TRUE(controller.update());
+        EXPECT_EQ(expected[step], controller.interval());
+        EXPECT_EQ(expected[step], lastIntervalSent());
+    }
+    EXPECT_EQ(2u, changes(QueryMetricsSnapshot::SAMPLING_RECOVERED));
+
+    _written.clear();
+    for (size_t update = 0 ; update < (2 * SamplingController::RECOVERY_UPDATES) ; ++update) { EXPECT_FALSE(controller.update()); }
+    EXPECT_EQ(10u, controller.interval());
+    EXPECT_TRUE(_written.empty());
+    EXPECT_EQ(2u, changes(QueryMetricsSnapshot::SAMPLING_RECOVERED));
+}
+
+TEST_F(SamplingControllerTest, AModerateBacklogRestartsTheRecovery) {
+    SamplingController controller(_query, _sampler, 10, 80);
+
+    ASSERT_EQ(0, controller.begin(40));
+    drain();
+    for (size_t update = 1 ; update < SamplingController::RECOVERY_UPDATES ; ++update) { EXPECT_FALSE(controller.update()); }
+
+    // More than an eighth full, but no more than half
+    fill((SAMPLES_PER_PIN / 8) + 1);
+    EXPECT_FALSE(controller.update());
+    drain();
+    for (size_t update = 1 ; update < SamplingController::RECOVERY_UPDATES ; ++update) { EXPECT_FALSE(controller.update()); }
+    EXPECT_EQ(40u, controller.interval());
+    EXPECT_TRUE(controller.update());
+    EXPECT_EQ(20u, controller.interval());
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,84 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "SevenBitCodec.h"
+
+using namespace remote_wiring::protocol;
+
+class SevenBitCodecTest : public ::testing::TestWithParam<SevenBitCodec::Kernel> {
+  protected:
+    void
+    SetUp (
+        void
+    ) override {
+        _kernel = SevenBitCodec::kernel();
+        if ( !SevenBitCodec::kernelAvailable(GetParam()) ) { GTEST_SKIP() << SevenBitCodec::kernelName(GetParam()) << " is not supported"; }
+        ASSERT_EQ(0, SevenBitCodec::useKernel(GetParam()));
+    }
+
+    void
+    TearDown (
+        void
+    ) override {
+        (void)SevenBitCodec::useKernel(_kernel);
+    }
+
+  private:
+    SevenBitCodec::Kernel _kernel;
+};
+
+TEST_P(SevenBitCodecTest, EncodesLowBitsThenHighBit) {
+    std::vector<uint8_t> data(256);
+    std::vector<uint8_t> encoded(2 * data.size());
+
+    for (size_t i = 0 ; i < data.size() ; ++i) { data[i] = static_cast<uint8_t>(i); }
+    ASSERT_EQ(encoded.size(), SevenBitCodec::encode(data.data(), data.size(), encoded.data()));
+    for (size_t i = 0 ; i < data.size() ; ++i) {
+        EXPECT_EQ((data[i] & 0x7F), encoded[(2 * i)]) << "byte " << i;
+        EXPECT_EQ((data[i] >> 7), encoded[((2 * i) + 1)]) << "byte " << i;
+    }
+}
+
+TEST_P(SevenBitCodecTest, RoundTripsEverySize) {
+    std::mt19937 random(0x5EED);
+
+    // Cover the vector widths and every scalar tail
+    for (size_t size = 0 ; size <= 300 ; ++size) {
+        std::vector<uint8_t> data(size);
+        std::vector<uint8_t> encoded((2 * size) + 1, 0xFF);
+        std::vector<uint8_t> decoded(size + 1, 0xAA);
+
+        for (size_t i = 0 ; i < size ; ++i) { data[i] = static_cast<uint8_t>(random()); }
+        ASSERT_EQ((2 * size), SevenBitCodec::encode(data.data(), size, encoded.data()));
+        ASSERT_EQ(0xFF, encoded[(2 * size)]) << "encode overran at size " << size;
+        for (size_t i = 0 ; i < (2 * size) ; ++i) { ASSERT_EQ(0, (encoded[i] & 0x80)) << "size " << size << ", byte " << i; }
+
+        ASSERT_EQ(size, SevenBitCodec::decode(encoded.data(), (2 * size), decoded.data()));
+        ASSERT_EQ(0xAA, decoded[size]) << "decode overran at size " << size;
+        decoded.resize(size);
+        ASSERT_EQ(data, decoded) << "size " << size;
+    }
+}
+
+TEST_P(SevenBitCodecTest, IgnoresUnpairedTrailingByte) {
+    const uint8_t encoded[] = { 0x7F, 0x01, 0x05 };
+    uint8_t decoded[2] = { 0, 0 };
+
+    ASSERT_EQ(1u, SevenBitCodec::decode(encoded, sizeof(encoded), decoded));
+    EXPECT_EQ(0xFF, decoded[0]);
+    EXPECT_EQ(0, decoded[1]);
+}
+
+INSTANTIATE_TEST_SUITE_P(Kernels, SevenBitCodecTest, ::testing::Values(
+    SevenBitCodec::KERNEL_SCALAR,
+    SevenBitCodec::KERNEL_SSE2,
+    SevenBitCodec::KERNEL_AVX2,
+    SevenBitCodec::KERNEL_NEON
+));
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,176 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <csignal>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <FirmataMarshaller.h>
+
+#include "FdStream.h"
+#include "LoopbackStream.h"
+#include "WriteCombiningStream.h"
+
+using namespace remote_wiring::protocol;
+
+/*!
+ * \brief A pipe drained by a reader thread, which records every byte
+ */
+class PipeReader {
+  public:
+    std::vector<uint8_t> received;
+
+    PipeReader (const useconds_t pause_us_) {
+        if ( 0 != ::pipe(_link) ) { _link[0] = _link[1] = -1; return; }
+        (void)::fcntl(_link[1], F_SETPIPE_SZ, 4096);
+        _reader = std::thread([this, pause_us_]() {
+            uint8_t buffer[97];
+            for (ssize_t bytes_read ; (bytes_read = ::read(_link[0], buffer, sizeof(buffer))) > 0 ; ::usleep(pause_us_)) {
+                received.insert(received.end(), buffer, (buffer + bytes_read));
+            }
+        });
+    }
+
+    ~PipeReader () { close(); }
+
+    // Close the write end, and wait for the reader to take every byte
+    void close (void) {
+        if ( _link[1] >= 0 ) { ::close(_link[1]); _link[1] = -1; }
+        if ( _reader.joinable() ) { _reader.join(); }
+        if ( _link[0] >= 0 ) { ::close(_link[0]); _link[0] = -1; }
+    }
+
+    int fd (void) const { return _link[1]; }
+
+  private:
+    int _link[2];
+    std::thread _reader;
+};
+
+static void
+record (
+    void * context_,
+    uint8_t byte_
+) {
+    reinterpret_cast<std::vector<uint8_t> *>(context_)->push_back(byte_);
+}
+
+TEST(WriteCombiningStreamTest, PreservesByteOrderOverASaturatedLink) {
+    PipeReader link(300);
+    std::vector<uint8_t> expected;
+    LoopbackStream reference_stream;
+    firmata::FirmataMarshaller reference;
+
+    ASSERT_LE(0, link.fd());
+    reference_stream.setWriteHandler(record, &expected);
+    reference.begin(reference_stream);
+    {
+        FdStream descriptor(link.fd());
+        descriptor.begin(0, 0x06);
+
+        // Odd sizes, so flushes rarely fall on a message boundary
+        WriteCombiningStream combining(descriptor, 100, std::chrono::microseconds(200), 333);
+        firmata::FirmataMarshaller marshaller;
+        marshaller.begin(combining);
+
+        for (size_t i = 0 ; i < 30000 ; ++i) {
+            switch (i % 4) {
+              case 0:
+                marshaller.sendAnalog((i % 16), (i & 0x3FFF));
+                reference.sendAnalog((i % 16), (i & 0x3FFF));
+                break;
+              case 1:
+                marshaller.sendPinStateQuery(i % 70);
+                reference.sendPinStateQuery(i % 70);
+                break;
+              case 2:
+                marshaller.sendDigital((i % 60), (i & 1));
+                reference.sendDigital((i % 60), (i & 1));
+                break;
+              default:
+                marshaller.sendPinMode((i % 60), 1);
+                reference.sendPinMode((i % 60), 1);
+                break;
+            }
+
+            // Let the staged bytes age past the flush delay now and then
+            if ( 0 == (i % 1000) ) { ::usleep(1500); }
+        }
+        combining.flush();
+
+        EXPECT_EQ(expected.size(), combining.bytesWritten());
+        EXPECT_LT(0u, combining.backpressureWaits());
+        EXPECT_LT(0u, combining.flushes(WriteCombiningStream::FLUSH_DEADLINE));
+    }
+    link.close();
+
+    ASSERT_EQ(expected.size(), link.received.size());
+    EXPECT_TRUE(expected == link.received);
+}
+
+TEST(WriteCombiningStreamTest, WritesALoneMessageAfterTheFlushDelay) {
+    PipeReader link(0);
+
+    ASSERT_LE(0, link.fd());
+    {
+        FdStream descriptor(link.fd());
+        descriptor.begin(0, 0x06);
+        WriteCombiningStream combining(descriptor, 256, std::chrono::milliseconds(1));
+        firmata::FirmataMarshaller marshaller;
+        marshaller.begin(combining);
+
+        marshaller.sendDigital(13, 1);
+        for (size_t waited_ms = 0 ; (waited_ms < 1000) && !combining.bytesWritten() ; ++waited_ms) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        EXPECT_EQ(3u, combining.bytesWritten());
+        EXPECT_EQ(1u, combining.writeCalls());
+        EXPECT_EQ(1u, combining.flushes(WriteCombiningStream::FLUSH_DEADLINE));
+    }
+    link.close();
+
+    EXPECT_EQ(3u, link.received.size());
+}
+
+TEST(WriteCombiningStreamTest, DropsStagedBytesWhenTheLinkFails) {
+    int link[2];
+
+    // Report a write to a closed pipe as EPIPE, rather than a signal
+    ASSERT_NE(SIG_ERR, ::signal(SIGPIPE, SIG_IGN));
+    ASSERT_EQ(0, ::pipe(link));
+    (void)::fcntl(link[1], F_SETPIPE_SZ, 4096);
+    {
+        FdStream descriptor(link[1]);
+        descriptor.begin(0, 0x06);
+        WriteCombiningStream combining(descriptor, 64, std::chrono::milliseconds(1), 256);
+        firmata::FirmataMarshaller marshaller;
+        marshaller.begin(combining);
+
+        // Saturate the link, then hang up while the flusher waits on it
+        std::thread hang_up([&link]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            ::close(link[0]);
+        });
+        for (size_t i = 0 ; i < 10000 ; ++i) { marshaller.sendAnalog((i % 16), (i & 0x3FFF)); }
+        hang_up.join();
+        combining.flush();
+
+        EXPECT_LT(0u, combining.bytesDropped());
+        EXPECT_EQ(30000u, (combining.bytesWritten() + combining.bytesDropped()));
+
+        // A dead link drops each flush, rather than hanging it
+        marshaller.sendDigital(13, 1);
+        combining.flush();
+        EXPECT_EQ(30003u, (combining.bytesWritten() + combining.bytesDropped()));
+    }
+    ::close(link[1]);
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */